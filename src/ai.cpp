@@ -0,0 +1,662 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cstring>
+#include <stdexcept>
+#include "tech.h"
+#include "ai.h"
+
+#define AI_MAX_TASKS 64
+// Score multipliers, scores are integers and must stay positive
+#define AI_RESEARCH_SCALE 100000
+#define AI_DISTANCE_SCALE 100
+#define AI_HYPER_PENALTY 4
+// Fleet power is drive HP scaled by average beam offense and defense
+#define AI_POWER_BASE 50
+// Own fleet power in percent of hostile power needed to attack
+#define AI_ATTACK_MARGIN 150
+#define AI_DEFEND_VALUE 80
+#define AI_ATTACK_VALUE 50
+#define AI_EXPLORE_VALUE 30
+#define AI_OUTPOST_VALUE 20
+#define AI_POPULATION_VALUE 10
+#define AI_MINERALS_VALUE 8
+
+// Research priority of each area by objective, in percent
+static const unsigned researchWeights[AI_OBJECTIVE_COUNT][MAX_RESEARCH_AREAS] = {
+	// Biology, Power, Physics, Construction, Fields, Chemistry,
+	// Computers, Sociology
+	{100, 100, 100, 100, 100, 100, 100, 150},	// Diplomat
+	{80, 120, 150, 100, 150, 120, 120, 60},		// Militarist
+	{150, 130, 100, 120, 80, 100, 80, 100},		// Expansionist
+	{100, 100, 100, 100, 100, 100, 150, 100},	// Technologist
+	{100, 100, 80, 150, 80, 120, 120, 80},		// Industrialist
+	{150, 80, 80, 100, 100, 100, 80, 120}		// Ecologist
+};
+
+// Exploration and colonization priorities by objective, in percent
+static const unsigned exploreWeights[AI_OBJECTIVE_COUNT] = {
+	100, 80, 150, 120, 100, 100
+};
+
+static const unsigned populationWeights[AI_OBJECTIVE_COUNT] = {
+	100, 80, 150, 100, 80, 120
+};
+
+static const unsigned mineralWeights[AI_OBJECTIVE_COUNT] = {
+	100, 120, 100, 100, 150, 60
+};
+
+// Attack priority by personality, in percent
+static const unsigned aggressionWeights[AI_PERSONALITY_COUNT] = {
+	80, 150, 130, 100, 70, 40
+};
+
+static unsigned playerObjective(const Player *pptr) {
+	return pptr->objective < AI_OBJECTIVE_COUNT ? pptr->objective :
+		OBJECTIVE_DIPLOMAT;
+}
+
+static unsigned playerAggression(const Player *pptr) {
+	return pptr->personality < AI_PERSONALITY_COUNT ?
+		aggressionWeights[pptr->personality] :
+		aggressionWeights[PERSONALITY_ERRATIC];
+}
+
+static unsigned researchItem(const GameState *state, unsigned player,
+	unsigned topic) {
+
+	Technology techs[MAX_RESEARCH_CHOICES];
+
+	if (!researchTree.researchableTechs(state->techTable(), player, topic,
+		techs)) {
+		return TECH_NONE;
+	}
+
+	return techs[0];
+}
+
+class AIPlanner::ScoreTask : public Task {
+private:
+	const AIPlanner *_planner;
+	const GameState *_state;
+	Unit *_units;
+	size_t _count;
+
+protected:
+	void run(void);
+
+public:
+	ScoreTask(void);
+
+	void setup(const AIPlanner *planner, const GameState *state,
+		Unit *units, size_t count);
+};
+
+AIPlanner::ScoreTask::ScoreTask(void) : _planner(NULL), _state(NULL),
+	_units(NULL), _count(0) {
+
+}
+
+void AIPlanner::ScoreTask::setup(const AIPlanner *planner,
+	const GameState *state, Unit *units, size_t count) {
+
+	_planner = planner;
+	_state = state;
+	_units = units;
+	_count = count;
+}
+
+void AIPlanner::ScoreTask::run(void) {
+	size_t i;
+
+	for (i = 0; i < _count; i++) {
+		_planner->scoreUnit(_state, _units + i);
+	}
+}
+
+AIPlanner::AIPlanner(GameState *game) : _game(game), _actions(NULL),
+	_actionCount(0), _maxActions(0), _routes(game) {
+
+	memset(_starPower, 0, sizeof(_starPower));
+}
+
+AIPlanner::~AIPlanner(void) {
+	delete[] _actions;
+}
+
+int AIPlanner::isAIPlayer(const Player *pptr) {
+	return pptr->objective != OBJECTIVE_HUMAN && !pptr->eliminated;
+}
+
+long AIPlanner::fleetPower(const GameState *state, const Fleet *flt) {
+	long tmp;
+	FleetStrength fs;
+
+	state->evalFleetStrength(flt, 0, &fs);
+
+	if (!fs.combatShips) {
+		return 0;
+	}
+
+	tmp = AI_POWER_BASE + (fs.beamOffense + fs.beamDefense) /
+		(long)fs.combatShips;
+	return fs.driveHP * MAX(tmp, 1);
+}
+
+unsigned AIPlanner::fleetSpeed(const Fleet *flt) {
+	return MAX(flt->getWarpSpeed(), 1);
+}
+
+unsigned AIPlanner::travelTurns(const GameState *state, const Fleet *flt,
+	unsigned star_id) const {
+
+	unsigned orbited = flt->getOrbitedStar() - state->_starSystems;
+
+	return _routes.eta(orbited, star_id, fleetSpeed(flt));
+}
+
+int AIPlanner::isHostile(const GameState *state, unsigned player_id,
+	unsigned owner) {
+
+	if (owner == player_id) {
+		return 0;
+	}
+
+	// Monsters and other NPC fleets
+	if (owner >= state->_playerCount) {
+		return 1;
+	}
+
+	return state->_players[player_id].foreignPolicies[owner] >=
+		DIPLO_LIMITED_WAR;
+}
+
+void AIPlanner::addChoice(Unit *unit, unsigned id, int score,
+	int exclusive) {
+
+	unsigned i, pos;
+
+	if (score <= 0) {
+		return;
+	}
+
+	// Earlier candidates win ties
+	for (pos = 0; pos < unit->choiceCount; pos++) {
+		if (unit->scores[pos] < score) {
+			break;
+		}
+	}
+
+	if (pos >= AI_MAX_CHOICES) {
+		return;
+	}
+
+	if (unit->choiceCount < AI_MAX_CHOICES) {
+		unit->choiceCount++;
+	}
+
+	for (i = unit->choiceCount - 1; i > pos; i--) {
+		unit->choices[i] = unit->choices[i - 1];
+		unit->scores[i] = unit->scores[i - 1];
+		unit->exclusive[i] = unit->exclusive[i - 1];
+	}
+
+	unit->choices[pos] = id;
+	unit->scores[pos] = score;
+	unit->exclusive[pos] = exclusive;
+}
+
+void AIPlanner::scanFleets(const GameState *state) {
+	unsigned i, owner;
+	const BilistNode<Fleet> *node;
+
+	memset(_starPower, 0, sizeof(_starPower));
+
+	for (i = 0; i < state->_starSystemCount; i++) {
+		node = state->_starSystems[i].getOrbitingFleets();
+
+		for (; node; node = node->next()) {
+			if (!node->data) {
+				continue;
+			}
+
+			owner = node->data->getOwner();
+
+			if (owner < MAX_FLEET_OWNERS) {
+				_starPower[i][owner] += fleetPower(state,
+					node->data);
+			}
+		}
+	}
+}
+
+void AIPlanner::scoreUnit(const GameState *state, Unit *unit) const {
+	switch (unit->type) {
+	case AI_ACTION_RESEARCH:
+		scoreResearch(state, unit);
+		break;
+
+	case AI_ACTION_MOVE_FLEET:
+		scoreCombatFleet(state, unit);
+		break;
+
+	case AI_ACTION_COLONIZE:
+		scoreColonyFleet(state, unit);
+		break;
+
+	default:
+		throw std::logic_error("Invalid AI planning unit");
+	}
+}
+
+void AIPlanner::scoreResearch(const GameState *state, Unit *unit) const {
+	unsigned i, topic, weight, cost, topics[MAX_RESEARCH_TOPICS];
+	size_t count;
+	int area;
+	const Player *pptr = state->_players + unit->player;
+
+	// Keep the current topic until it's finished
+	if (pptr->canResearchTopic(pptr->researchTopic)) {
+		return;
+	}
+
+	count = researchTree.readyTopics(state->techTable(), unit->player,
+		topics);
+
+	for (i = 0; i < count; i++) {
+		topic = topics[i];
+		area = researchTree.topicArea(topic);
+
+		if (area < 0) {
+			continue;
+		}
+
+		weight = researchWeights[playerObjective(pptr)][area];
+
+		if (isHyperTopic(topic)) {
+			weight /= AI_HYPER_PENALTY;
+		}
+
+		cost = pptr->researchCost(topic, 1);
+		addChoice(unit, topic, weight * AI_RESEARCH_SCALE / MAX(cost, 1),
+			0);
+	}
+}
+
+void AIPlanner::scoreCombatFleet(const GameState *state, Unit *unit) const {
+	unsigned i, j, orbited, turns, aggression, explore;
+	int value, exclusive, enemyColony;
+	long power, hostile;
+	const Star *sptr;
+	const Fleet *flt = unit->fleet;
+	const Player *pptr = state->_players + unit->player;
+
+	power = fleetPower(state, flt);
+	orbited = flt->getOrbitedStar() - state->_starSystems;
+	aggression = playerAggression(pptr);
+	explore = exploreWeights[playerObjective(pptr)];
+
+	for (i = 0; i < state->_starSystemCount; i++) {
+		if (i != orbited && !state->isStarInRange(i, unit->player)) {
+			continue;
+		}
+
+		sptr = state->_starSystems + i;
+		value = exclusive = enemyColony = 0;
+		hostile = 0;
+
+		for (j = 0; j < MAX_FLEET_OWNERS; j++) {
+			if (_starPower[i][j] &&
+				isHostile(state, unit->player, j)) {
+				hostile += _starPower[i][j];
+			}
+		}
+
+		for (j = 0; j < state->_playerCount; j++) {
+			if (sptr->hasColony & (1 << j) &&
+				isHostile(state, unit->player, j)) {
+				enemyColony = 1;
+			}
+		}
+
+		// Defend own colonies even against stronger enemies
+		if (sptr->hasColony & (1 << unit->player) && hostile) {
+			value += AI_DEFEND_VALUE;
+		}
+
+		if ((hostile || enemyColony) &&
+			power * 100 > hostile * AI_ATTACK_MARGIN) {
+			value += AI_ATTACK_VALUE * aggression / 100;
+		}
+
+		// Sending one scout to each unknown star is enough
+		if (!value && state->isStarExplored(sptr, unit->player) <
+			STAR_VISITED) {
+			value = AI_EXPLORE_VALUE * explore / 100;
+			exclusive = 1;
+		}
+
+		if (!value) {
+			continue;
+		}
+
+		turns = i == orbited ? 0 : travelTurns(state, flt, i);
+		addChoice(unit, i, value * AI_DISTANCE_SCALE / (turns + 1),
+			exclusive);
+	}
+}
+
+void AIPlanner::scoreColonyFleet(const GameState *state, Unit *unit) const {
+	unsigned i, j, orbited, turns, star, pop, popWeight, mineralWeight;
+	int value, colonyShip;
+	long hostile;
+	const Planet *ptr;
+	const Fleet *flt = unit->fleet;
+	const Player *pptr = state->_players + unit->player;
+
+	orbited = flt->getOrbitedStar() - state->_starSystems;
+	colonyShip = flt->shipTypeCount(COLONY_SHIP) > 0;
+	popWeight = populationWeights[playerObjective(pptr)];
+	mineralWeight = mineralWeights[playerObjective(pptr)];
+
+	for (i = 0; i < state->_planetCount; i++) {
+		ptr = state->_planets + i;
+		star = ptr->star;
+
+		if (ptr->colony >= 0 || star >= state->_starSystemCount) {
+			continue;
+		}
+
+		if (star != orbited && !state->isStarInRange(star,
+			unit->player)) {
+			continue;
+		}
+
+		// Planet details must be known
+		if (state->isStarExplored(star, unit->player) < STAR_CHARTED) {
+			continue;
+		}
+
+		for (j = 0, hostile = 0; j < MAX_FLEET_OWNERS; j++) {
+			if (_starPower[star][j] &&
+				isHostile(state, unit->player, j)) {
+				hostile += _starPower[star][j];
+			}
+		}
+
+		if (hostile) {
+			continue;
+		}
+
+		value = AI_MINERALS_VALUE * ptr->minerals * mineralWeight / 100;
+
+		if (colonyShip) {
+			pop = state->planetMaxPop(i, unit->player);
+
+			if (!pop) {
+				continue;
+			}
+
+			value += AI_POPULATION_VALUE * pop * popWeight / 100;
+		} else {
+			value += AI_OUTPOST_VALUE;
+		}
+
+		turns = star == orbited ? 0 : travelTurns(state, flt, star);
+		addChoice(unit, i, value * AI_DISTANCE_SCALE / (turns + 1), 1);
+	}
+}
+
+void AIPlanner::addAction(unsigned type, unsigned player, unsigned subject,
+	unsigned source, unsigned target, unsigned stop, unsigned eta,
+	int score) {
+
+	AIAction *ptr;
+
+	if (_actionCount >= _maxActions) {
+		throw std::length_error("Too many AI actions");
+	}
+
+	ptr = _actions + _actionCount++;
+	ptr->type = type;
+	ptr->player = player;
+	ptr->subject = subject;
+	ptr->source = source;
+	ptr->target = target;
+	ptr->stop = stop;
+	ptr->eta = eta;
+	ptr->score = score;
+}
+
+void AIPlanner::resolve(const GameState *state, const Unit *units,
+	size_t count) {
+
+	size_t i;
+	unsigned j, choice, source, dest, speed;
+	uint8_t *claim;
+	uint8_t claimedStars[MAX_STARS], claimedPlanets[MAX_PLANETS];
+	const Unit *ptr;
+
+	memset(claimedStars, 0, sizeof(claimedStars));
+	memset(claimedPlanets, 0, sizeof(claimedPlanets));
+
+	for (i = 0; i < count; i++) {
+		ptr = units + i;
+		claim = ptr->type == AI_ACTION_COLONIZE ? claimedPlanets :
+			claimedStars;
+
+		for (j = 0; j < ptr->choiceCount; j++) {
+			if (!ptr->exclusive[j] || !claim[ptr->choices[j]]) {
+				break;
+			}
+		}
+
+		if (j >= ptr->choiceCount) {
+			continue;
+		}
+
+		choice = ptr->choices[j];
+
+		if (ptr->exclusive[j]) {
+			claim[choice] = 1;
+		}
+
+		if (ptr->type == AI_ACTION_RESEARCH) {
+			addAction(ptr->type, ptr->player, choice, 0,
+				researchItem(state, ptr->player, choice), 0, 0,
+				ptr->scores[j]);
+			continue;
+		}
+
+		source = ptr->fleet->getOrbitedStar() - state->_starSystems;
+		dest = ptr->type == AI_ACTION_COLONIZE ?
+			state->_planets[choice].star : choice;
+
+		// Best place for the fleet is where it already is
+		if (ptr->type == AI_ACTION_MOVE_FLEET && choice == source) {
+			continue;
+		}
+
+		if (dest == source) {
+			addAction(ptr->type, ptr->player,
+				ptr->fleet->getShipID(0), source, choice,
+				source, 0, ptr->scores[j]);
+			continue;
+		}
+
+		speed = fleetSpeed(ptr->fleet);
+		addAction(ptr->type, ptr->player, ptr->fleet->getShipID(0),
+			source, choice, _routes.nextStop(source, dest, speed),
+			_routes.eta(source, dest, speed), ptr->scores[j]);
+	}
+}
+
+void AIPlanner::plan(void) {
+	unsigned i, taskCount;
+	size_t j, first, count, unitCount = 0, maxUnits;
+	const GameState *state;
+	const BilistNode<Fleet> *node;
+	const Fleet *flt;
+	GameSnapshot *snap;
+	Unit *ptr, *units = NULL;
+	ScoreTask *tasks = NULL;
+
+	_actionCount = 0;
+	snap = _game->snapshot();
+
+	try {
+		state = &snap->state();
+		scanFleets(state);
+		// One research unit per player, fleets have at least one ship
+		maxUnits = state->_playerCount + state->_shipCount;
+		units = new Unit[maxUnits];
+
+		// Units are grouped by player in ID order
+		for (i = 0; i < state->_playerCount; i++) {
+			if (!isAIPlayer(state->_players + i)) {
+				continue;
+			}
+
+			ptr = units + unitCount++;
+			ptr->type = AI_ACTION_RESEARCH;
+			ptr->player = i;
+			ptr->fleet = NULL;
+			ptr->choiceCount = 0;
+
+			for (j = 0; j < state->_starSystemCount; j++) {
+				node = state->_starSystems[j].getOrbitingFleets();
+
+				for (; node; node = node->next()) {
+					flt = node->data;
+
+					if (!flt || flt->getOwner() != i) {
+						continue;
+					}
+
+					ptr = units + unitCount;
+
+					if (flt->shipTypeCount(COLONY_SHIP) ||
+						flt->shipTypeCount(OUTPOST_SHIP)) {
+						ptr->type = AI_ACTION_COLONIZE;
+					} else if (flt->combatCount()) {
+						ptr->type = AI_ACTION_MOVE_FLEET;
+					} else {
+						continue;
+					}
+
+					ptr->player = i;
+					ptr->fleet = flt;
+					ptr->choiceCount = 0;
+					unitCount++;
+					// Scoring tasks only read route tables
+					_routes.prepare(fleetSpeed(flt));
+				}
+			}
+		}
+
+		delete[] _actions;
+		_maxActions = 0;
+		_actions = NULL;
+		_actions = new AIAction[unitCount ? unitCount : 1];
+		_maxActions = unitCount;
+		taskCount = MIN(unitCount, AI_MAX_TASKS);
+
+		// Split units evenly so that the work scales with CPU count
+		// rather than player count
+		if (taskCount) {
+			tasks = new ScoreTask[taskCount];
+		}
+
+		if (taskCount) {
+			// The pool must be destroyed before the tasks
+			WorkerPool pool;
+
+			for (i = 0, first = 0; i < taskCount; i++) {
+				count = unitCount / taskCount;
+				count += i < unitCount % taskCount ? 1 : 0;
+				tasks[i].setup(this, state, units + first,
+					count);
+				pool.add(tasks + i);
+				first += count;
+			}
+
+			pool.wait();
+		}
+
+		for (first = 0; first < unitCount; first = j) {
+			for (j = first; j < unitCount &&
+				units[j].player == units[first].player; j++);
+
+			resolve(state, units + first, j - first);
+		}
+	} catch (...) {
+		delete[] tasks;
+		delete[] units;
+		snap->release();
+		throw;
+	}
+
+	delete[] tasks;
+	delete[] units;
+	snap->release();
+}
+
+size_t AIPlanner::actionCount(void) const {
+	return _actionCount;
+}
+
+const AIAction *AIPlanner::getAction(size_t pos) const {
+	if (pos >= _actionCount) {
+		throw std::out_of_range("Invalid AI action index");
+	}
+
+	return _actions + pos;
+}
+
+size_t AIPlanner::apply(void) {
+	size_t i, ret = 0;
+	const AIAction *ptr;
+	Player *pptr;
+
+	for (i = 0; i < _actionCount; i++) {
+		ptr = _actions + i;
+
+		if (ptr->type != AI_ACTION_RESEARCH ||
+			ptr->player >= _game->_playerCount) {
+			continue;
+		}
+
+		pptr = _game->_players + ptr->player;
+
+		if (!isAIPlayer(pptr) || !pptr->canResearchTopic(ptr->subject)) {
+			continue;
+		}
+
+		pptr->researchTopic = ptr->subject;
+		pptr->researchItem = ptr->target;
+		ret++;
+	}
+
+	if (ret) {
+		_game->markChanged(GAMESTATE_PLAYERS);
+	}
+
+	return ret;
+}
@@ -0,0 +1,116 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef AI_H_
+#define AI_H_
+
+#include "gamestate.h"
+#include "route.h"
+
+#define AI_ACTION_RESEARCH 0
+#define AI_ACTION_MOVE_FLEET 1
+#define AI_ACTION_COLONIZE 2
+
+// Number of best candidates kept for each planning unit
+#define AI_MAX_CHOICES 4
+
+// Planned order of one AI player
+struct AIAction {
+	uint8_t type, player;
+	// Research: subject is the topic ID, target is the technology ID.
+	// Fleet actions: subject is the flagship ID, source is the star
+	// where the fleet was orbiting during planning, target is the
+	// destination star or planet ID. Stop is the first star on the
+	// fastest route to the target star and eta the number of turns
+	// needed to get there.
+	unsigned subject, source, target, stop, eta;
+	int score;
+};
+
+// Computer player turn planner. Candidate actions are scored in parallel
+// on a game state snapshot, then each player's choices are resolved
+// in player order. Results depend only on the game state. Research orders
+// are applied directly, fleet orders are left to movement processing.
+class AIPlanner {
+private:
+	// Research choice or orbiting fleet of one AI player
+	struct Unit {
+		uint8_t type, player;
+		const Fleet *fleet;
+		unsigned choiceCount;
+		unsigned choices[AI_MAX_CHOICES];
+		int scores[AI_MAX_CHOICES];
+		// Choice may be taken by only one unit of the player
+		uint8_t exclusive[AI_MAX_CHOICES];
+	};
+
+	class ScoreTask;
+
+	GameState *_game;
+	AIAction *_actions;
+	size_t _actionCount, _maxActions;
+	// Combat power of fleets orbiting each star by owner
+	long _starPower[MAX_STARS][MAX_FLEET_OWNERS];
+	RouteTable _routes;
+
+	// Do NOT implement
+	AIPlanner(const AIPlanner &other);
+	const AIPlanner &operator=(const AIPlanner &other);
+
+protected:
+	static long fleetPower(const GameState *state, const Fleet *flt);
+	static unsigned fleetSpeed(const Fleet *flt);
+	unsigned travelTurns(const GameState *state, const Fleet *flt,
+		unsigned star_id) const;
+	static int isHostile(const GameState *state, unsigned player_id,
+		unsigned owner);
+	static void addChoice(Unit *unit, unsigned id, int score,
+		int exclusive);
+
+	void scanFleets(const GameState *state);
+	void scoreUnit(const GameState *state, Unit *unit) const;
+	void scoreResearch(const GameState *state, Unit *unit) const;
+	void scoreCombatFleet(const GameState *state, Unit *unit) const;
+	void scoreColonyFleet(const GameState *state, Unit *unit) const;
+
+	// Pick final actions from scored units of one player
+	void resolve(const GameState *state, const Unit *units,
+		size_t count);
+	void addAction(unsigned type, unsigned player, unsigned subject,
+		unsigned source, unsigned target, unsigned stop, unsigned eta,
+		int score);
+
+public:
+	explicit AIPlanner(GameState *game);
+	~AIPlanner(void);
+
+	static int isAIPlayer(const Player *pptr);
+
+	// Plan actions of all AI players, previous plan is discarded
+	void plan(void);
+	// Apply planned research orders to player records in plan order.
+	// Orders which no longer match the game state are skipped. Returns
+	// the number of applied orders.
+	size_t apply(void);
+
+	size_t actionCount(void) const;
+	const AIAction *getAction(size_t pos) const;
+};
+
+#endif
@@ -0,0 +1,802 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+#include <stdexcept>
+#include "system.h"
+#include "cache.h"
+
+#define CACHE_DIR "cache"
+#define CACHE_MAGIC "OO2C"
+#define CACHE_BYTE_ORDER 0x01020304
+#define CACHE_FORMAT 1
+#define CACHE_ALIGN 8
+#define CACHE_NULL_STRING 0xffffffff
+#define CACHE_INDEX_VERSION 1
+#define BUNDLE_MAGIC "OO2B"
+#define BUNDLE_FORMAT 1
+#define BUNDLE_PAGE_SIZE 4096
+#define BUNDLE_SOURCES "sources"
+
+struct CacheHeader {
+	char magic[4];
+	uint32_t byteOrder, format, keySize;
+	uint64_t payloadSize;
+};
+
+struct BundleHeader {
+	char magic[4];
+	uint32_t byteOrder, format, entryCount;
+	uint64_t dirOffset, namesOffset, namesSize;
+};
+
+static size_t cacheAlign(size_t size, size_t align) {
+	return (size + align - 1) & ~(align - 1);
+}
+
+static int cmpBundleEntry(const void *a, const void *b) {
+	const BundleEntry *x = (const BundleEntry*)a;
+	const BundleEntry *y = (const BundleEntry*)b;
+
+	if (x->hash == y->hash) {
+		return 0;
+	}
+
+	return x->hash < y->hash ? -1 : 1;
+}
+
+CacheKey::CacheKey(const char *type, unsigned version) : _data(256) {
+	addString(type);
+	addValue(version);
+}
+
+void CacheKey::addValue(uint32_t value) {
+	_data.write(&value, sizeof(value));
+}
+
+void CacheKey::addString(const char *str) {
+	_data.write(str, strlen(str) + 1);
+}
+
+void CacheKey::addDataFile(const char *filename) {
+	char *realname, *path = NULL;
+	uint64_t size;
+	int64_t mtime;
+	int ret;
+
+	realname = findDatadirFile(filename);
+
+	try {
+		path = dataPath(realname);
+		ret = fileInfo(path, &size, &mtime);
+
+		if (!ret) {
+			throw std::runtime_error("Cannot read data file info");
+		}
+
+		addFileInfo(realname, size, mtime);
+	} catch (...) {
+		delete[] realname;
+		delete[] path;
+		throw;
+	}
+
+	delete[] realname;
+	delete[] path;
+}
+
+void CacheKey::addFileInfo(const char *name, uint64_t size, int64_t mtime) {
+	addString(name);
+	_data.write(&size, sizeof(size));
+	_data.write(&mtime, sizeof(mtime));
+}
+
+const void *CacheKey::data(void) const {
+	return _data.dataPtr();
+}
+
+size_t CacheKey::size(void) const {
+	return _data.size();
+}
+
+CacheFile::CacheFile(void) : _map(NULL), _mapSize(0), _offset(0), _size(0) {
+
+}
+
+CacheFile::~CacheFile(void) {
+	close();
+}
+
+int CacheFile::open(const char *filename, const CacheKey &key) {
+	CacheHeader header;
+	char *path;
+
+	close();
+	path = cachePath(filename);
+
+	try {
+		_map = (const uint8_t*)mapFile(path, &_mapSize);
+	} catch (...) {
+		delete[] path;
+		throw;
+	}
+
+	delete[] path;
+
+	if (!_map) {
+		return 0;
+	}
+
+	if (_mapSize < sizeof(header)) {
+		close();
+		return 0;
+	}
+
+	memcpy(&header, _map, sizeof(header));
+
+	if (memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) ||
+		header.byteOrder != CACHE_BYTE_ORDER ||
+		header.format != CACHE_FORMAT || header.keySize != key.size() ||
+		_mapSize < sizeof(header) + header.keySize ||
+		memcmp(_map + sizeof(header), key.data(), key.size())) {
+		close();
+		return 0;
+	}
+
+	_offset = cacheAlign(sizeof(header) + header.keySize, CACHE_ALIGN);
+
+	if (_offset > _mapSize || header.payloadSize != _mapSize - _offset) {
+		close();
+		return 0;
+	}
+
+	_size = header.payloadSize;
+	return 1;
+}
+
+void CacheFile::close(void) {
+	unmapFile(_map, _mapSize);
+	_map = NULL;
+	_mapSize = _offset = _size = 0;
+}
+
+const uint8_t *CacheFile::data(void) const {
+	return _map ? _map + _offset : NULL;
+}
+
+size_t CacheFile::size(void) const {
+	return _size;
+}
+
+CacheReader::CacheReader(const uint8_t *data, size_t size) : _data(data),
+	_size(size), _pos(0) {
+
+}
+
+uint32_t CacheReader::readUint32(void) {
+	uint32_t ret;
+
+	memcpy(&ret, readBlock(sizeof(ret)), sizeof(ret));
+	return ret;
+}
+
+const char *CacheReader::readString(void) {
+	uint32_t len = readUint32();
+	const char *ret;
+
+	if (len == CACHE_NULL_STRING) {
+		return NULL;
+	}
+
+	ret = (const char*)readBlock(cacheAlign(len + 1, sizeof(uint32_t)));
+
+	if (ret[len]) {
+		throw std::runtime_error("Invalid string in cache data");
+	}
+
+	return ret;
+}
+
+const void *CacheReader::readBlock(size_t size) {
+	const uint8_t *ret = _data + _pos;
+
+	if (size > _size - _pos) {
+		throw std::runtime_error("Premature end of cache data");
+	}
+
+	_pos += cacheAlign(size, sizeof(uint32_t));
+	_pos = MIN(_pos, _size);
+	return ret;
+}
+
+size_t CacheReader::remaining(void) const {
+	return _size - _pos;
+}
+
+int CacheReader::eos(void) const {
+	return _pos >= _size;
+}
+
+CacheWriter::CacheWriter(void) : _data(64 * 1024) {
+
+}
+
+void CacheWriter::pad(void) {
+	static const uint8_t zeros[CACHE_ALIGN] = {0};
+	size_t size = _data.size();
+
+	_data.write(zeros, cacheAlign(size, sizeof(uint32_t)) - size);
+}
+
+void CacheWriter::writeUint32(uint32_t value) {
+	_data.write(&value, sizeof(value));
+}
+
+void CacheWriter::writeString(const char *str) {
+	uint32_t len;
+
+	if (!str) {
+		writeUint32(CACHE_NULL_STRING);
+		return;
+	}
+
+	len = strlen(str);
+	writeUint32(len);
+	_data.write(str, len + 1);
+	pad();
+}
+
+void CacheWriter::writeBlock(const void *data, size_t size) {
+	_data.write(data, size);
+	pad();
+}
+
+const void *CacheWriter::data(void) const {
+	return _data.dataPtr();
+}
+
+size_t CacheWriter::size(void) const {
+	return _data.size();
+}
+
+void CacheWriter::save(const char *filename, const CacheKey &key) {
+	static const uint8_t zeros[CACHE_ALIGN] = {0};
+	CacheHeader header;
+	StringBuffer tmpname;
+	char *path;
+	size_t padding;
+	File fw;
+
+	memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+	header.byteOrder = CACHE_BYTE_ORDER;
+	header.format = CACHE_FORMAT;
+	header.keySize = key.size();
+	header.payloadSize = _data.size();
+	padding = cacheAlign(sizeof(header) + key.size(), CACHE_ALIGN) -
+		sizeof(header) - key.size();
+	path = cachePath(filename);
+
+	try {
+		tmpname.printf("%s.tmp", path);
+
+		if (!fw.open(tmpname.c_str(), File::WRITE | File::TRUNCATE)) {
+			throw std::runtime_error("Cannot create cache file");
+		}
+
+		if (fw.write(&header, sizeof(header)) != sizeof(header) ||
+			fw.write(key.data(), key.size()) != key.size() ||
+			fw.write(zeros, padding) != padding ||
+			fw.write(_data.dataPtr(), _data.size()) !=
+			_data.size()) {
+			throw std::runtime_error("Cannot write cache file");
+		}
+
+		fw.close();
+		replaceFile(tmpname.c_str(), path);
+	} catch (...) {
+		fw.close();
+		remove(tmpname.c_str());
+		delete[] path;
+		throw;
+	}
+
+	delete[] path;
+}
+
+CacheIndex::CacheIndex(const char *name, uint64_t limit) : _name(NULL),
+	_entries(NULL), _count(0), _size(0), _limit(limit), _total(0),
+	_clock(0), _dirty(0) {
+
+	_name = copystr(name);
+
+	// Damaged index is not an error, just start over
+	try {
+		load();
+		prune();
+	} catch (...) {
+		delete[] _entries;
+		_entries = NULL;
+		_count = _size = 0;
+		_total = _clock = 0;
+		_dirty = 1;
+	}
+}
+
+CacheIndex::~CacheIndex(void) {
+	try {
+		save();
+	} catch (...) {
+		// Nothing useful to do here
+	}
+
+	delete[] _name;
+	delete[] _entries;
+}
+
+void CacheIndex::load(void) {
+	unsigned i, count;
+	CacheKey key("cacheindex", CACHE_INDEX_VERSION);
+	CacheFile file;
+	StringBuffer filename;
+
+	key.addString(_name);
+	filename.printf("%s.index", _name);
+
+	if (!file.open(filename.c_str(), key)) {
+		return;
+	}
+
+	CacheReader reader(file.data(), file.size());
+	count = reader.readUint32();
+	memcpy(&_clock, reader.readBlock(sizeof(_clock)), sizeof(_clock));
+
+	if (count > reader.remaining() / sizeof(Entry)) {
+		throw std::runtime_error("Invalid cache index size");
+	}
+
+	_entries = new Entry[count];
+	_size = _count = count;
+	memcpy(_entries, reader.readBlock(count * sizeof(Entry)),
+		count * sizeof(Entry));
+
+	for (i = 0; i < count; i++) {
+		if (i && _entries[i - 1].id >= _entries[i].id) {
+			throw std::runtime_error("Invalid cache index order");
+		}
+
+		_total += _entries[i].size;
+	}
+}
+
+size_t CacheIndex::find(uint64_t id) const {
+	size_t i = 0, j = _count, tmp;
+
+	while (i < j) {
+		tmp = (i + j) / 2;
+
+		if (_entries[tmp].id < id) {
+			i = tmp + 1;
+		} else {
+			j = tmp;
+		}
+	}
+
+	return i;
+}
+
+void CacheIndex::removeEntry(size_t pos) {
+	StringBuffer filename;
+	char *path;
+
+	entryName(filename, _entries[pos].id);
+	_total -= _entries[pos].size;
+	_count--;
+	memmove(_entries + pos, _entries + pos + 1,
+		(_count - pos) * sizeof(Entry));
+	_dirty = 1;
+	path = cachePath(filename.c_str());
+	::remove(path);
+	delete[] path;
+}
+
+void CacheIndex::prune(void) {
+	size_t i, pos;
+
+	while (_count && _total > _limit) {
+		for (i = 1, pos = 0; i < _count; i++) {
+			if (_entries[i].lastUse < _entries[pos].lastUse) {
+				pos = i;
+			}
+		}
+
+		removeEntry(pos);
+	}
+}
+
+void CacheIndex::entryName(StringBuffer &buf, uint64_t id) const {
+	buf.printf("%s-%016" PRIx64 ".cache", _name, id);
+}
+
+int CacheIndex::touch(uint64_t id) {
+	size_t pos = find(id);
+
+	if (pos >= _count || _entries[pos].id != id) {
+		return 0;
+	}
+
+	_entries[pos].lastUse = ++_clock;
+	_dirty = 1;
+	return 1;
+}
+
+int CacheIndex::add(uint64_t id, uint64_t size) {
+	size_t pos;
+
+	if (size > _limit) {
+		remove(id);
+		return 0;
+	}
+
+	pos = find(id);
+
+	if (pos < _count && _entries[pos].id == id) {
+		_total -= _entries[pos].size;
+	} else {
+		if (_count >= _size) {
+			size_t newsize = _size ? 2 * _size : 32;
+			Entry *ptr = new Entry[newsize];
+
+			memcpy(ptr, _entries, _count * sizeof(Entry));
+			delete[] _entries;
+			_entries = ptr;
+			_size = newsize;
+		}
+
+		memmove(_entries + pos + 1, _entries + pos,
+			(_count - pos) * sizeof(Entry));
+		_entries[pos].id = id;
+		_count++;
+	}
+
+	_entries[pos].size = size;
+	_entries[pos].lastUse = ++_clock;
+	_total += size;
+	_dirty = 1;
+	prune();
+	return 1;
+}
+
+void CacheIndex::remove(uint64_t id) {
+	size_t pos = find(id);
+
+	if (pos < _count && _entries[pos].id == id) {
+		removeEntry(pos);
+	}
+}
+
+void CacheIndex::save(void) {
+	CacheKey key("cacheindex", CACHE_INDEX_VERSION);
+	CacheWriter writer;
+	StringBuffer filename;
+
+	if (!_dirty) {
+		return;
+	}
+
+	key.addString(_name);
+	filename.printf("%s.index", _name);
+	writer.writeUint32(_count);
+	writer.writeBlock(&_clock, sizeof(_clock));
+	writer.writeBlock(_entries, _count * sizeof(Entry));
+	writer.save(filename.c_str(), key);
+	_dirty = 0;
+}
+
+AssetBundle::AssetBundle(void) : _map(NULL), _mapSize(0), _entries(NULL),
+	_names(NULL), _namesSize(0), _count(0) {
+
+}
+
+AssetBundle::~AssetBundle(void) {
+	close();
+}
+
+int AssetBundle::checkSources(void) const {
+	unsigned i, count;
+	uint64_t size, realSize;
+	int64_t mtime;
+	size_t length;
+	const uint8_t *data;
+	const char *name;
+	char *path;
+	int ret;
+
+	data = find(BUNDLE_SOURCES, &length);
+
+	if (!data) {
+		return 0;
+	}
+
+	CacheReader reader(data, length);
+
+	try {
+		count = reader.readUint32();
+
+		for (i = 0; i < count; i++) {
+			name = reader.readString();
+			memcpy(&size, reader.readBlock(sizeof(size)),
+				sizeof(size));
+
+			if (!name) {
+				return 0;
+			}
+
+			path = dataPath(name);
+			ret = fileInfo(path, &realSize, &mtime);
+			delete[] path;
+
+			if (!ret || realSize != size) {
+				return 0;
+			}
+		}
+	} catch (...) {
+		return 0;
+	}
+
+	return 1;
+}
+
+int AssetBundle::open(const char *path) {
+	unsigned i;
+	BundleHeader header;
+	const BundleEntry *ptr;
+
+	close();
+	_map = (const uint8_t*)mapFile(path, &_mapSize);
+
+	if (!_map) {
+		return 0;
+	}
+
+	if (_mapSize < sizeof(header)) {
+		close();
+		return 0;
+	}
+
+	memcpy(&header, _map, sizeof(header));
+
+	if (memcmp(header.magic, BUNDLE_MAGIC, sizeof(header.magic)) ||
+		header.byteOrder != CACHE_BYTE_ORDER ||
+		header.format != BUNDLE_FORMAT ||
+		header.dirOffset % sizeof(uint64_t) ||
+		header.dirOffset > _mapSize ||
+		header.entryCount > (_mapSize - header.dirOffset) /
+		sizeof(BundleEntry) || header.namesOffset > _mapSize ||
+		header.namesSize > _mapSize - header.namesOffset) {
+		close();
+		return 0;
+	}
+
+	_entries = (const BundleEntry*)(_map + header.dirOffset);
+	_count = header.entryCount;
+	_names = (const char*)(_map + header.namesOffset);
+	_namesSize = header.namesSize;
+
+	for (i = 0, ptr = _entries; i < _count; i++, ptr++) {
+		if (ptr->offset > _mapSize ||
+			ptr->size > _mapSize - ptr->offset ||
+			ptr->offset % sizeof(uint64_t) ||
+			ptr->nameOffset > _namesSize ||
+			ptr->nameLength >= _namesSize - ptr->nameOffset ||
+			(i && ptr[-1].hash > ptr->hash)) {
+			close();
+			return 0;
+		}
+	}
+
+	if (!checkSources()) {
+		close();
+		return 0;
+	}
+
+	return 1;
+}
+
+void AssetBundle::close(void) {
+	unmapFile(_map, _mapSize);
+	_map = NULL;
+	_mapSize = _namesSize = 0;
+	_entries = NULL;
+	_names = NULL;
+	_count = 0;
+}
+
+const uint8_t *AssetBundle::find(const char *name, size_t *size) const {
+	unsigned i = 0, j = _count, tmp;
+	size_t length = strlen(name);
+	uint64_t hash = cacheHash(name, length);
+
+	while (i < j) {
+		tmp = (i + j) / 2;
+
+		if (_entries[tmp].hash < hash) {
+			i = tmp + 1;
+		} else {
+			j = tmp;
+		}
+	}
+
+	for (; i < _count && _entries[i].hash == hash; i++) {
+		if (_entries[i].nameLength == length &&
+			!memcmp(_names + _entries[i].nameOffset, name, length)) {
+			*size = _entries[i].size;
+			return _map + _entries[i].offset;
+		}
+	}
+
+	return NULL;
+}
+
+BundleWriter::BundleWriter(const char *path) : _path(NULL), _entries(NULL),
+	_count(0), _size(0), _names(64 * 1024), _sourceCount(0) {
+
+	BundleHeader header;
+
+	_path = copystr(path);
+
+	try {
+		_tmpname.printf("%s.tmp", path);
+
+		if (!_file.open(_tmpname.c_str(), File::WRITE | File::TRUNCATE)) {
+			throw std::runtime_error("Cannot create bundle file");
+		}
+
+		// The real header will be written by finish()
+		memset(&header, 0, sizeof(header));
+		writeData(&header, sizeof(header));
+	} catch (...) {
+		_file.close();
+		remove(_tmpname.c_str());
+		delete[] _path;
+		throw;
+	}
+}
+
+BundleWriter::~BundleWriter(void) {
+	_file.close();
+
+	if (_tmpname.length()) {
+		remove(_tmpname.c_str());
+	}
+
+	delete[] _path;
+	delete[] _entries;
+}
+
+void BundleWriter::padFile(void) {
+	static const uint8_t zeros[BUNDLE_PAGE_SIZE] = {0};
+	size_t pos = _file.pos();
+
+	writeData(zeros, cacheAlign(pos, BUNDLE_PAGE_SIZE) - pos);
+}
+
+void BundleWriter::writeData(const void *data, size_t size) {
+	if (_file.write(data, size) != size) {
+		throw std::runtime_error("Cannot write bundle file");
+	}
+}
+
+void BundleWriter::addEntry(const char *name, const void *data,
+	size_t size) {
+
+	BundleEntry *ptr;
+	size_t length = strlen(name);
+
+	if (_count >= _size) {
+		unsigned newsize = _size ? 2 * _size : 64;
+
+		ptr = new BundleEntry[newsize];
+		memcpy(ptr, _entries, _count * sizeof(BundleEntry));
+		delete[] _entries;
+		_entries = ptr;
+		_size = newsize;
+	}
+
+	padFile();
+	ptr = _entries + _count;
+	ptr->hash = cacheHash(name, length);
+	ptr->offset = _file.pos();
+	ptr->size = size;
+	ptr->nameOffset = _names.size();
+	ptr->nameLength = length;
+	writeData(data, size);
+	_names.write(name, length + 1);
+	_count++;
+}
+
+void BundleWriter::addSource(const char *name, uint64_t size) {
+	_sources.writeString(name);
+	_sources.writeBlock(&size, sizeof(size));
+	_sourceCount++;
+}
+
+void BundleWriter::add(const char *name, const CacheWriter &data) {
+	if (!strcmp(name, BUNDLE_SOURCES)) {
+		throw std::invalid_argument("Reserved bundle entry name");
+	}
+
+	addEntry(name, data.data(), data.size());
+}
+
+void BundleWriter::finish(void) {
+	BundleHeader header;
+	CacheWriter sources;
+
+	sources.writeUint32(_sourceCount);
+	sources.writeBlock(_sources.data(), _sources.size());
+	addEntry(BUNDLE_SOURCES, sources.data(), sources.size());
+	qsort(_entries, _count, sizeof(BundleEntry), cmpBundleEntry);
+	padFile();
+
+	memcpy(header.magic, BUNDLE_MAGIC, sizeof(header.magic));
+	header.byteOrder = CACHE_BYTE_ORDER;
+	header.format = BUNDLE_FORMAT;
+	header.entryCount = _count;
+	header.dirOffset = _file.pos();
+	writeData(_entries, _count * sizeof(BundleEntry));
+	header.namesOffset = _file.pos();
+	header.namesSize = _names.size();
+	writeData(_names.dataPtr(), _names.size());
+	_file.seek(0, SEEK_SET);
+	writeData(&header, sizeof(header));
+	_file.close();
+	replaceFile(_tmpname.c_str(), _path);
+	_tmpname.truncate();
+}
+
+uint64_t cacheHash(const void *data, size_t size, uint64_t seed) {
+	const uint8_t *ptr = (const uint8_t*)data;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		seed = (seed ^ ptr[i]) * 0x100000001b3ULL;
+	}
+
+	return seed;
+}
+
+char *cachePath(const char *filename) {
+	char *dir, *ret;
+
+	dir = configPath(CACHE_DIR);
+
+	try {
+		create_path(dir);
+		ret = concatPath(dir, filename);
+	} catch (...) {
+		delete[] dir;
+		throw;
+	}
+
+	delete[] dir;
+	return ret;
+}
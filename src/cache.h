@@ -0,0 +1,246 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include "stream.h"
+#include "utils.h"
+
+// Describes the source data of a cache file. The cache is valid only if
+// the key stored in the file is identical.
+class CacheKey {
+private:
+	MemoryWriteStream _data;
+
+	// Do NOT implement
+	CacheKey(const CacheKey &other);
+	const CacheKey &operator=(const CacheKey &other);
+
+public:
+	// Bump version whenever the cache payload format changes
+	CacheKey(const char *type, unsigned version);
+
+	void addValue(uint32_t value);
+	void addString(const char *str);
+
+	// Add name, size and modification time of a file in data directory
+	void addDataFile(const char *filename);
+	void addFileInfo(const char *name, uint64_t size, int64_t mtime);
+
+	const void *data(void) const;
+	size_t size(void) const;
+};
+
+// Memory mapped cache file. Cache payload uses native byte order and
+// alignment, the files are not portable between architectures.
+class CacheFile {
+private:
+	const uint8_t *_map;
+	size_t _mapSize, _offset, _size;
+
+	// Do NOT implement
+	CacheFile(const CacheFile &other);
+	const CacheFile &operator=(const CacheFile &other);
+
+public:
+	CacheFile(void);
+	~CacheFile(void);
+
+	// Map cache file and check its key. Returns 0 if the file does not
+	// exist, is damaged or was created from different data.
+	int open(const char *filename, const CacheKey &key);
+	void close(void);
+
+	const uint8_t *data(void) const;
+	size_t size(void) const;
+};
+
+// Bounds checked sequential reader of cache payload
+class CacheReader {
+private:
+	const uint8_t *_data;
+	size_t _size, _pos;
+
+public:
+	CacheReader(const uint8_t *data, size_t size);
+
+	uint32_t readUint32(void);
+
+	// Returns NULL if NULL was written. Otherwise the string points
+	// directly into cache data.
+	const char *readString(void);
+	const void *readBlock(size_t size);
+	size_t remaining(void) const;
+	int eos(void) const;
+};
+
+class CacheWriter {
+private:
+	MemoryWriteStream _data;
+
+	// Do NOT implement
+	CacheWriter(const CacheWriter &other);
+	const CacheWriter &operator=(const CacheWriter &other);
+
+protected:
+	void pad(void);
+
+public:
+	CacheWriter(void);
+
+	void writeUint32(uint32_t value);
+	void writeString(const char *str);
+	void writeBlock(const void *data, size_t size);
+	const void *data(void) const;
+	size_t size(void) const;
+
+	// Write the cache file atomically. Throws exception on error.
+	void save(const char *filename, const CacheKey &key);
+};
+
+// Persistent list of cache files which share common size limit. Least
+// recently used files get deleted when the limit is exceeded. Each file is
+// identified by hash of its cache key.
+class CacheIndex {
+private:
+	struct Entry {
+		uint64_t id, size, lastUse;
+	};
+
+	char *_name;
+	Entry *_entries;
+	size_t _count, _size;
+	uint64_t _limit, _total, _clock;
+	int _dirty;
+
+	// Do NOT implement
+	CacheIndex(const CacheIndex &other);
+	const CacheIndex &operator=(const CacheIndex &other);
+
+protected:
+	void load(void);
+
+	// Returns position of the first entry with id not less than given ID
+	size_t find(uint64_t id) const;
+	void removeEntry(size_t pos);
+	void prune(void);
+
+public:
+	// The index will be stored in file "<name>.index", cache files
+	// will be named "<name>-<id>.cache"
+	CacheIndex(const char *name, uint64_t limit);
+	~CacheIndex(void);
+
+	void entryName(StringBuffer &buf, uint64_t id) const;
+
+	// Mark the file as recently used. Returns 0 if the file is not
+	// in the index.
+	int touch(uint64_t id);
+
+	// Add newly written file to the index and delete old files if
+	// necessary. Returns 0 if the file does not fit the limit.
+	int add(uint64_t id, uint64_t size);
+	void remove(uint64_t id);
+
+	// Save the index if it was changed. Throws exception on error.
+	void save(void);
+};
+
+struct BundleEntry {
+	uint64_t hash, offset, size;
+	uint32_t nameOffset, nameLength;
+};
+
+// Memory mapped bundle of pre-decoded assets created by openorion2-pack.
+// Entry payloads use the same format as cache files.
+class AssetBundle {
+private:
+	const uint8_t *_map;
+	size_t _mapSize;
+	const BundleEntry *_entries;
+	const char *_names;
+	size_t _namesSize;
+	unsigned _count;
+
+	// Do NOT implement
+	AssetBundle(const AssetBundle &other);
+	const AssetBundle &operator=(const AssetBundle &other);
+
+protected:
+	// Check that all data files used to build the bundle are unchanged
+	int checkSources(void) const;
+
+public:
+	AssetBundle(void);
+	~AssetBundle(void);
+
+	// Returns 0 if the bundle does not exist, is damaged or was built
+	// from different data files
+	int open(const char *path);
+	void close(void);
+
+	// Returns NULL if the bundle has no entry with given name
+	const uint8_t *find(const char *name, size_t *size) const;
+};
+
+class BundleWriter {
+private:
+	File _file;
+	char *_path;
+	StringBuffer _tmpname;
+	BundleEntry *_entries;
+	unsigned _count, _size;
+	MemoryWriteStream _names;
+	CacheWriter _sources;
+	unsigned _sourceCount;
+
+	// Do NOT implement
+	BundleWriter(const BundleWriter &other);
+	const BundleWriter &operator=(const BundleWriter &other);
+
+protected:
+	void padFile(void);
+	void writeData(const void *data, size_t size);
+	void addEntry(const char *name, const void *data, size_t size);
+
+public:
+	explicit BundleWriter(const char *path);
+
+	// Unfinished bundle will be deleted
+	~BundleWriter(void);
+
+	// Record size of a data file, the bundle will be ignored if any
+	// of its source files change
+	void addSource(const char *name, uint64_t size);
+	void add(const char *name, const CacheWriter &data);
+
+	// Write bundle directory and move the file to its final location
+	void finish(void);
+};
+
+// 64-bit FNV-1a hash
+uint64_t cacheHash(const void *data, size_t size,
+	uint64_t seed = 0xcbf29ce484222325ULL);
+
+// Return path to a file in cache directory, the directory will be created
+// if necessary. Returns newly allocated string.
+char *cachePath(const char *filename);
+
+#endif
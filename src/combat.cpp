@@ -0,0 +1,355 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cstring>
+#include <stdexcept>
+#include "combat.h"
+
+#define COMBAT_MAX_ROUNDS 10
+#define COMBAT_MAX_TASKS 64
+// Hit chance in percent is base + (offense - defense) / scale
+#define COMBAT_HIT_BASE 50
+#define COMBAT_HIT_SCALE 2
+#define COMBAT_HIT_MIN 5
+#define COMBAT_HIT_MAX 95
+// Damage of one weapon hit before shields
+#define COMBAT_HIT_DAMAGE 8
+
+static const unsigned shieldAbsorption[MAX_SHIP_SHIELD_TYPES] = {
+	0, 1, 3, 5, 7, 10
+};
+
+// Seed of independent random stream for each engagement (splitmix64)
+static uint64_t combatSeed(uint64_t seed, uint64_t index) {
+	uint64_t ret = seed + (index + 1) * 0x9e3779b97f4a7c15ULL;
+
+	ret = (ret ^ (ret >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	ret = (ret ^ (ret >> 27)) * 0x94d049bb133111ebULL;
+	ret ^= ret >> 31;
+	return ret ? ret : 1;
+}
+
+// xorshift64*, state must be nonzero
+static inline uint64_t combatRandom(uint64_t *state) {
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 0x2545f4914f6cdd1dULL;
+}
+
+// Scale 32 random bits to range [0, limit)
+static inline unsigned randomRange(uint32_t value, unsigned limit) {
+	return ((uint64_t)value * limit) >> 32;
+}
+
+class CombatSimulator::SimTask : public Task {
+private:
+	const CombatSimulator *_sim;
+	uint64_t _seed;
+	unsigned _first, _count;
+
+protected:
+	void run(void);
+
+public:
+	unsigned long wins[COMBAT_SIDES], draws, losses[COMBAT_SIDES];
+
+	SimTask(void);
+
+	void setup(const CombatSimulator *sim, uint64_t seed, unsigned first,
+		unsigned count);
+	// Run the batch on the calling thread
+	void process(void);
+};
+
+CombatSimulator::SimTask::SimTask(void) : _sim(NULL), _seed(0), _first(0),
+	_count(0), draws(0) {
+
+	wins[0] = wins[1] = 0;
+	losses[0] = losses[1] = 0;
+}
+
+void CombatSimulator::SimTask::setup(const CombatSimulator *sim,
+	uint64_t seed, unsigned first, unsigned count) {
+
+	_sim = sim;
+	_seed = seed;
+	_first = first;
+	_count = count;
+}
+
+void CombatSimulator::SimTask::run(void) {
+	process();
+}
+
+void CombatSimulator::SimTask::process(void) {
+	unsigned i, j, lost[COMBAT_SIDES];
+
+	for (i = _first; i < _first + _count; i++) {
+		_sim->simulate(combatSeed(_seed, i), lost);
+
+		for (j = 0; j < COMBAT_SIDES; j++) {
+			losses[j] += lost[j];
+		}
+
+		if (lost[COMBAT_DEFENDER] == _sim->_shipCount[COMBAT_DEFENDER]
+			&& lost[COMBAT_ATTACKER] <
+			_sim->_shipCount[COMBAT_ATTACKER]) {
+			wins[COMBAT_ATTACKER]++;
+		} else if (lost[COMBAT_ATTACKER] ==
+			_sim->_shipCount[COMBAT_ATTACKER] &&
+			lost[COMBAT_DEFENDER] <
+			_sim->_shipCount[COMBAT_DEFENDER]) {
+			wins[COMBAT_DEFENDER]++;
+		} else {
+			// Survivors on both sides or mutual destruction
+			draws++;
+		}
+	}
+}
+
+CombatSimulator::CombatSimulator(const GameState *game) : _game(game) {
+	unsigned i;
+
+	for (i = 0; i < COMBAT_SIDES; i++) {
+		_ships[i] = NULL;
+		_shipCount[i] = 0;
+	}
+
+	try {
+		for (i = 0; i < COMBAT_SIDES; i++) {
+			_ships[i] = new Combatant[MAX_SHIPS];
+		}
+	} catch (...) {
+		for (i = 0; i < COMBAT_SIDES; i++) {
+			delete[] _ships[i];
+		}
+
+		throw;
+	}
+}
+
+CombatSimulator::~CombatSimulator(void) {
+	unsigned i;
+
+	for (i = 0; i < COMBAT_SIDES; i++) {
+		delete[] _ships[i];
+	}
+}
+
+void CombatSimulator::clear(void) {
+	unsigned i;
+
+	for (i = 0; i < COMBAT_SIDES; i++) {
+		_shipCount[i] = 0;
+	}
+}
+
+void CombatSimulator::addShip(unsigned side, unsigned ship_id) {
+	unsigned i, damage;
+	int hull;
+	ShipStrength cur;
+	const Ship *sptr;
+	Combatant *ptr;
+
+	if (side >= COMBAT_SIDES) {
+		throw std::out_of_range("Invalid combat side");
+	}
+
+	if (_shipCount[side] >= MAX_SHIPS) {
+		throw std::length_error("Too many ships in combat");
+	}
+
+	_game->evalShipStrength(&ship_id, 1, 0, &cur);
+	sptr = _game->_ships + ship_id;
+	ptr = _ships[side] + _shipCount[side];
+	ptr->offense = cur.beamOffense;
+	ptr->defense = cur.beamDefense;
+	ptr->shield = shieldAbsorption[sptr->design.shield];
+	ptr->shots = 0;
+	// Drive HP scales with hull size and Reinforced Hull and drops with
+	// drive damage. Armor and structure damage is taken off the rest.
+	hull = 2 * cur.driveHP * (sptr->design.armor + 2);
+	damage = sptr->armorDamage + sptr->structureDamage;
+	ptr->hull = MAX(hull - (int)damage, 1);
+
+	if (sptr->design.type == COMBAT_SHIP) {
+		for (i = 0; i < MAX_SHIP_WEAPONS; i++) {
+			if (sptr->design.weapons[i].type > 0) {
+				ptr->shots += sptr->design.weapons[i].workingCount;
+			}
+		}
+	}
+
+	_shipCount[side]++;
+}
+
+void CombatSimulator::addFleet(unsigned side, const Fleet *flt) {
+	size_t i;
+
+	for (i = 0; i < flt->shipCount(); i++) {
+		addShip(side, flt->getShipID(i));
+	}
+}
+
+void CombatSimulator::addOrbitingFleets(const Star *star, unsigned defender) {
+	const BilistNode<Fleet> *node;
+
+	for (node = star->getOrbitingFleets(); node; node = node->next()) {
+		if (!node->data) {
+			continue;
+		}
+
+		if (node->data->getOwner() == defender) {
+			addFleet(COMBAT_DEFENDER, node->data);
+		} else {
+			addFleet(COMBAT_ATTACKER, node->data);
+		}
+	}
+}
+
+void CombatSimulator::simulate(uint64_t seed, unsigned *losses) const {
+	unsigned i, j, k, side, enemy, round, chance, target, count;
+	unsigned damage[COMBAT_SIDES][MAX_SHIPS];
+	unsigned alive[COMBAT_SIDES][MAX_SHIPS], aliveCount[COMBAT_SIDES];
+	int tmp;
+	uint64_t rnd;
+	const Combatant *src, *dest;
+
+	for (side = 0; side < COMBAT_SIDES; side++) {
+		aliveCount[side] = _shipCount[side];
+
+		for (i = 0; i < _shipCount[side]; i++) {
+			alive[side][i] = i;
+			damage[side][i] = 0;
+		}
+	}
+
+	for (round = 0; round < COMBAT_MAX_ROUNDS; round++) {
+		if (!aliveCount[COMBAT_ATTACKER] ||
+			!aliveCount[COMBAT_DEFENDER]) {
+			break;
+		}
+
+		// Both sides fire at once, damage is applied after the volley
+		for (side = 0; side < COMBAT_SIDES; side++) {
+			enemy = 1 - side;
+
+			for (i = 0; i < aliveCount[side]; i++) {
+				src = _ships[side] + alive[side][i];
+
+				for (j = 0; j < src->shots; j++) {
+					// Target and hit roll from one number
+					rnd = combatRandom(&seed);
+					k = randomRange(rnd >> 32, aliveCount[enemy]);
+					target = alive[enemy][k];
+					dest = _ships[enemy] + target;
+					tmp = COMBAT_HIT_BASE + (src->offense -
+						dest->defense) / COMBAT_HIT_SCALE;
+					tmp = MAX(tmp, COMBAT_HIT_MIN);
+					chance = MIN(tmp, COMBAT_HIT_MAX);
+
+					if (randomRange(rnd, 100) < chance &&
+						dest->shield < COMBAT_HIT_DAMAGE) {
+						damage[enemy][target] +=
+							COMBAT_HIT_DAMAGE -
+							dest->shield;
+					}
+				}
+			}
+		}
+
+		for (side = 0; side < COMBAT_SIDES; side++) {
+			for (i = 0, count = 0; i < aliveCount[side]; i++) {
+				target = alive[side][i];
+
+				if (damage[side][target] < _ships[side][target].hull) {
+					alive[side][count++] = target;
+				}
+			}
+
+			aliveCount[side] = count;
+		}
+	}
+
+	for (side = 0; side < COMBAT_SIDES; side++) {
+		losses[side] = _shipCount[side] - aliveCount[side];
+	}
+}
+
+void CombatSimulator::estimate(unsigned simulations, uint64_t seed,
+	CombatOdds *out, WorkerPool *pool) const {
+
+	unsigned i, first, count, taskCount;
+	unsigned long wins[COMBAT_SIDES] = {0}, losses[COMBAT_SIDES] = {0};
+	unsigned long draws = 0;
+	SimTask tasks[COMBAT_MAX_TASKS];
+
+	memset(out, 0, sizeof(CombatOdds));
+
+	if (!simulations) {
+		return;
+	}
+
+	// Engagement seeds depend only on the index, batching does not
+	// change the results
+	taskCount = pool ? MIN(simulations, COMBAT_MAX_TASKS) : 1;
+
+	for (i = 0, first = 0; i < taskCount; i++, first += count) {
+		count = simulations / taskCount;
+		count += i < simulations % taskCount ? 1 : 0;
+		tasks[i].setup(this, seed, first, count);
+	}
+
+	if (!pool) {
+		tasks[0].process();
+	} else {
+		try {
+			for (i = 0; i < taskCount; i++) {
+				pool->add(tasks + i);
+			}
+		} catch (...) {
+			// Queued tasks must finish before the array goes away
+			try {
+				pool->wait();
+			} catch (...) {
+
+			}
+
+			throw;
+		}
+
+		pool->wait();
+	}
+
+	for (i = 0; i < taskCount; i++) {
+		wins[COMBAT_ATTACKER] += tasks[i].wins[COMBAT_ATTACKER];
+		wins[COMBAT_DEFENDER] += tasks[i].wins[COMBAT_DEFENDER];
+		losses[COMBAT_ATTACKER] += tasks[i].losses[COMBAT_ATTACKER];
+		losses[COMBAT_DEFENDER] += tasks[i].losses[COMBAT_DEFENDER];
+		draws += tasks[i].draws;
+	}
+
+	out->simulations = simulations;
+	out->attackerWins = double(wins[COMBAT_ATTACKER]) / simulations;
+	out->defenderWins = double(wins[COMBAT_DEFENDER]) / simulations;
+	out->draws = double(draws) / simulations;
+	out->attackerLosses = double(losses[COMBAT_ATTACKER]) / simulations;
+	out->defenderLosses = double(losses[COMBAT_DEFENDER]) / simulations;
+}
@@ -0,0 +1,86 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef COMBAT_H_
+#define COMBAT_H_
+
+#include "gamestate.h"
+
+#define COMBAT_ATTACKER 0
+#define COMBAT_DEFENDER 1
+#define COMBAT_SIDES 2
+
+// Estimated battle outcome
+struct CombatOdds {
+	unsigned simulations;
+	// Probabilities of each side destroying all enemy ships. Battles
+	// which end with survivors on both sides or with both sides
+	// destroyed are draws.
+	double attackerWins, defenderWins, draws;
+	// Expected number of destroyed ships
+	double attackerLosses, defenderLosses;
+};
+
+// Monte Carlo battle outcome estimator. Each engagement is a simplified
+// beam combat: every round, all ships fire their working weapon mounts
+// at random enemy ships. Hit chance depends on beam offense and defense,
+// shields reduce hit damage and ship durability scales with hull size
+// and armor.
+class CombatSimulator {
+private:
+	struct Combatant {
+		unsigned hull, shots, shield;
+		int offense, defense;
+	};
+
+	class SimTask;
+
+	const GameState *_game;
+	Combatant *_ships[COMBAT_SIDES];
+	unsigned _shipCount[COMBAT_SIDES];
+
+	// Do NOT implement
+	CombatSimulator(const CombatSimulator &other);
+	const CombatSimulator &operator=(const CombatSimulator &other);
+
+protected:
+	// Run one engagement, returns the number of destroyed ships of each
+	// side in losses
+	void simulate(uint64_t seed, unsigned *losses) const;
+
+public:
+	explicit CombatSimulator(const GameState *game);
+	~CombatSimulator(void);
+
+	void clear(void);
+	void addShip(unsigned side, unsigned ship_id);
+	void addFleet(unsigned side, const Fleet *flt);
+	// Add all fleets orbiting the star. Fleets of the given owner
+	// join the defender side, everybody else attacks.
+	void addOrbitingFleets(const Star *star, unsigned defender);
+
+	// Run the given number of engagements. With a worker pool, batches
+	// of engagements run in parallel. Creating threads costs more than
+	// a small estimate, pass a pool which is kept around. Results depend
+	// only on the ships and seed, not on thread count or scheduling.
+	void estimate(unsigned simulations, uint64_t seed, CombatOdds *out,
+		WorkerPool *pool = NULL) const;
+};
+
+#endif
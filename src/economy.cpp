@@ -0,0 +1,250 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cstring>
+#include <stdexcept>
+#include "economy.h"
+
+#define ECONOMY_JOB_COUNT (SCIENTIST + 1)
+
+struct BuildingOutput {
+	uint8_t building;
+	uint8_t food, industry, research;
+};
+
+// Flat bonuses on top of per-colonist rates which already include
+// per-colonist building bonuses. Values follow the building descriptions,
+// they have not been checked against savegames yet.
+static const BuildingOutput buildingOutputs[] = {
+	{BUILDING_HYDROPONIC_FARM, 2, 0, 0},
+	{BUILDING_SUBTERRANEAN_FARMS, 4, 0, 0},
+	{BUILDING_AUTOMATED_FACTORY, 0, 5, 0},
+	{BUILDING_ROBO_MINER_PLANT, 0, 10, 0},
+	{BUILDING_DEEP_CORE_MINE, 0, 15, 0},
+	{BUILDING_RESEARCH_LAB, 0, 0, 5},
+	{BUILDING_SUPERCOMPUTER, 0, 0, 10},
+	{BUILDING_GALACTIC_CYBERNET, 0, 0, 15},
+	{BUILDING_AUTOLAB, 0, 0, 30},
+	{BUILDING_NONE, 0, 0, 0}
+};
+
+static int applyMorale(int value, int morale) {
+	return value + value * morale / 100;
+}
+
+class EconomyEvaluator::PlayerTask : public Task {
+private:
+	EconomyEvaluator *_parent;
+	unsigned _player;
+
+protected:
+	void run(void);
+
+public:
+	PlayerTask(void);
+
+	void setup(EconomyEvaluator *parent, unsigned player_id);
+};
+
+EconomyEvaluator::PlayerTask::PlayerTask(void) : _parent(NULL), _player(0) {
+
+}
+
+void EconomyEvaluator::PlayerTask::setup(EconomyEvaluator *parent,
+	unsigned player_id) {
+
+	_parent = parent;
+	_player = player_id;
+}
+
+void EconomyEvaluator::PlayerTask::run(void) {
+	_parent->evalPlayer(_player);
+}
+
+EconomyEvaluator::EconomyEvaluator(const GameState *game) : _game(game) {
+	memset(&_colonies, 0, sizeof(_colonies));
+	memset(_players, 0, sizeof(_players));
+	memset(_order, 0, sizeof(_order));
+	memset(_starts, 0, sizeof(_starts));
+}
+
+EconomyEvaluator::~EconomyEvaluator(void) {
+
+}
+
+void EconomyEvaluator::groupColonies(void) {
+	unsigned i, owner, pos[MAX_PLAYERS + 1];
+	const ColonyTable &table = _game->colonyTable();
+
+	memset(_starts, 0, sizeof(_starts));
+
+	for (i = 0; i < _game->_colonyCount; i++) {
+		if (table.planet[i] >= 0 && table.owner[i] < MAX_PLAYERS) {
+			_starts[table.owner[i] + 1]++;
+		}
+	}
+
+	for (i = 0; i < MAX_PLAYERS; i++) {
+		_starts[i + 1] += _starts[i];
+	}
+
+	memcpy(pos, _starts, sizeof(pos));
+
+	for (i = 0; i < _game->_colonyCount; i++) {
+		owner = table.owner[i];
+
+		if (table.planet[i] >= 0 && owner < MAX_PLAYERS) {
+			_order[pos[owner]++] = i;
+		}
+	}
+}
+
+void EconomyEvaluator::evalColony(unsigned colony_id) {
+	unsigned i, jobs[ECONOMY_JOB_COUNT] = {0};
+	int food, industry, research;
+	const Colonist *ptr;
+	const BuildingOutput *bptr;
+	const Colony *cptr = _game->_colonies + colony_id;
+
+	for (i = 0, ptr = cptr->colonists; i < cptr->population; i++, ptr++) {
+		if ((ptr->flags & ColonistFlags::WORKING) &&
+			ptr->job < ECONOMY_JOB_COUNT) {
+			jobs[ptr->job]++;
+		}
+	}
+
+	// Farmer output is stored in half-units
+	food = jobs[FARMER] * cptr->food_per_farmer;
+	industry = jobs[WORKER] * cptr->industry_per_worker;
+	research = jobs[SCIENTIST] * cptr->research_per_scientist;
+
+	for (bptr = buildingOutputs; bptr->building; bptr++) {
+		if (cptr->buildings[bptr->building]) {
+			food += 2 * bptr->food;
+			industry += bptr->industry;
+			research += bptr->research;
+		}
+	}
+
+	food = food / 2 + cptr->replicated_food;
+	industry += cptr->recycled_industry;
+	// Morale does not affect food production
+	industry = applyMorale(industry, cptr->morale) - cptr->pollution;
+	research = applyMorale(research, cptr->morale);
+
+	_colonies.food[colony_id] = food;
+	_colonies.industry[colony_id] = MAX(industry, 0);
+	_colonies.research[colony_id] = research;
+}
+
+void EconomyEvaluator::evalPlayer(unsigned player_id) {
+	unsigned i, id;
+	PlayerEconomy *pptr = _players + player_id;
+
+	memset(pptr, 0, sizeof(PlayerEconomy));
+
+	for (i = _starts[player_id]; i < _starts[player_id + 1]; i++) {
+		id = _order[i];
+		evalColony(id);
+		pptr->food += _colonies.food[id];
+		pptr->industry += _colonies.industry[id];
+		pptr->research += _colonies.research[id];
+		pptr->foodConsumption +=
+			_game->_colonies[id].food_consumption;
+	}
+}
+
+void EconomyEvaluator::evaluate(WorkerPool *pool) {
+	unsigned i;
+	PlayerTask tasks[MAX_PLAYERS];
+
+	groupColonies();
+
+	if (!pool) {
+		for (i = 0; i < MAX_PLAYERS; i++) {
+			evalPlayer(i);
+		}
+
+		return;
+	}
+
+	// Each task writes only its own colony and player entries
+	for (i = 0; i < MAX_PLAYERS; i++) {
+		tasks[i].setup(this, i);
+		pool->add(tasks + i);
+	}
+
+	pool->wait();
+}
+
+void EconomyEvaluator::evaluatePlayer(unsigned player_id) {
+	if (player_id >= MAX_PLAYERS) {
+		throw std::out_of_range("Invalid player ID");
+	}
+
+	groupColonies();
+	evalPlayer(player_id);
+}
+
+const ColonyEconomy &EconomyEvaluator::colonies(void) const {
+	return _colonies;
+}
+
+const PlayerEconomy &EconomyEvaluator::player(unsigned player_id) const {
+	if (player_id >= MAX_PLAYERS) {
+		throw std::out_of_range("Invalid player ID");
+	}
+
+	return _players[player_id];
+}
+
+void EconomyEvaluator::verify(EconomyMismatch *out) const {
+	unsigned i, id;
+	const Colony *cptr;
+	const Player *pptr;
+	const PlayerEconomy *eptr;
+
+	memset(out, 0, sizeof(EconomyMismatch));
+
+	for (i = 0; i < _starts[MAX_PLAYERS]; i++) {
+		id = _order[i];
+		cptr = _game->_colonies + id;
+		out->colonies++;
+		out->food += _colonies.food[id] != cptr->total_food;
+		out->industry += _colonies.industry[id] != cptr->net_industry;
+		out->research += _colonies.research[id] !=
+			cptr->total_research;
+	}
+
+	for (i = 0; i < _game->_playerCount && i < MAX_PLAYERS; i++) {
+		pptr = _game->_players + i;
+		eptr = _players + i;
+
+		if (pptr->eliminated) {
+			continue;
+		}
+
+		out->players++;
+		out->playerFood += eptr->food != pptr->foodProduced;
+		out->playerIndustry += eptr->industry !=
+			pptr->industryProduced;
+		out->playerResearch += eptr->research !=
+			pptr->researchProduced;
+	}
+}
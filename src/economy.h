@@ -0,0 +1,90 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ECONOMY_H_
+#define ECONOMY_H_
+
+#include "gamestate.h"
+
+// Output of all colonies indexed by colony ID
+struct ColonyEconomy {
+	int16_t food[MAX_COLONIES];
+	// Net industry after pollution
+	int16_t industry[MAX_COLONIES];
+	int16_t research[MAX_COLONIES];
+};
+
+struct PlayerEconomy {
+	long food, industry, research;
+	long foodConsumption;
+};
+
+// Number of computed values which differ from savegame records
+struct EconomyMismatch {
+	unsigned colonies, players;
+	unsigned food, industry, research;
+	unsigned playerFood, playerIndustry, playerResearch;
+};
+
+// Colony production estimate. Per-colonist output rates stored in colony
+// records are multiplied by the number of working farmers, workers and
+// scientists, then flat building bonuses, morale and pollution are
+// applied. Results are summed per player. BC revenue is not evaluated
+// until the tax rules are known. The flat bonuses are not verified
+// against the original game, use verify() (savebench -e) to measure how
+// far the estimate is from saved values.
+class EconomyEvaluator {
+private:
+	class PlayerTask;
+
+	const GameState *_game;
+	ColonyEconomy _colonies;
+	PlayerEconomy _players[MAX_PLAYERS];
+	// Colony IDs grouped by owner in ascending order
+	uint16_t _order[MAX_COLONIES];
+	unsigned _starts[MAX_PLAYERS + 1];
+
+	// Do NOT implement
+	EconomyEvaluator(const EconomyEvaluator &other);
+	const EconomyEvaluator &operator=(const EconomyEvaluator &other);
+
+protected:
+	void groupColonies(void);
+	void evalColony(unsigned colony_id);
+	void evalPlayer(unsigned player_id);
+
+public:
+	explicit EconomyEvaluator(const GameState *game);
+	~EconomyEvaluator(void);
+
+	// Evaluate all colonies. With a worker pool, each player is
+	// evaluated in a separate task. The whole pass is too short to pay
+	// for creating new threads, pass a pool which is kept around.
+	void evaluate(WorkerPool *pool = NULL);
+	// Evaluate colonies of a single player only
+	void evaluatePlayer(unsigned player_id);
+
+	const ColonyEconomy &colonies(void) const;
+	const PlayerEconomy &player(unsigned player_id) const;
+
+	// Compare the last results with values stored in game records
+	void verify(EconomyMismatch *out) const;
+};
+
+#endif
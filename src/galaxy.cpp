@@ -20,6 +20,7 @@
 #include <cstring>
 #include <cmath>
 #include "screen.h"
+#include "system.h"
 #include "guimisc.h"
 #include "mainmenu.h"
 #include "lang.h"
@@ -27,10 +28,17 @@
 #include "officer.h"
 #include "tech.h"
 #include "info.h"
+#include "ai.h"
 #include "galaxy.h"
 
 #define STARSEL_FRAMECOUNT 6
 
+// Largest distance in pixels between object position and any pixel of its
+// sprite on the starmap, minimap and main galaxy view
+#define STARMAP_HIT_MARGIN 5
+#define MINIMAP_HIT_MARGIN 32
+#define GALAXY_HIT_MARGIN 64
+
 #define ASSET_GALAXY_GAME_BUTTON 1
 #define ASSET_GALAXY_TURN_BUTTON 2
 #define ASSET_GALAXY_COLONIES_BUTTON 3
@@ -252,6 +260,22 @@ unsigned StarmapWidget::starY(unsigned y) const {
 	return getY() + (y * height()) / _game->_galaxy.height;
 }
 
+void StarmapWidget::galaxyArea(int x, int y, unsigned margin, int *rx,
+	int *ry, unsigned *rw, unsigned *rh) const {
+
+	int ex, ey, m = margin;
+	int gw = _game->_galaxy.width, gh = _game->_galaxy.height;
+
+	x -= getX();
+	y -= getY();
+	*rx = ((x - m) * gw) / (int)width() - 1;
+	*ry = ((y - m) * gh) / (int)height() - 1;
+	ex = ((x + m + 1) * gw) / (int)width() + 1;
+	ey = ((y + m + 1) * gh) / (int)height() + 1;
+	*rw = ex - *rx + 1;
+	*rh = ey - *ry + 1;
+}
+
 const Image *StarmapWidget::getStarSprite(const Star *s) {
 	unsigned color;
 
@@ -280,16 +304,21 @@ void StarmapWidget::drawStar(int x, int y, const Star *s, unsigned curtick) {
 }
 
 int StarmapWidget::findStar(int x, int y) const {
-	unsigned i, px, py;
+	unsigned i, px, py, gw, gh, count;
+	int gx, gy;
+	unsigned stars[MAX_STARS];
 
-	for (i = 0; i < _game->_starSystemCount; i++) {
-		const Star *ptr = _game->_starSystems + i;
+	galaxyArea(x, y, STARMAP_HIT_MARGIN, &gx, &gy, &gw, &gh);
+	count = _game->findStars(gx, gy, gw, gh, stars, MAX_STARS);
+
+	for (i = 0; i < count; i++) {
+		const Star *ptr = _game->_starSystems + stars[i];
 
 		px = starX(ptr->x);
 		py = starY(ptr->y);
 
 		if (isInRect(x, y, px - 4, py - 4, 9, 9)) {
-			return i;
+			return stars[i];
 		}
 	}
 
@@ -559,26 +588,28 @@ void GalaxyMinimapWidget::drawStar(int x, int y, const Star *s,
 void GalaxyMinimapWidget::findObject(unsigned x, unsigned y, int *rstar,
 	Fleet **rfleet, SelectionFilter fleetFilter) {
 
-	unsigned i, px, py;
+	unsigned i, px, py, gw, gh, count;
+	int gx, gy;
 	const BilistNode<Fleet> *fnode;
+	unsigned stars[MAX_STARS];
+	Fleet *fleets[MAX_SHIPS];
 
 	*rstar = -1;
 	*rfleet = NULL;
-	fnode = _game->getMovingFleets();
-
-	for (; fnode; fnode = fnode->next()) {
-		if (!fnode->data) {
-			continue;
-		}
+	galaxyArea(x, y, MINIMAP_HIT_MARGIN, &gx, &gy, &gw, &gh);
+	count = _game->findMovingFleets(gx, gy, gw, gh, fleets, MAX_SHIPS);
 
-		if (touchesFleet(x, y, fnode->data, fleetFilter)) {
-			*rfleet = fnode->data;
+	for (i = 0; i < count; i++) {
+		if (touchesFleet(x, y, fleets[i], fleetFilter)) {
+			*rfleet = fleets[i];
 			return;
 		}
 	}
 
-	for (i = 0; i < _game->_starSystemCount; i++) {
-		const Star *ptr = _game->_starSystems + i;
+	count = _game->findStars(gx, gy, gw, gh, stars, MAX_STARS);
+
+	for (i = 0; i < count; i++) {
+		const Star *ptr = _game->_starSystems + stars[i];
 
 		fnode = ptr->getOrbitingFleets();
 
@@ -602,7 +633,7 @@ void GalaxyMinimapWidget::findObject(unsigned x, unsigned y, int *rstar,
 		py = starY(ptr->y);
 
 		if (isInRect(x, y, px - 4, py - 4, 9, 9)) {
-			*rstar = i;
+			*rstar = stars[i];
 			return;
 		}
 	}
@@ -1374,7 +1405,7 @@ void StarSystemWidget::handleMouseUp(int x, int y, unsigned button) {
 
 GalaxyView::GalaxyView(GameState *game) : _game(game), _zoom(0), _zoomX(0),
 	_zoomY(0), _startTick(0), _selTick(0), _curStar(-1), _activePlayer(-1),
-	_curFleet(NULL) {
+	_curFleet(NULL), _routes(game) {
 
 	uint8_t tpal[PALSIZE];
 	const uint8_t *pal;
@@ -1603,6 +1634,17 @@ int GalaxyView::transformY(int y) const {
 	return 21 + 10 * (y - _zoomY) / galaxySizeFactors[_zoom];
 }
 
+void GalaxyView::galaxyArea(int x, int y, unsigned margin, int *rx, int *ry,
+	unsigned *rw, unsigned *rh) const {
+
+	int m = margin, factor = galaxySizeFactors[_zoom];
+
+	*rx = _zoomX + ((x - m - 21) * factor) / 10 - factor;
+	*ry = _zoomY + ((y - m - 21) * factor) / 10 - factor;
+	*rw = ((2 * m + 1) * factor) / 10 + 2 * factor + 1;
+	*rh = *rw;
+}
+
 int GalaxyView::transformFleetX(const Fleet *f) const {
 	const Image *img;
 	unsigned size;
@@ -1725,27 +1767,29 @@ void GalaxyView::setPlayer(int player, int a, int b) {
 void GalaxyView::findObject(unsigned x, unsigned y, int *rstar,
 	Fleet **rfleet) {
 
-	unsigned i, sx, sy;
+	unsigned i, sx, sy, gw, gh, count;
+	int gx, gy;
 	const Image *img;
 	const BilistNode<Fleet> *fnode;
+	unsigned stars[MAX_STARS];
+	Fleet *fleets[MAX_SHIPS];
 
 	*rstar = -1;
 	*rfleet = NULL;
-	fnode = _game->getMovingFleets();
+	galaxyArea(x, y, GALAXY_HIT_MARGIN, &gx, &gy, &gw, &gh);
+	count = _game->findMovingFleets(gx, gy, gw, gh, fleets, MAX_SHIPS);
 
-	for (; fnode; fnode = fnode->next()) {
-		if (!fnode->data) {
-			continue;
-		}
-
-		if (touchesFleet(x, y, fnode->data)) {
-			*rfleet = fnode->data;
+	for (i = 0; i < count; i++) {
+		if (touchesFleet(x, y, fleets[i])) {
+			*rfleet = fleets[i];
 			return;
 		}
 	}
 
-	for (i = 0; i < _game->_starSystemCount; i++) {
-		const Star *ptr = _game->_starSystems + i;
+	count = _game->findStars(gx, gy, gw, gh, stars, MAX_STARS);
+
+	for (i = 0; i < count; i++) {
+		const Star *ptr = _game->_starSystems + stars[i];
 
 		fnode = ptr->getOrbitingFleets();
 
@@ -1770,7 +1814,7 @@ void GalaxyView::findObject(unsigned x, unsigned y, int *rstar,
 		sy = transformY(ptr->y) - img->height() / 2;
 
 		if (isInRect(x, y, sx, sy, img->width(), img->height())) {
-			*rstar = i;
+			*rstar = stars[i];
 			return;
 		}
 	}
@@ -1812,7 +1856,7 @@ void GalaxyView::leaveGalaxyMap(int x, int y, int arg) {
 }
 
 void GalaxyView::drawStar(const Star *s, Font *fnt, unsigned curtick) {
-	int x, y, xoff, idx;
+	int x, y, xoff;
 	unsigned i, owner, color, width, tmp, step, total = 0, frame = 0;
 	StarKnowledge explored;
 	const Image *img;
@@ -1837,9 +1881,7 @@ void GalaxyView::drawStar(const Star *s, Font *fnt, unsigned curtick) {
 
 		if (pptr->colony >= 0) {
 			owner = _game->_colonies[pptr->colony].owner;
-			idx = _activePlayer;
-
-			if (!_game->_players[idx].isPlayerVisible(owner)) {
+			if (!_game->isPlayerVisible(_activePlayer, owner)) {
 				continue;
 			}
 
@@ -1899,8 +1941,11 @@ void GalaxyView::drawStar(const Star *s, Font *fnt, unsigned curtick) {
 }
 
 void GalaxyView::drawFleet(const Fleet *f, unsigned curtick) {
-	unsigned frame = 0;
+	unsigned frame = 0, speed, eta;
+	int x, y;
 	const Image *img;
+	const Star *dest;
+	StringBuffer buf;
 
 	img = getFleetSprite(f);
 
@@ -1909,7 +1954,25 @@ void GalaxyView::drawFleet(const Fleet *f, unsigned curtick) {
 			img->frameCount());
 	}
 
-	img->draw(transformFleetX(f), transformFleetY(f), frame);
+	x = transformFleetX(f);
+	y = transformFleetY(f);
+	img->draw(x, y, frame);
+	dest = f->getDestStar();
+
+	// Show ETA of the highlighted fleet on its way to destination
+	if (f != _curFleet || !dest || f->getOwner() != _activePlayer ||
+		(f->getStatus() != InTransit &&
+		f->getStatus() != LeavingOrbit)) {
+		return;
+	}
+
+	speed = MAX(f->getWarpSpeed(), 1);
+	_routes.prepare(speed);
+	eta = _routes.eta(f->getX(), f->getY(), dest - _game->_starSystems,
+		speed);
+	buf.printf(gameLang->hstrings(HSTR_FLEET_OFFICER_ETA), eta);
+	drawETA(x + img->width() / 2, y + img->height() + 4,
+		FONT_COLOR_FLEETLIST_SPECDAMAGE, buf.c_str());
 }
 
 void GalaxyView::redrawSidebar(unsigned curtick) {
@@ -2149,7 +2212,27 @@ void GalaxyView::clickZoomInButton(int x, int y, int arg) STUB(this)
 
 void GalaxyView::clickZoomOutButton(int x, int y, int arg) STUB(this)
 
-void GalaxyView::clickTurnButton(int x, int y, int arg) STUB(this)
+void GalaxyView::clickTurnButton(int x, int y, int arg) {
+	AIPlanner planner(_game);
+
+	char *path = NULL;
+
+	// FIXME: Fleet orders need movement processing, implement the rest
+	// of the turn
+	planner.plan();
+	planner.apply();
+
+	// Saving runs in background, write errors are reported on the next
+	// autosave
+	try {
+		path = configPath(SAVEGAME_AUTOSAVE_FILE);
+		_game->autosave(path);
+	} catch (std::exception &e) {
+		fprintf(stderr, "Autosave failed: %s\n", e.what());
+	}
+
+	delete[] path;
+}
 
 void GalaxyView::clickTreasuryInfo(int x, int y, int arg) STUB(this)
 
@@ -2311,12 +2394,14 @@ PlanetsListView::PlanetsListView(GameState *game, int activePlayer) :
 	_enemyFilter(NULL), _gravityFilter(NULL), _envFilter(NULL),
 	_mineralFilter(NULL), _rangeFilter(NULL), _colonyToggle(NULL),
 	_outpostToggle(NULL), _scrollgrab(0), _curslot(-1),
-	_activePlayer(activePlayer), _planetCount(0) {
+	_activePlayer(activePlayer), _filter(game, activePlayer),
+	_planetCount(0) {
 
 	unsigned i, j, k, color;
 	int dest, *shiplist;
 	ToggleWidget *shipToggle;
 	const uint8_t *pal;
+	const ShipTable &ships = _game->shipTable();
 
 	for (i = 0; i < MAX_PLANETS; i++) {
 		_colonyShips[i] = _outpostShips[i] = -1;
@@ -2336,19 +2421,20 @@ PlanetsListView::PlanetsListView(GameState *game, int activePlayer) :
 	}
 
 	initWidgets();
+	_filter.update();
 	changeFilter(0, 0, 0);
 
 	for (i = 0; i < _game->_shipCount; i++) {
 		const Ship *sptr = _game->_ships + i;
 
-		if (!sptr->isActive()) {
+		if (ships.status[i] > ShipState::LeavingOrbit) {
 			continue;
 		}
 
-		if (sptr->design.type == ShipType::COLONY_SHIP) {
+		if (ships.type[i] == ShipType::COLONY_SHIP) {
 			shiplist = _colonyShips;
 			shipToggle = _colonyToggle;
-		} else if (sptr->design.type == ShipType::OUTPOST_SHIP) {
+		} else if (ships.type[i] == ShipType::OUTPOST_SHIP) {
 			shiplist = _outpostShips;
 			shipToggle = _outpostToggle;
 		} else {
@@ -2792,110 +2878,40 @@ void PlanetsListView::clickSlot(int x, int y, int arg) {
 }
 
 void PlanetsListView::changeFilter(int x, int y, int arg) {
-	unsigned i, j, count, climate;
-	int f_enemy, f_gravity, f_env, f_mineral, f_range;
-	int owner;
-	const Planet *ptr;
-	const Star *sptr;
-	const Player *player = _game->_players + _activePlayer;
-	const BilistNode<Fleet> *node;
-
-	f_enemy = _enemyFilter->value();
-	f_gravity = _gravityFilter->value();
-	f_env = _envFilter->value();
-	f_mineral = _mineralFilter->value();
-	f_range = _rangeFilter->value();
+	unsigned flags = 0;
 
-	if (f_range) {
-		_rangeFilter->setValue(0);
-		new MessageBoxWindow(this, "Range filter not implemented");
+	if (_enemyFilter->value()) {
+		flags |= 1 << PLANET_FILTER_NO_ENEMY;
 	}
 
-	for (i = 0, count = 0; i < _game->_starSystemCount; i++) {
-		sptr = _game->_starSystems + i;
-
-		if (_game->isStarExplored(sptr, _activePlayer) < STAR_CHARTED) {
-			continue;
-		}
-
-		if (f_enemy) {
-			// Hostile colony in this star system
-			if (sptr->hasColony & ~(1 << _activePlayer)) {
-				continue;
-			}
-
-			node = sptr->getOrbitingFleets();
-
-			for (; node; node = node->next()) {
-				if (!node->data) {
-					continue;
-				}
-
-				if (node->data->getOwner() != _activePlayer) {
-					break;
-				}
-			}
-
-			// Hostile fleet orbiting star
-			// FIXME: ignore hidden fleets (known but unvisited
-			// star)
-			if (node) {
-				continue;
-			}
-		}
-
-		// FIXME: Implement range filter
-
-		for (j = 0; j < MAX_ORBITS; j++) {
-			if (sptr->planetIndex[j] < 0) {
-				continue;
-			}
-
-			ptr = _game->_planets + sptr->planetIndex[j];
-			owner = -1;
-
-			if (ptr->colony >= 0) {
-				owner = _game->_colonies[ptr->colony].owner;
-			}
-
-			// Ignore invalid and own planets
-			if (ptr->type != PlanetType::HABITABLE ||
-				owner == _activePlayer) {
-				continue;
-			}
-
-			if (f_gravity &&
-				player->gravityPenalty(ptr->gravity) < 0) {
-				continue;
-			}
-
-			climate = _game->planetClimate(sptr->planetIndex[j]);
+	if (_gravityFilter->value()) {
+		flags |= 1 << PLANET_FILTER_GRAVITY;
+	}
 
-			if (f_env && climate < PlanetClimate::DESERT) {
-				continue;
-			}
+	if (_envFilter->value()) {
+		flags |= 1 << PLANET_FILTER_CLIMATE;
+	}
 
-			if (f_mineral &&
-				ptr->minerals < PlanetMinerals::ABUNDANT) {
-				continue;
-			}
+	if (_mineralFilter->value()) {
+		flags |= 1 << PLANET_FILTER_MINERALS;
+	}
 
-			_planets[count++] = sptr->planetIndex[j];
-		}
+	if (_rangeFilter->value()) {
+		flags |= 1 << PLANET_FILTER_RANGE;
 	}
 
-	_planetCount = count;
+	_planetCount = _filter.filter(flags, _planets);
 	_scroll->setRange(_planetCount);
 	changeSort(0, 0, 0);
 }
 
 void PlanetsListView::changeSort(int x, int y, int arg) {
-	gamestate_cmp_func cmplist[3] = {
-		cmpPlanetClimate, cmpPlanetMinerals, cmpPlanetMaxPop
+	gamestate_key_func keylist[3] = {
+		keyPlanetClimate, keyPlanetMinerals, keyPlanetMaxPop
 	};
 
 	_game->sort_ids(_planets, _planetCount, _activePlayer,
-		cmplist[_sortChoice->value()]);
+		keylist[_sortChoice->value()]);
 }
 
 // FIXME: Implement sending colony and outpost ships
@@ -2993,6 +3009,24 @@ void MainMenuWindow::initWidgets(const uint8_t *pal) {
 
 void MainMenuWindow::newGame(int x, int y, int arg) STUB(_parent)
 
+void MainMenuWindow::saveGame(int x, int y, int arg) {
+	char *path = NULL;
+
+	try {
+		path = configPath(SAVEGAME_QUICKSAVE_FILE);
+		_game->save(path);
+	} catch (std::exception &e) {
+		fprintf(stderr, "Error saving %s: %s\n", SAVEGAME_QUICKSAVE_FILE,
+			e.what());
+		delete[] path;
+		new ErrorWindow(_parent, e.what());
+		return;
+	}
+
+	delete[] path;
+	close(x, y, arg);
+}
+
 void MainMenuWindow::quitGame(int x, int y, int arg) {
 	_parent->close();
 	gui_stack->clear();
@@ -3017,7 +3051,14 @@ void MainMenuWindow::clickNew(int x, int y, int arg) {
 	w->setYesCallback(GuiMethod(*this, &MainMenuWindow::newGame));
 }
 
-void MainMenuWindow::clickSave(int x, int y, int arg) STUB(_parent)
+void MainMenuWindow::clickSave(int x, int y, int arg) {
+	ConfirmationWindow *w;
+
+	// FIXME: Implement save slot selection
+	w = new ConfirmationWindow(_parent,
+		"Save the game to slot 1? The game saved there will be lost.");
+	w->setYesCallback(GuiMethod(*this, &MainMenuWindow::saveGame));
+}
 
 void MainMenuWindow::clickLoad(int x, int y, int arg) {
 	new LoadGameWindow(_parent, 0);
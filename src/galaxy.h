@@ -22,6 +22,7 @@
 
 #include "gui.h"
 #include "gamestate.h"
+#include "route.h"
 
 #define GALAXY_ARCHIVE "buffer0.lbx"
 #define ASSET_GALAXY_GUI 0
@@ -43,6 +44,11 @@ protected:
 
 	unsigned starX(unsigned x) const;
 	unsigned starY(unsigned y) const;
+	// Convert square area with given pixel margin around screen position
+	// to rectangle in galaxy coordinates. The rectangle is rounded up
+	// to cover all objects drawn inside the area.
+	void galaxyArea(int x, int y, unsigned margin, int *rx, int *ry,
+		unsigned *rw, unsigned *rh) const;
 	const Image *getStarSprite(const Star *s);
 
 	virtual void drawStar(int x, int y, const Star *s, unsigned curtick);
@@ -178,6 +184,7 @@ private:
 	unsigned _zoom, _zoomX, _zoomY, _startTick, _selTick;
 	int _curStar, _activePlayer;
 	Fleet *_curFleet;
+	RouteTable _routes;
 
 	void initWidgets(void);
 
@@ -187,6 +194,9 @@ protected:
 	int transformY(int y) const;
 	int transformFleetX(const Fleet *f) const;
 	int transformFleetY(const Fleet *f) const;
+	// screen area to galaxy coordinates conversion, see StarmapWidget
+	void galaxyArea(int x, int y, unsigned margin, int *rx, int *ry,
+		unsigned *rw, unsigned *rh) const;
 	const Image *getFleetSprite(const Fleet *f) const;
 	const Image *getStarSprite(const Star *s) const;
 	int touchesFleet(unsigned x, unsigned y, const Fleet *f) const;
@@ -265,6 +275,7 @@ private:
 	int _scrollgrab, _curslot, _activePlayer;
 	ImageAsset _bg, _planetimg[PLANET_CLIMATE_COUNT][PLANET_SIZE_COUNT];
 	ImageAsset _shipimg;
+	PlanetFilter _filter;
 	unsigned _planetCount, _planets[MAX_PLANETS];
 	// Ships heading to a specific planet
 	int _colonyShips[MAX_PLANETS], _outpostShips[MAX_PLANETS];
@@ -303,6 +314,7 @@ private:
 
 protected:
 	void newGame(int x, int y, int arg);
+	void saveGame(int x, int y, int arg);
 	void quitGame(int x, int y, int arg);
 
 public:
@@ -20,14 +20,53 @@
 #include <cstring>
 #include <stdexcept>
 #include "lang.h"
+#include "layout.h"
 #include "lbx.h"
+#include "system.h"
 #include "tech.h"
 #include "gamestate.h"
 
 #define COLONY_COUNT_OFFSET 0x25b
+#define GALAXY_OFFSET 0x31be4
+
+// Savegame record sizes
+#define GALAXY_DATA_SIZE 32
+#define COLONY_DATA_SIZE 361
+#define PLANET_DATA_SIZE 17
+#define STAR_DATA_SIZE 113
+#define PLAYER_DATA_SIZE 3753
+#define SHIP_DATA_SIZE 129
+#define NEBULA_DATA_SIZE 5
+#define COLONIST_DATA_SIZE 4
+#define SHIP_WEAPON_DATA_SIZE 8
+#define SHIP_DESIGN_DATA_SIZE 99
+#define SETTLER_DATA_SIZE 4
+#define SAVE_GAME_MIN_SIZE (GALAXY_OFFSET + GALAXY_DATA_SIZE)
+
+// GameState::_saveExact value before checkSaveData() runs
+#define SAVE_EXACT_UNKNOWN 0xff
+
+// Open addressing table for grouping ships into fleets, must be a power
+// of two larger than MAX_SHIPS
+#define FLEET_INDEX_BITS 10
+#define FLEET_INDEX_SIZE (1 << FLEET_INDEX_BITS)
+
+// Cell size of star and fleet position index in galaxy coordinates
+#define GALAXY_GRID_CELL 32
 
 const unsigned galaxySizeFactors[GALAXY_ZOOM_LEVELS] = {10, 15, 20, 30};
 
+// Fuel cell technologies from best to worst and their ship range in parsecs
+static const unsigned fuelCellRanges[][2] = {
+	{TECH_THORIUM_FUEL_CELLS, 0},
+	{TECH_URRIDIUM_FUEL_CELLS, 12},
+	{TECH_IRIDIUM_FUEL_CELLS, 9},
+	{TECH_DEUTERIUM_FUEL_CELLS, 6},
+	{TECH_STANDARD_FUEL_CELLS, 4}
+};
+
+#define BASE_FUEL_RANGE 3
+
 static const unsigned mineralProductionTable[PLANET_MINERALS_COUNT] = {
 	1, 2, 3, 5, 8
 };
@@ -167,12 +206,406 @@ static const int shipCrewDefenseBonuses[MAX_SHIP_CREW_LEVELS] = {
 	0, 15, 30, 50, 75
 };
 
+// Working special devices in packed ship strength inputs
+#define STRENGTH_AUGMENTED_ENGINES 0x1
+#define STRENGTH_REINFORCED_HULL 0x2
+#define STRENGTH_BATTLE_SCANNER 0x4
+#define STRENGTH_INERTIAL_NULLIFIER 0x8
+#define STRENGTH_INERTIAL_STABILIZER 0x10
+// Number of ships evaluated per batch in evalShipStrength()
+#define STRENGTH_BATCH 64
+
+static const unsigned strengthSpecials[][2] = {
+	{SPEC_AUGMENTED_ENGINES, STRENGTH_AUGMENTED_ENGINES},
+	{SPEC_REINFORCED_HULL, STRENGTH_REINFORCED_HULL},
+	{SPEC_BATTLE_SCANNER, STRENGTH_BATTLE_SCANNER},
+	{SPEC_INERTIAL_NULLIFIER, STRENGTH_INERTIAL_NULLIFIER},
+	{SPEC_INERTIAL_STABILIZER, STRENGTH_INERTIAL_STABILIZER}
+};
+
+// Packed ship data needed to calculate combat values
+struct StrengthInput {
+	uint8_t specials, transDimensional;
+	uint8_t driveDamage, computerDamage;
+	unsigned maxComputerHP, baseDriveHP, baseSpeed, computerBonus;
+	int attackBonus, defenseBonus;
+};
+
 static const unsigned npcFleetOwnerNames[NPC_FLEET_OWNERS] = {
 	ESTR_MONSTER_ANTARANS, ESTR_MONSTER_GUARDIAN, ESTR_MONSTER_AMOEBA,
 	ESTR_MONSTER_CRYSTAL, ESTR_MONSTER_DRAGON, ESTR_MONSTER_EEL,
 	ESTR_MONSTER_HYDRA
 };
 
+// Savegame record layouts. Offsets are relative to the start of record.
+static constexpr FieldLayout gameConfigFields[] = {
+	LAYOUT_INT(GameConfig, version, 0x00, 4),
+	LAYOUT_STRING(GameConfig, saveGameName, 0x04),
+	LAYOUT_INT(GameConfig, stardate, 0x29, 4),
+	LAYOUT_INT(GameConfig, multiplayer, 0x2d, 1),
+	LAYOUT_INT(GameConfig, endOfTurnSummary, 0x2e, 1),
+	LAYOUT_INT(GameConfig, endOfTurnWait, 0x2f, 1),
+	LAYOUT_INT(GameConfig, randomEvents, 0x30, 1),
+	LAYOUT_INT(GameConfig, enemyMoves, 0x31, 1),
+	LAYOUT_INT(GameConfig, expandingHelp, 0x32, 1),
+	LAYOUT_INT(GameConfig, autoSelectShips, 0x33, 1),
+	LAYOUT_INT(GameConfig, animations, 0x34, 1),
+	LAYOUT_INT(GameConfig, autoSelectColony, 0x35, 1),
+	LAYOUT_INT(GameConfig, showRelocationLines, 0x36, 1),
+	LAYOUT_INT(GameConfig, showGNNReport, 0x37, 1),
+	LAYOUT_INT(GameConfig, autoDeleteTradeGoodHousing, 0x38, 1),
+	LAYOUT_INT(GameConfig, showOnlySeriousTurnSummary, 0x39, 1),
+	LAYOUT_INT(GameConfig, shipInitiative, 0x3a, 1)
+};
+
+static constexpr RecordLayout gameConfigLayout =
+	RECORD_LAYOUT(GameConfig, SAVE_GAME_CONFIG_SIZE, gameConfigFields);
+
+static constexpr FieldLayout nebulaFields[] = {
+	LAYOUT_INT(Nebula, x, 0x00, 2),
+	LAYOUT_INT(Nebula, y, 0x02, 2),
+	LAYOUT_INT(Nebula, type, 0x04, 1)
+};
+
+static constexpr RecordLayout nebulaLayout =
+	RECORD_LAYOUT(Nebula, NEBULA_DATA_SIZE, nebulaFields);
+
+static constexpr FieldLayout galaxyFields[] = {
+	LAYOUT_INT(Galaxy, sizeFactor, 0x00, 1),
+	// 0x01: 4 bytes of unknown data
+	LAYOUT_INT(Galaxy, width, 0x05, 2),
+	LAYOUT_INT(Galaxy, height, 0x07, 2),
+	// 0x09: 2 bytes of unknown data
+	LAYOUT_RECORD(Galaxy, nebulas, 0x0b, nebulaLayout),
+	LAYOUT_INT(Galaxy, nebulaCount, 0x1f, 1)
+};
+
+static constexpr RecordLayout galaxyLayout =
+	RECORD_LAYOUT(Galaxy, GALAXY_DATA_SIZE, galaxyFields);
+
+static constexpr FieldLayout colonistFields[] = {
+	LAYOUT_BITS(Colonist, race, 0x00, 4, 0, 4),
+	LAYOUT_BITS(Colonist, loyalty, 0x00, 4, 4, 3),
+	LAYOUT_BITS(Colonist, job, 0x00, 4, 7, 2),
+	LAYOUT_BITS(Colonist, flags, 0x00, 4, 9, 23)
+};
+
+static constexpr RecordLayout colonistLayout =
+	RECORD_LAYOUT(Colonist, COLONIST_DATA_SIZE, colonistFields);
+
+static constexpr FieldLayout colonyFields[] = {
+	LAYOUT_INT(Colony, owner, 0x00, 1),
+	LAYOUT_INT(Colony, unknown1, 0x01, 1),
+	LAYOUT_INT(Colony, planet, 0x02, 2),
+	LAYOUT_INT(Colony, unknown2, 0x04, 2),
+	LAYOUT_INT(Colony, is_outpost, 0x06, 1),
+	LAYOUT_INT(Colony, morale, 0x07, 1),
+	LAYOUT_INT(Colony, pollution, 0x08, 2),
+	LAYOUT_INT(Colony, population, 0x0a, 1),
+	LAYOUT_INT(Colony, colony_type, 0x0b, 1),
+	LAYOUT_RECORD(Colony, colonists, 0x0c, colonistLayout),
+	LAYOUT_INT(Colony, race_population, 0xb4, 2),
+	LAYOUT_INT(Colony, pop_growth, 0xc8, 2),
+	LAYOUT_INT(Colony, age, 0xdc, 1),
+	LAYOUT_INT(Colony, food_per_farmer, 0xdd, 1),
+	LAYOUT_INT(Colony, industry_per_worker, 0xde, 1),
+	LAYOUT_INT(Colony, research_per_scientist, 0xdf, 1),
+	LAYOUT_INT(Colony, max_farms, 0xe0, 1),
+	LAYOUT_INT(Colony, max_population, 0xe1, 1),
+	LAYOUT_INT(Colony, climate, 0xe2, 1),
+	LAYOUT_INT(Colony, ground_strength, 0xe3, 2),
+	LAYOUT_INT(Colony, space_strength, 0xe5, 2),
+	LAYOUT_INT(Colony, total_food, 0xe7, 2),
+	LAYOUT_INT(Colony, net_industry, 0xe9, 2),
+	LAYOUT_INT(Colony, total_research, 0xeb, 2),
+	LAYOUT_INT(Colony, total_revenue, 0xed, 2),
+	LAYOUT_INT(Colony, food_consumption, 0xef, 1),
+	LAYOUT_INT(Colony, industry_consumption, 0xf0, 1),
+	LAYOUT_INT(Colony, research_consumption, 0xf1, 1),
+	LAYOUT_INT(Colony, upkeep, 0xf2, 1),
+	LAYOUT_INT(Colony, food_imported, 0xf3, 2),
+	LAYOUT_INT(Colony, industry_consumed, 0xf5, 2),
+	LAYOUT_INT(Colony, research_imported, 0xf7, 2),
+	LAYOUT_INT(Colony, budget_deficit, 0xf9, 2),
+	LAYOUT_INT(Colony, recycled_industry, 0xfb, 1),
+	LAYOUT_INT(Colony, food_consumption_citizens, 0xfc, 1),
+	LAYOUT_INT(Colony, food_consumption_aliens, 0xfd, 1),
+	LAYOUT_INT(Colony, food_consumption_prisoners, 0xfe, 1),
+	LAYOUT_INT(Colony, food_consumption_natives, 0xff, 1),
+	LAYOUT_INT(Colony, industry_consumption_citizens, 0x100, 1),
+	LAYOUT_INT(Colony, industry_consumption_androids, 0x101, 1),
+	LAYOUT_INT(Colony, industry_consumption_aliens, 0x102, 1),
+	LAYOUT_INT(Colony, industry_consumption_prisoners, 0x103, 1),
+	LAYOUT_INT(Colony, food_consumption_races, 0x104, 1),
+	LAYOUT_INT(Colony, industry_consumption_races, 0x10c, 1),
+	LAYOUT_INT(Colony, replicated_food, 0x114, 1),
+	LAYOUT_INT(Colony, build_queue, 0x115, 2),
+	LAYOUT_INT(Colony, finished_production, 0x123, 2),
+	LAYOUT_INT(Colony, build_progress, 0x125, 2),
+	LAYOUT_INT(Colony, tax_revenue, 0x127, 2),
+	LAYOUT_INT(Colony, autobuild, 0x129, 1),
+	LAYOUT_INT(Colony, unknown3, 0x12a, 2),
+	LAYOUT_INT(Colony, bought_progress, 0x12c, 2),
+	LAYOUT_INT(Colony, assimilation_progress, 0x12e, 1),
+	LAYOUT_INT(Colony, prisoner_policy, 0x12f, 1),
+	LAYOUT_INT(Colony, soldiers, 0x130, 2),
+	LAYOUT_INT(Colony, tanks, 0x132, 2),
+	LAYOUT_INT(Colony, tank_progress, 0x134, 1),
+	LAYOUT_INT(Colony, soldier_progress, 0x135, 1),
+	LAYOUT_INT(Colony, buildings, 0x136, 1),
+	LAYOUT_INT(Colony, status, 0x167, 2)
+};
+
+static constexpr RecordLayout colonyLayout =
+	RECORD_LAYOUT(Colony, COLONY_DATA_SIZE, colonyFields);
+
+static constexpr FieldLayout planetFields[] = {
+	LAYOUT_INT(Planet, colony, 0x00, 2),
+	LAYOUT_INT(Planet, star, 0x02, 1),
+	LAYOUT_INT(Planet, orbit, 0x03, 1),
+	LAYOUT_INT(Planet, type, 0x04, 1),
+	LAYOUT_INT(Planet, size, 0x05, 1),
+	LAYOUT_INT(Planet, gravity, 0x06, 1),
+	LAYOUT_INT(Planet, unknown1, 0x07, 1),
+	LAYOUT_INT(Planet, climate, 0x08, 1),
+	LAYOUT_INT(Planet, bg, 0x09, 1),
+	LAYOUT_INT(Planet, minerals, 0x0a, 1),
+	LAYOUT_INT(Planet, foodbase, 0x0b, 1),
+	LAYOUT_INT(Planet, terraforms, 0x0c, 1),
+	LAYOUT_INT(Planet, unknown2, 0x0d, 1),
+	LAYOUT_INT(Planet, max_pop, 0x0e, 1),
+	LAYOUT_INT(Planet, special, 0x0f, 1),
+	LAYOUT_INT(Planet, flags, 0x10, 1)
+};
+
+static constexpr RecordLayout planetLayout =
+	RECORD_LAYOUT(Planet, PLANET_DATA_SIZE, planetFields);
+
+static constexpr FieldLayout leaderFields[] = {
+	LAYOUT_STRING(Leader, name, 0x00),
+	LAYOUT_STRING(Leader, title, 0x0f),
+	LAYOUT_INT(Leader, type, 0x23, 1),
+	LAYOUT_INT(Leader, experience, 0x24, 2),
+	LAYOUT_INT(Leader, commonSkills, 0x26, 4),
+	LAYOUT_INT(Leader, specialSkills, 0x2a, 4),
+	LAYOUT_INT(Leader, techs, 0x2e, 1),
+	LAYOUT_INT(Leader, picture, 0x31, 1),
+	LAYOUT_INT(Leader, skillValue, 0x32, 2),
+	LAYOUT_INT(Leader, level, 0x34, 1),
+	LAYOUT_INT(Leader, location, 0x35, 2),
+	LAYOUT_INT(Leader, eta, 0x37, 1),
+	LAYOUT_INT(Leader, displayLevelUp, 0x38, 1),
+	LAYOUT_INT(Leader, status, 0x39, 1),
+	LAYOUT_INT(Leader, playerIndex, 0x3a, 1)
+};
+
+static constexpr RecordLayout leaderLayout =
+	RECORD_LAYOUT(Leader, LEADER_DATA_SIZE, leaderFields);
+
+static constexpr FieldLayout shipWeaponFields[] = {
+	LAYOUT_INT(ShipWeapon, type, 0x00, 2),
+	LAYOUT_INT(ShipWeapon, maxCount, 0x02, 1),
+	LAYOUT_INT(ShipWeapon, workingCount, 0x03, 1),
+	LAYOUT_INT(ShipWeapon, arc, 0x04, 1),
+	LAYOUT_INT(ShipWeapon, mods, 0x05, 2),
+	LAYOUT_INT(ShipWeapon, ammo, 0x07, 1)
+};
+
+static constexpr RecordLayout shipWeaponLayout =
+	RECORD_LAYOUT(ShipWeapon, SHIP_WEAPON_DATA_SIZE, shipWeaponFields);
+
+static constexpr FieldLayout shipDesignFields[] = {
+	LAYOUT_STRING(ShipDesign, name, 0x00),
+	LAYOUT_INT(ShipDesign, size, 0x10, 1),
+	LAYOUT_INT(ShipDesign, type, 0x11, 1),
+	LAYOUT_INT(ShipDesign, shield, 0x12, 1),
+	LAYOUT_INT(ShipDesign, drive, 0x13, 1),
+	LAYOUT_INT(ShipDesign, speed, 0x14, 1),
+	LAYOUT_INT(ShipDesign, computer, 0x15, 1),
+	LAYOUT_INT(ShipDesign, armor, 0x16, 1),
+	LAYOUT_INT(ShipDesign, specials, 0x17, 1),
+	LAYOUT_RECORD(ShipDesign, weapons, 0x1c, shipWeaponLayout),
+	LAYOUT_INT(ShipDesign, picture, 0x5c, 1),
+	LAYOUT_INT(ShipDesign, builder, 0x5d, 1),
+	LAYOUT_INT(ShipDesign, cost, 0x5e, 2),
+	LAYOUT_INT(ShipDesign, baseCombatSpeed, 0x60, 1),
+	LAYOUT_INT(ShipDesign, buildDate, 0x61, 2)
+};
+
+static constexpr RecordLayout shipDesignLayout =
+	RECORD_LAYOUT(ShipDesign, SHIP_DESIGN_DATA_SIZE, shipDesignFields);
+
+static constexpr FieldLayout settlerInfoFields[] = {
+	LAYOUT_BITS(SettlerInfo, sourceColony, 0x00, 4, 0, 8),
+	LAYOUT_BITS(SettlerInfo, destinationPlanet, 0x00, 4, 8, 8),
+	LAYOUT_BITS(SettlerInfo, player, 0x00, 4, 16, 4),
+	LAYOUT_BITS(SettlerInfo, eta, 0x00, 4, 20, 4),
+	LAYOUT_BITS(SettlerInfo, job, 0x00, 4, 24, 2)
+};
+
+static constexpr RecordLayout settlerInfoLayout =
+	RECORD_LAYOUT(SettlerInfo, SETTLER_DATA_SIZE, settlerInfoFields);
+
+static constexpr FieldLayout playerFields[] = {
+	// 0x00: 1 byte of unknown data
+	LAYOUT_STRING(Player, name, 0x01),
+	LAYOUT_STRING(Player, race, 0x15),
+	LAYOUT_INT(Player, eliminated, 0x24, 1),
+	LAYOUT_INT(Player, picture, 0x25, 1),
+	LAYOUT_INT(Player, color, 0x26, 1),
+	LAYOUT_INT(Player, personality, 0x27, 1),
+	LAYOUT_INT(Player, objective, 0x28, 1),
+	LAYOUT_INT(Player, homePlayerId, 0x29, 2),
+	LAYOUT_INT(Player, networkPlayerId, 0x2b, 2),
+	LAYOUT_INT(Player, playerDoneFlags, 0x2d, 1),
+	// 0x2e: 2 bytes of unknown data
+	LAYOUT_INT(Player, researchBreakthrough, 0x30, 1),
+	LAYOUT_INT(Player, taxRate, 0x31, 1),
+	LAYOUT_INT(Player, BC, 0x32, 4),
+	LAYOUT_INT(Player, totalFreighters, 0x36, 2),
+	LAYOUT_INT(Player, surplusFreighters, 0x38, 2),
+	LAYOUT_INT(Player, commandPoints, 0x3a, 2),
+	LAYOUT_INT(Player, usedCommandPoints, 0x3c, 2),
+	LAYOUT_INT(Player, foodFreighted, 0x3e, 2),
+	LAYOUT_INT(Player, settlersFreighted, 0x40, 2),
+	LAYOUT_RECORD(Player, settlers, 0x42, settlerInfoLayout),
+	LAYOUT_INT(Player, totalPop, 0xa6, 2),
+	LAYOUT_INT(Player, foodProduced, 0xa8, 2),
+	LAYOUT_INT(Player, industryProduced, 0xaa, 2),
+	LAYOUT_INT(Player, researchProduced, 0xac, 2),
+	LAYOUT_INT(Player, bcProduced, 0xae, 2),
+	LAYOUT_INT(Player, surplusFood, 0xb0, 2),
+	LAYOUT_INT(Player, surplusBC, 0xb2, 2),
+	LAYOUT_INT(Player, totalMaintenance, 0xb4, 4),
+	LAYOUT_INT(Player, buildingMaintenance, 0xb8, 2),
+	LAYOUT_INT(Player, freighterMaintenance, 0xba, 2),
+	LAYOUT_INT(Player, shipMaintenance, 0xbc, 2),
+	LAYOUT_INT(Player, spyMaintenance, 0xbe, 2),
+	LAYOUT_INT(Player, tributeCost, 0xc0, 2),
+	LAYOUT_INT(Player, officerMaintenance, 0xc2, 2),
+	LAYOUT_INT(Player, researchTopics, 0xc4, 1),
+	LAYOUT_INT(Player, techs, 0x117, 1),
+	LAYOUT_INT(Player, researchProgress, 0x1eb, 4),
+	// 0x1ef: 45 bytes of unknown data
+	LAYOUT_INT(Player, hyperTechLevels, 0x21c, 1),
+	// 0x224: 253 bytes of unknown data
+	LAYOUT_INT(Player, researchTopic, 0x321, 1),
+	LAYOUT_INT(Player, researchItem, 0x322, 1),
+	// 0x323: 3 bytes of unknown data
+	LAYOUT_RECORD(Player, blueprints, 0x326, shipDesignLayout),
+	LAYOUT_RECORD(Player, selectedBlueprint, 0x515, shipDesignLayout),
+	// 0x578: 12 bytes of unknown data
+	LAYOUT_INT(Player, playerContacts, 0x584, 1),
+	// 0x58c: 139 bytes of unknown data
+	LAYOUT_INT(Player, playerRelations, 0x617, 1),
+	// 0x61f: 8 bytes of unknown data
+	LAYOUT_INT(Player, foreignPolicies, 0x627, 1),
+	LAYOUT_INT(Player, tradeTreaties, 0x62f, 1),
+	LAYOUT_INT(Player, researchTreaties, 0x637, 1),
+	// 0x63f: 608 bytes of unknown data
+	LAYOUT_INT(Player, traits, 0x89f, 1),
+	// 0x8be: 33 bytes of unknown data
+	LAYOUT_INT(Player, fleetHistory, 0x8df, 1),
+	LAYOUT_INT(Player, techHistory, 0xa3d, 1),
+	LAYOUT_INT(Player, populationHistory, 0xb9b, 1),
+	LAYOUT_INT(Player, buildingHistory, 0xcf9, 1),
+	LAYOUT_INT(Player, spies, 0xe57, 1),
+	LAYOUT_INT(Player, infoPanel, 0xe5f, 1),
+	// 0xe60: 21 bytes of unknown data
+	LAYOUT_INT(Player, galaxyCharted, 0xe75, 1),
+	// 0xe76: 51 bytes of unknown data
+};
+
+static constexpr RecordLayout playerLayout =
+	RECORD_LAYOUT(Player, PLAYER_DATA_SIZE, playerFields);
+
+static constexpr FieldLayout starFields[] = {
+	LAYOUT_STRING(StarData, name, 0x00),
+	LAYOUT_INT(StarData, x, 0x0f, 2),
+	LAYOUT_INT(StarData, y, 0x11, 2),
+	LAYOUT_INT(StarData, size, 0x13, 1),
+	LAYOUT_INT(StarData, savedOwner, 0x14, 1),
+	LAYOUT_INT(StarData, pictureType, 0x15, 1),
+	LAYOUT_INT(StarData, spectralClass, 0x16, 1),
+	LAYOUT_INT(StarData, lastPlanetSelected, 0x17, 1),
+	LAYOUT_INT(StarData, blackHoleBlocks, 0x1f, 1),
+	LAYOUT_INT(StarData, special, 0x28, 1),
+	LAYOUT_INT(StarData, wormhole, 0x29, 1),
+	LAYOUT_INT(StarData, blockaded, 0x2a, 1),
+	LAYOUT_INT(StarData, blockadedBy, 0x2b, 1),
+	LAYOUT_INT(StarData, visited, 0x33, 1),
+	LAYOUT_INT(StarData, justVisited, 0x34, 1),
+	LAYOUT_INT(StarData, ignoreColonyShips, 0x35, 1),
+	LAYOUT_INT(StarData, ignoreCombatShips, 0x36, 1),
+	LAYOUT_INT(StarData, colonizePlayer, 0x37, 1),
+	LAYOUT_INT(StarData, hasColony, 0x38, 1),
+	LAYOUT_INT(StarData, hasWarpFieldInterdictor, 0x39, 1),
+	LAYOUT_INT(StarData, nextWFIInList, 0x3a, 1),
+	LAYOUT_INT(StarData, hasTachyon, 0x3b, 1),
+	LAYOUT_INT(StarData, hasSubspace, 0x3c, 1),
+	LAYOUT_INT(StarData, hasStargate, 0x3d, 1),
+	LAYOUT_INT(StarData, hasJumpgate, 0x3e, 1),
+	LAYOUT_INT(StarData, hasArtemisNet, 0x3f, 1),
+	LAYOUT_INT(StarData, hasDimensionalPortal, 0x40, 1),
+	LAYOUT_INT(StarData, isStagepoint, 0x41, 1),
+	LAYOUT_INT(StarData, officerIndex, 0x42, 1),
+	LAYOUT_INT(StarData, planetIndex, 0x4a, 2),
+	LAYOUT_INT(StarData, relocateShipTo, 0x54, 2),
+	// 0x64: 3 bytes of unknown data
+	LAYOUT_INT(StarData, surrenderTo, 0x67, 1),
+	LAYOUT_INT(StarData, inNebula, 0x6f, 1),
+	LAYOUT_INT(StarData, artifactsGaveApp, 0x70, 1)
+};
+
+static constexpr RecordLayout starLayout =
+	RECORD_LAYOUT(StarData, STAR_DATA_SIZE, starFields);
+
+static constexpr FieldLayout shipFields[] = {
+	LAYOUT_RECORD(Ship, design, 0x00, shipDesignLayout),
+	LAYOUT_INT(Ship, owner, 0x63, 1),
+	LAYOUT_INT(Ship, status, 0x64, 1),
+	LAYOUT_INT(Ship, star, 0x65, 2),
+	LAYOUT_INT(Ship, x, 0x67, 2),
+	LAYOUT_INT(Ship, y, 0x69, 2),
+	LAYOUT_INT(Ship, groupHasNavigator, 0x6b, 1),
+	LAYOUT_INT(Ship, warpSpeed, 0x6c, 1),
+	LAYOUT_INT(Ship, eta, 0x6d, 1),
+	LAYOUT_INT(Ship, shieldDamage, 0x6e, 1),
+	LAYOUT_INT(Ship, driveDamage, 0x6f, 1),
+	LAYOUT_INT(Ship, computerDamage, 0x70, 1),
+	LAYOUT_INT(Ship, crewLevel, 0x71, 1),
+	LAYOUT_INT(Ship, crewExp, 0x72, 2),
+	LAYOUT_INT(Ship, officer, 0x74, 2),
+	LAYOUT_INT(Ship, damagedSpecials, 0x76, 1),
+	LAYOUT_INT(Ship, armorDamage, 0x7b, 2),
+	LAYOUT_INT(Ship, structureDamage, 0x7d, 2),
+	LAYOUT_INT(Ship, mission, 0x7f, 1),
+	LAYOUT_INT(Ship, justBuilt, 0x80, 1)
+};
+
+static constexpr RecordLayout shipLayout =
+	RECORD_LAYOUT(Ship, SHIP_DATA_SIZE, shipFields);
+
+// Decode whole array of savegame records at once
+static void loadRecords(DataCursor &stream, const RecordLayout &layout,
+	void *records, size_t stride, unsigned count) {
+
+	decodeRecords(layout, records, stride,
+		stream.readBlock(count * layout.size), count);
+}
+
+// Write record count followed by the whole record array, returns pointer
+// to the end of written data
+static uint8_t *saveRecords(uint8_t *dest, unsigned count,
+	const RecordLayout &layout, const void *records, size_t stride,
+	unsigned maxCount) {
+
+	dest[0] = count & 0xff;
+	dest[1] = (count >> 8) & 0xff;
+	encodeRecords(layout, records, stride, dest + 2, maxCount);
+	return dest + 2 + maxCount * layout.size;
+}
+
 GameConfig::GameConfig(void) {
 	version = 0;
 	memset(saveGameName, 0, SAVE_GAME_NAME_SIZE);
@@ -193,40 +626,21 @@ GameConfig::GameConfig(void) {
 	shipInitiative = 0;
 }
 
-void GameConfig::load(ReadStream &stream) {
-	version = stream.readUint32LE();
+void GameConfig::load(DataCursor &stream) {
+	decodeRecord(gameConfigLayout, this,
+		stream.readBlock(gameConfigLayout.size));
 
 	if (version != 0xe0) {
 		throw std::runtime_error("Invalid savegame version");
 	}
-
-	stream.read(saveGameName, SAVE_GAME_NAME_SIZE);
-	saveGameName[SAVE_GAME_NAME_SIZE - 1] = '\0';
-	stardate = stream.readUint32LE();
-	multiplayer = stream.readUint8();
-	endOfTurnSummary = stream.readUint8();
-	endOfTurnWait = stream.readUint8();
-	randomEvents = stream.readUint8();
-	enemyMoves = stream.readUint8();
-	expandingHelp = stream.readUint8();
-	autoSelectShips = stream.readUint8();
-	animations = stream.readUint8();
-	autoSelectColony = stream.readUint8();
-	showRelocationLines = stream.readUint8();
-	showGNNReport = stream.readUint8();
-	autoDeleteTradeGoodHousing = stream.readUint8();
-	showOnlySeriousTurnSummary = stream.readUint8();
-	shipInitiative = stream.readUint8();
 }
 
 Nebula::Nebula(void) : x(0), y(0), type(0) {
 
 }
 
-void Nebula::load(ReadStream &stream) {
-	x = stream.readUint16LE();
-	y = stream.readUint16LE();
-	type = stream.readUint8();
+void Nebula::load(DataCursor &stream) {
+	decodeRecord(nebulaLayout, this, stream.readBlock(nebulaLayout.size));
 }
 
 void Nebula::validate(void) const {
@@ -239,18 +653,8 @@ Galaxy::Galaxy(void) : sizeFactor(0), width(0), height(0), nebulaCount(0) {
 
 }
 
-void Galaxy::load(ReadStream &stream) {
-	sizeFactor = stream.readUint8();
-	stream.readUint32LE(); // Skip unknown data
-	width = stream.readUint16LE();
-	height = stream.readUint16LE();
-	stream.readUint16LE(); // Skip unknown data
-
-	for (int i = 0; i < MAX_NEBULAS; i++) {
-		nebulas[i].load(stream);
-	}
-
-	nebulaCount = stream.readUint8();
+void Galaxy::load(DataCursor &stream) {
+	decodeRecord(galaxyLayout, this, stream.readBlock(galaxyLayout.size));
 }
 
 void Galaxy::validate(void) const {
@@ -286,13 +690,8 @@ Colonist::Colonist(void) {
 	flags = 0;
 }
 
-void Colonist::load(ReadStream &stream) {
-	uint32_t raw_data = stream.readUint32LE();
-
-	race = raw_data & 0xf;
-	loyalty = (raw_data >> 4) & 0x7;
-	job = (raw_data >> 7) & 0x3;
-	flags = raw_data >> 9;
+void Colonist::load(DataCursor &stream) {
+	decodeRecord(colonistLayout, this, stream.readBlock(colonistLayout.size));
 }
 
 Colony::Colony(void) {
@@ -369,94 +768,8 @@ Colony::Colony(void) {
 	status = 0;
 }
 
-void Colony::load(ReadStream &stream) {
-	size_t i;
-
-	owner = stream.readUint8();
-	unknown1 = stream.readSint8();
-	planet = stream.readSint16LE();
-	unknown2 = stream.readSint16LE();
-	is_outpost = stream.readUint8();
-	morale = stream.readSint8();
-	pollution = stream.readUint16LE();
-	population = stream.readUint8();
-	colony_type = stream.readUint8();
-
-	for (i = 0; i < MAX_POPULATION; i++) {
-		colonists[i].load(stream);
-	}
-
-	for (i = 0; i < MAX_RACES; i++) {
-		race_population[i] = stream.readUint16LE();
-	}
-
-	for (i = 0; i < MAX_RACES; i++) {
-		pop_growth[i] = stream.readSint16LE();
-	}
-
-	age = stream.readUint8();
-	food_per_farmer = stream.readUint8();
-	industry_per_worker = stream.readUint8();
-	research_per_scientist = stream.readUint8();
-	max_farms = stream.readSint8();
-	max_population = stream.readUint8();
-	climate = stream.readUint8();
-	ground_strength = stream.readUint16LE();
-	space_strength = stream.readUint16LE();
-	total_food = stream.readUint16LE();
-	net_industry = stream.readUint16LE();
-	total_research = stream.readUint16LE();
-	total_revenue = stream.readUint16LE();
-	food_consumption = stream.readUint8();
-	industry_consumption = stream.readUint8();
-	research_consumption = stream.readUint8();
-	upkeep = stream.readUint8();
-	food_imported = stream.readSint16LE();
-	industry_consumed = stream.readUint16LE();
-	research_imported = stream.readSint16LE();
-	budget_deficit = stream.readSint16LE();
-	recycled_industry = stream.readUint8();
-	food_consumption_citizens = stream.readUint8();
-	food_consumption_aliens = stream.readUint8();
-	food_consumption_prisoners = stream.readUint8();
-	food_consumption_natives = stream.readUint8();
-	industry_consumption_citizens = stream.readUint8();
-	industry_consumption_androids = stream.readUint8();
-	industry_consumption_aliens = stream.readUint8();
-	industry_consumption_prisoners = stream.readUint8();
-
-	for (i = 0; i < MAX_PLAYERS; i++) {
-		food_consumption_races[i] = stream.readUint8();
-	}
-
-	for (i = 0; i < MAX_PLAYERS; i++) {
-		industry_consumption_races[i] = stream.readUint8();
-	}
-
-	replicated_food = stream.readUint8();
-
-	for (i = 0; i < MAX_BUILD_QUEUE; i++) {
-		build_queue[i] = stream.readSint16LE();
-	}
-
-	finished_production = stream.readSint16LE();
-	build_progress = stream.readUint16LE();
-	tax_revenue = stream.readUint16LE();
-	autobuild = stream.readUint8();
-	unknown3 = stream.readUint16LE();
-	bought_progress = stream.readUint16LE();
-	assimilation_progress = stream.readUint8();
-	prisoner_policy = stream.readUint8();
-	soldiers = stream.readUint16LE();
-	tanks = stream.readUint16LE();
-	tank_progress = stream.readUint8();
-	soldier_progress = stream.readUint8();
-
-	for (i = 0; i < MAX_BUILDINGS; i++) {
-		buildings[i] = stream.readUint8();
-	}
-
-	status = stream.readUint16LE();
+void Colony::load(DataCursor &stream) {
+	decodeRecord(colonyLayout, this, stream.readBlock(colonyLayout.size));
 }
 
 void Colony::validate(void) const {
@@ -496,23 +809,8 @@ Planet::Planet(void) {
 	flags = 0;
 }
 
-void Planet::load(ReadStream &stream) {
-	colony = stream.readSint16LE();
-	star = stream.readUint8();
-	orbit = stream.readUint8();
-	type = stream.readUint8();
-	size = stream.readUint8();
-	gravity = stream.readUint8();
-	unknown1 = stream.readUint8();
-	climate = stream.readUint8();
-	bg = stream.readUint8();
-	minerals = stream.readUint8();
-	foodbase = stream.readUint8();
-	terraforms = stream.readUint8();
-	unknown2 = stream.readUint8();
-	max_pop = stream.readUint8();
-	special = stream.readUint8();
-	flags = stream.readUint8();
+void Planet::load(DataCursor &stream) {
+	decodeRecord(planetLayout, this, stream.readBlock(planetLayout.size));
 }
 
 unsigned Planet::baseProduction(void) const {
@@ -578,30 +876,8 @@ Leader::Leader(void) {
 	playerIndex = -1;
 }
 
-void Leader::load(ReadStream &stream) {
-	int i;
-
-	stream.read(name, LEADER_NAME_SIZE);
-	name[LEADER_NAME_SIZE - 1] = '\0';
-	stream.read(title, LEADER_TITLE_SIZE);
-	title[LEADER_TITLE_SIZE - 1] = '\0';
-	type = stream.readUint8();
-	experience = stream.readUint16LE();
-	commonSkills = stream.readUint32LE();
-	specialSkills = stream.readUint32LE();
-
-	for (i = 0; i < MAX_LEADER_TECH_SKILLS; i++) {
-		techs[i] = stream.readUint8();
-	}
-
-	picture = stream.readUint8();
-	skillValue = stream.readUint16LE();
-	level = stream.readUint8();
-	location = stream.readSint16LE();
-	eta = stream.readUint8();
-	displayLevelUp = stream.readUint8();
-	status = stream.readSint8();
-	playerIndex = stream.readSint8();
+void Leader::load(DataCursor &stream) {
+	decodeRecord(leaderLayout, this, stream.readBlock(leaderLayout.size));
 }
 
 unsigned Leader::expLevel(void) const {
@@ -747,13 +1023,42 @@ unsigned Leader::skillNum(unsigned id) {
 	return skillNumTable[SKILLTYPE(id)][code];
 }
 
-void ShipWeapon::load(ReadStream &stream) {
-	type = stream.readSint16LE();
-	maxCount = stream.readUint8();
-	workingCount = stream.readUint8();
-	arc = stream.readUint8();
-	mods = stream.readUint16LE();
-	ammo = stream.readUint8();
+unsigned Leader::skillIndex(unsigned id) {
+	static const unsigned skillOffsets[MAX_SKILL_TYPES] = {
+		0, MAX_COMMON_SKILLS, MAX_COMMON_SKILLS + MAX_CAPTAIN_SKILLS
+	};
+	unsigned code = id & SKILLCODE_MASK;
+
+	if (id & ~(SKILLTYPE_MASK | SKILLCODE_MASK) ||
+		code >= skillCount(SKILLTYPE(id))) {
+		throw std::out_of_range("Invalid skill ID");
+	}
+
+	return skillOffsets[SKILLTYPE(id)] + code;
+}
+
+unsigned Leader::skillID(unsigned index) {
+	if (index < MAX_COMMON_SKILLS) {
+		return COMMON_SKILLS_TYPE + index;
+	}
+
+	index -= MAX_COMMON_SKILLS;
+
+	if (index < MAX_CAPTAIN_SKILLS) {
+		return CAPTAIN_SKILLS_TYPE + index;
+	}
+
+	index -= MAX_CAPTAIN_SKILLS;
+
+	if (index < MAX_ADMIN_SKILLS) {
+		return ADMIN_SKILLS_TYPE + index;
+	}
+
+	throw std::out_of_range("Invalid skill index");
+}
+
+void ShipWeapon::load(DataCursor &stream) {
+	decodeRecord(shipWeaponLayout, this, stream.readBlock(shipWeaponLayout.size));
 }
 
 unsigned ShipWeapon::arcID(void) const {
@@ -799,29 +1104,8 @@ ShipDesign::ShipDesign(void) {
 	buildDate = 0;
 }
 
-void ShipDesign::load(ReadStream &stream) {
-	int i;
-
-	stream.read(name, SHIP_NAME_SIZE);
-	name[SHIP_NAME_SIZE - 1] = '\0';
-	size = stream.readUint8();
-	type = stream.readUint8();
-	shield = stream.readUint8();
-	drive = stream.readUint8();
-	speed = stream.readUint8();
-	computer = stream.readUint8();
-	armor = stream.readUint8();
-	stream.read(specials, (MAX_SHIP_SPECIALS + 7) / 8);
-
-	for (i = 0; i < MAX_SHIP_WEAPONS; i++) {
-		weapons[i].load(stream);
-	}
-
-	picture = stream.readUint8();
-	builder = stream.readUint8();
-	cost = stream.readUint16LE();
-	baseCombatSpeed = stream.readUint8();
-	buildDate = stream.readUint16LE();
+void ShipDesign::load(DataCursor &stream) {
+	decodeRecord(shipDesignLayout, this, stream.readBlock(shipDesignLayout.size));
 }
 
 int ShipDesign::hasSpecial(unsigned id) const {
@@ -992,15 +1276,8 @@ void ShipDesign::validate(void) const {
 	}
 }
 
-void SettlerInfo::load(ReadStream &stream) {
-	BitStream data(stream);
-
-	sourceColony = data.readBitsLE(8);
-	destinationPlanet = data.readBitsLE(8);
-	player = data.readBitsLE(4);
-	eta = data.readBitsLE(4);
-	job = data.readBitsLE(2);
-	//data.readBitsLE(6);
+void SettlerInfo::load(DataCursor &stream) {
+	decodeRecord(settlerInfoLayout, this, stream.readBlock(settlerInfoLayout.size));
 }
 
 Player::Player(void) {
@@ -1065,148 +1342,8 @@ Player::Player(void) {
 	galaxyCharted = 0;
 }
 
-void Player::load(SeekableReadStream &stream) {
-	int i;
-
-	stream.readUint8();	// FIXME: unknown data
-	stream.read(name, PLAYER_NAME_SIZE);
-	name[PLAYER_NAME_SIZE - 1] = '\0';
-	stream.read(race, PLAYER_RACE_SIZE);
-	race[PLAYER_RACE_SIZE - 1] = '\0';
-	eliminated = stream.readUint8();
-	picture = stream.readUint8();
-	color = stream.readUint8();
-	// 100 = Human player
-	personality = stream.readUint8();
-	objective = stream.readUint8();
-
-	homePlayerId = stream.readUint16LE();
-	networkPlayerId = stream.readUint16LE();
-	playerDoneFlags = stream.readUint8();
-	stream.readUint16LE(); // Dead field
-	researchBreakthrough = stream.readUint8();
-	taxRate = stream.readUint8();
-	BC = stream.readSint32LE();
-	totalFreighters = stream.readUint16LE();
-	surplusFreighters = stream.readSint16LE();
-	commandPoints = stream.readUint16LE();
-	usedCommandPoints = stream.readSint16LE();
-	foodFreighted = stream.readUint16LE();
-	settlersFreighted = stream.readUint16LE();
-
-	for (i = 0; i < MAX_SETTLERS; i++) {
-		settlers[i].load(stream);
-	}
-
-	totalPop = stream.readUint16LE();
-	foodProduced = stream.readUint16LE();
-	industryProduced = stream.readUint16LE();
-	researchProduced = stream.readUint16LE();
-	bcProduced = stream.readUint16LE();
-
-	surplusFood = stream.readSint16LE();
-	surplusBC = stream.readSint16LE();
-
-	totalMaintenance = stream.readSint32LE();
-	buildingMaintenance = stream.readUint16LE();
-	freighterMaintenance = stream.readUint16LE();
-	shipMaintenance = stream.readUint16LE();
-	spyMaintenance = stream.readUint16LE();
-	tributeCost = stream.readUint16LE();
-	officerMaintenance = stream.readUint16LE();
-
-	for (i = 0; i < MAX_RESEARCH_TOPICS; i++) {
-		researchTopics[i] = stream.readUint8();
-	}
-
-	for (i = 0; i < MAX_TECHNOLOGIES; i++) {
-		techs[i] = stream.readUint8();
-	}
-
-	researchProgress = stream.readUint32LE();
-
-	stream.seek(45, SEEK_CUR);
-
-	for (i = 0; i < MAX_RESEARCH_AREAS; i++) {
-		hyperTechLevels[i] = stream.readUint8();
-	}
-
-	stream.seek(253, SEEK_CUR);
-
-	researchTopic = stream.readUint8();
-	researchItem = stream.readUint8();
-
-	stream.readUint8();	// FIXME: Unknown data
-	stream.readUint8();	// FIXME: Unknown data
-	stream.readUint8();	// FIXME: Unknown data
-
-	for (i = 0; i < MAX_PLAYER_BLUEPRINTS; i++) {
-		blueprints[i].load(stream);
-	}
-
-	selectedBlueprint.load(stream);
-
-	stream.seek(12, SEEK_CUR);
-
-	for (i = 0; i < MAX_PLAYERS; i++) {
-		playerContacts[i] = stream.readUint8();
-	}
-
-	stream.seek(139, SEEK_CUR);
-
-	for (i = 0; i < MAX_PLAYERS; i++) {
-		playerRelations[i] = stream.readSint8();
-	}
-
-	stream.seek(8, SEEK_CUR);
-
-	for (i = 0; i < MAX_PLAYERS; i++) {
-		foreignPolicies[i] = stream.readUint8();
-	}
-
-	for (i = 0; i < MAX_PLAYERS; i++) {
-		tradeTreaties[i] = stream.readUint8();
-	}
-
-	for (i = 0; i < MAX_PLAYERS; i++) {
-		researchTreaties[i] = stream.readUint8();
-	}
-
-	stream.seek(608, SEEK_CUR);
-
-	for (i = 0; i < TRAITS_COUNT; i++) {
-		traits[i] = stream.readSint8();
-	}
-
-	stream.seek(33, SEEK_CUR);
-
-	for (i = 0; i < MAX_HISTORY_LENGTH; i++) {
-		fleetHistory[i] = stream.readUint8();
-	}
-
-	for (i = 0; i < MAX_HISTORY_LENGTH; i++) {
-		techHistory[i] = stream.readUint8();
-	}
-
-	for (i = 0; i < MAX_HISTORY_LENGTH; i++) {
-		populationHistory[i] = stream.readUint8();
-	}
-
-	for (i = 0; i < MAX_HISTORY_LENGTH; i++) {
-		buildingHistory[i] = stream.readUint8();
-	}
-
-	for (i = 0; i < MAX_PLAYERS; i++) {
-		spies[i] = stream.readUint8();
-	}
-
-	infoPanel = stream.readUint8();
-
-	stream.seek(21, SEEK_CUR);
-
-	galaxyCharted = stream.readUint8();
-
-	stream.seek(51, SEEK_CUR);
+void Player::load(DataCursor &stream) {
+	decodeRecord(playerLayout, this, stream.readBlock(playerLayout.size));
 }
 
 int Player::gravityPenalty(unsigned gravity) const {
@@ -1239,6 +1376,18 @@ unsigned Player::knowsTechnology(unsigned tech_id) const {
 	return hyperTechLevels[tech_id - MAX_APPLIED_TECHS];
 }
 
+unsigned Player::fuelRange(void) const {
+	unsigned i;
+
+	for (i = 0; i < sizeof(fuelCellRanges) / sizeof(*fuelCellRanges); i++) {
+		if (knowsTechnology(fuelCellRanges[i][0])) {
+			return fuelCellRanges[i][1];
+		}
+	}
+
+	return BASE_FUEL_RANGE;
+}
+
 int Player::canResearchTopic(unsigned topic_id) const {
 	if (topic_id >= MAX_RESEARCH_TOPICS) {
 		throw std::out_of_range("Invalid research topic ID");
@@ -1347,6 +1496,7 @@ Star::Star(void) {
 	x = 0;
 	y = 0;
 	size = StarSize::Large;
+	savedOwner = 0;
 	owner = 0;
 	pictureType = 0;
 	spectralClass = SpectralClass::Blue;
@@ -1396,6 +1546,10 @@ Star::Star(void) {
 }
 
 Star::~Star(void) {
+	clearFleets();
+}
+
+void Star::clearFleets(void) {
 	BilistNode<Fleet> *ptr, *next;
 
 	ptr = _firstOrbitingFleet.next();
@@ -1415,74 +1569,15 @@ Star::~Star(void) {
 		delete ptr->data;
 		delete ptr;
 	}
-}
-
-void Star::load(ReadStream &stream) {
-	int i;
-
-	stream.read(name, STARS_NAME_SIZE);
-	name[STARS_NAME_SIZE - 1] = '\0';
-	x = stream.readUint16LE();
-	y = stream.readUint16LE();
-	size = stream.readUint8();
-	owner = stream.readSint8();
-	pictureType = stream.readUint8();
-	spectralClass = stream.readUint8();
-
-	for (i = 0; i < MAX_PLAYERS; i++) {
-		lastPlanetSelected[i] = stream.readUint8();
-	}
-
-	for (i = 0; i < (MAX_STARS + 7)/8; i++) {
-		blackHoleBlocks[i] = stream.readUint8();
-	}
-
-	special = stream.readUint8();
-	wormhole = stream.readSint8();
-	blockaded = stream.readUint8();
-
-	for (i = 0; i < MAX_PLAYERS; i++) {
-		blockadedBy[i] = stream.readUint8();
-	}
-
-	visited = stream.readUint8();
-	justVisited = stream.readUint8();
-	ignoreColonyShips = stream.readUint8();
-	ignoreCombatShips = stream.readUint8();
-	colonizePlayer = stream.readSint8();
-	hasColony = stream.readUint8();
-	hasWarpFieldInterdictor = stream.readUint8();
-	nextWFIInList = stream.readUint8();
-	hasTachyon = stream.readUint8();
-	hasSubspace = stream.readUint8();
-	hasStargate = stream.readUint8();
-	hasJumpgate = stream.readUint8();
-	hasArtemisNet = stream.readUint8();
-	hasDimensionalPortal = stream.readUint8();
-	isStagepoint = stream.readUint8();
-
-	for (i = 0; i < MAX_PLAYERS; i++) {
-		officerIndex[i] = stream.readSint8();
-	}
-
-	for (i = 0; i < MAX_ORBITS; i++) {
-		planetIndex[i] = stream.readSint16LE();
-	}
 
-	for (i = 0; i < MAX_PLAYERS; i++) {
-		relocateShipTo[i] = stream.readUint16LE();
-	}
-
-	stream.readUint8();
-	stream.readUint8();
-	stream.readUint8();
-
-	for (i = 0; i < MAX_PLAYERS; i++) {
-		surrenderTo[i] = stream.readUint8();
-	}
+	_firstOrbitingFleet.insert_before(&_lastOrbitingFleet);
+	_firstLeavingFleet.insert_before(&_lastLeavingFleet);
+}
 
-	inNebula = stream.readUint8();
-	artifactsGaveApp = stream.readUint8();
+void Star::load(DataCursor &stream) {
+	decodeRecord(starLayout, static_cast<StarData*>(this),
+		stream.readBlock(starLayout.size));
+	owner = savedOwner;
 }
 
 void Star::addFleet(Fleet *f) {
@@ -1608,27 +1703,8 @@ bool Ship::operator>=(const Ship &other) const {
 	return !(*this < other);
 }
 
-void Ship::load(ReadStream &stream) {
-	design.load(stream);
-	owner = stream.readUint8();
-	status = stream.readUint8();
-	star = stream.readSint16LE();
-	x = stream.readUint16LE();
-	y = stream.readUint16LE();
-	groupHasNavigator = stream.readUint8();
-	warpSpeed = stream.readUint8();
-	eta = stream.readUint8();
-	shieldDamage = stream.readUint8();
-	driveDamage = stream.readUint8();
-	computerDamage = stream.readUint8();
-	crewLevel = stream.readUint8();
-	crewExp = stream.readUint16LE();
-	officer = stream.readSint16LE();
-	stream.read(damagedSpecials, (MAX_SHIP_SPECIALS + 7) / 8);
-	armorDamage = stream.readUint16LE();
-	structureDamage = stream.readUint16LE();
-	mission = stream.readUint8();
-	justBuilt = stream.readUint8();
+void Ship::load(DataCursor &stream) {
+	decodeRecord(shipLayout, this, stream.readBlock(shipLayout.size));
 }
 
 unsigned Ship::getStarID(void) const {
@@ -1726,13 +1802,107 @@ void Ship::validate(void) const {
 	}
 }
 
-GameState::GameState(void) {
+SaveWriter::SaveWriter(void) : _snapshot(NULL), _path(NULL) {
+
+}
+
+SaveWriter::~SaveWriter(void) {
+	try {
+		join();
+	} catch (...) {
+		// Nobody is waiting for the result anymore
+	}
+
+	clear();
+}
+
+void SaveWriter::clear(void) {
+	if (_snapshot) {
+		_snapshot->release();
+	}
+
+	delete[] _path;
+	_snapshot = NULL;
+	_path = NULL;
+}
+
+void SaveWriter::run(void) {
+	uint8_t *data;
+	size_t size;
+
+	data = _snapshot->state().saveData(&size);
+
+	try {
+		writeFileSync(_path, data, size);
+	} catch (...) {
+		delete[] data;
+		throw;
+	}
+
+	delete[] data;
+}
+
+void SaveWriter::write(const char *path, GameSnapshot *snap) {
+	try {
+		wait();
+		_path = copystr(path);
+	} catch (...) {
+		snap->release();
+		throw;
+	}
+
+	_snapshot = snap;
+	start();
+}
+
+void SaveWriter::wait(void) {
+	try {
+		join();
+	} catch (...) {
+		clear();
+		throw;
+	}
+
+	clear();
+}
+
+GameState::GameState(void) : _saveData(NULL), _saveSize(0), _saveExact(1),
+	_fleetSerial(0), _snapshot(NULL) {
+
+	unsigned i;
+
+	// Snapshots start at version 0 so that the first one copies all
+	for (i = 0; i < GAMESTATE_ARRAY_COUNT; i++) {
+		_versions[i] = 1;
+	}
+
+	memset(&_shipTable, 0, sizeof(_shipTable));
+	memset(&_planetTable, 0, sizeof(_planetTable));
+	memset(&_colonyTable, 0, sizeof(_colonyTable));
+	memset(&_techTable, 0, sizeof(_techTable));
+	memset(&_leaderTable, 0, sizeof(_leaderTable));
+	memset(&_visibility, 0, sizeof(_visibility));
+	_cache.hits = _cache.misses = 0;
+	_cache.frozen = 0;
+	invalidateCache();
 	_firstMovingFleet.insert_before(&_lastMovingFleet);
 }
 
 GameState::~GameState(void) {
 	BilistNode<Fleet> *next, *ptr = _firstMovingFleet.next();
 
+	try {
+		_saveWriter.wait();
+	} catch (std::exception &e) {
+		fprintf(stderr, "Autosave failed: %s\n", e.what());
+	}
+
+	delete[] _saveData;
+
+	if (_snapshot) {
+		_snapshot->release();
+	}
+
 	// prevent array scans in removeFleet() called by fleet destructor
 	_firstMovingFleet.unlink();
 
@@ -1792,27 +1962,73 @@ Fleet *GameState::findFleet(unsigned owner, unsigned status, unsigned x,
 	return NULL;
 }
 
+// Fleet grouping key, ships with the same key belong to the same fleet.
+// Leaving ships are matched by position instead of the orbited star ID.
+static uint64_t fleetKey(const ShipTable &t, unsigned i) {
+	return ((uint64_t)t.owner[i] << 56) | ((uint64_t)t.status[i] << 48) |
+		((uint64_t)t.x[i] << 32) | ((uint64_t)t.y[i] << 16) | t.star[i];
+}
+
 void GameState::createFleets(void) {
-	unsigned i;
-	Ship *ptr;
+	unsigned i, j, slot, groupCount = 0;
+	uint64_t key;
 	Fleet *flt;
+	uint64_t keys[FLEET_INDEX_SIZE];
+	int index[FLEET_INDEX_SIZE];
+	unsigned groups[MAX_SHIPS], starts[MAX_SHIPS + 1] = {0};
+	unsigned order[MAX_SHIPS];
+
+	memset(index, -1, FLEET_INDEX_SIZE * sizeof(int));
 
-	for (i = 0, ptr = _ships; i < _shipCount; i++, ptr++) {
-		if (!ptr->isActive()) {
+	// Assign each ship to a fleet in order of the first ship ID
+	for (i = 0; i < _shipCount; i++) {
+		if (_shipTable.status[i] > ShipState::LeavingOrbit) {
 			continue;
 		}
 
-		flt = findFleet(ptr->owner, ptr->status, ptr->x, ptr->y,
-			ptr->getStarID());
+		if (_shipTable.star[i] > _starSystemCount) {
+			throw std::out_of_range("Invalid star ID");
+		}
+
+		key = fleetKey(_shipTable, i);
+		slot = (key * 0x9e3779b97f4a7c15ULL) >> (64 - FLEET_INDEX_BITS);
 
-		if (flt) {
-			flt->addShip(i);
-			continue;
+		while (index[slot] >= 0 && keys[slot] != key) {
+			slot = (slot + 1) & (FLEET_INDEX_SIZE - 1);
+		}
+
+		if (index[slot] < 0) {
+			keys[slot] = key;
+			index[slot] = groupCount++;
+		}
+
+		groups[i] = index[slot];
+		starts[groups[i] + 1]++;
+	}
+
+	for (i = 0; i < groupCount; i++) {
+		starts[i + 1] += starts[i];
+	}
+
+	// Bucket ship IDs by fleet, IDs stay in ascending order
+	for (i = 0; i < _shipCount; i++) {
+		if (_shipTable.status[i] <= ShipState::LeavingOrbit) {
+			order[starts[groups[i]]++] = i;
 		}
+	}
+
+	for (i = groupCount; i > 0; i--) {
+		starts[i] = starts[i - 1];
+	}
 
-		flt = new Fleet(this, i);
+	starts[0] = 0;
+
+	for (i = 0; i < groupCount; i++) {
+		j = starts[i];
+		flt = new Fleet(this, order[j]);
 
 		try {
+			flt->addShips(order + j + 1, starts[i + 1] - j - 1);
 			addFleet(flt);
 		} catch (...) {
 			delete flt;
@@ -1827,7 +2043,16 @@ void GameState::addFleet(Fleet *flt) {
 		return;
 	}
 
-	_lastMovingFleet.insert(flt);
+	_fleetIndex.insert(flt, flt->getX(), flt->getY(), _fleetSerial);
+
+	try {
+		_lastMovingFleet.insert(flt);
+	} catch (...) {
+		_fleetIndex.remove(flt, flt->getX(), flt->getY());
+		throw;
+	}
+
+	_fleetSerial++;
 }
 
 void GameState::removeFleet(Fleet *flt) {
@@ -1835,66 +2060,214 @@ void GameState::removeFleet(Fleet *flt) {
 
 	for (; ptr && ptr != &_lastMovingFleet; ptr = ptr->next()) {
 		if (ptr->data && ptr->data == flt) {
+			_fleetIndex.remove(flt, flt->getX(), flt->getY());
 			ptr->discard();
 			return;
 		}
 	}
 }
 
-void GameState::load(SeekableReadStream &stream) {
-	int i;
+void GameState::clearFleets(void) {
+	unsigned i;
+	BilistNode<Fleet> *next, *ptr = _firstMovingFleet.next();
 
-	// FIXME: get rid of seeks
-	_gameConfig.load(stream);
-	stream.seek(0x31be4, SEEK_SET);
-	_galaxy.load(stream);
-	stream.seek(COLONY_COUNT_OFFSET, SEEK_SET);
-	_colonyCount = stream.readUint16LE();
+	_firstMovingFleet.unlink();
+	_fleetIndex.clear();
 
-	for (i = 0; i < MAX_COLONIES; i++) {
-		_colonies[i].load(stream);
+	for (; ptr && ptr != &_lastMovingFleet; ptr = next) {
+		next = ptr->next();
+		delete ptr->data;
+		delete ptr;
 	}
 
-	_planetCount = stream.readUint16LE();
+	_firstMovingFleet.insert_before(&_lastMovingFleet);
 
-	for (i = 0; i < MAX_PLANETS; i++) {
-		_planets[i].load(stream);
+	for (i = 0; i < _starSystemCount; i++) {
+		_starSystems[i].clearFleets();
 	}
+}
 
-	_starSystemCount = stream.readUint16LE();
+void GameState::createIndexes(void) {
+	unsigned i;
+	Star *ptr;
 
-	for (i = 0; i < MAX_STARS; i++) {
-		_starSystems[i].load(stream);
-	}
+	_starIndex.reset(_galaxy.width, _galaxy.height, GALAXY_GRID_CELL);
+	_fleetIndex.reset(_galaxy.width, _galaxy.height, GALAXY_GRID_CELL);
+	_fleetSerial = 0;
 
-	for (i = 0; i < LEADER_COUNT; i++) {
-		_leaders[i].load(stream);
+	for (i = 0, ptr = _starSystems; i < _starSystemCount; i++, ptr++) {
+		_starIndex.insert(ptr, ptr->x, ptr->y, i);
 	}
+}
 
-	_playerCount = stream.readUint16LE();
+void GameState::load(const uint8_t *data, size_t size) {
+	unsigned i;
+	uint8_t *copy;
+	DataCursor stream(data, size);
 
-	for (i = 0; i < MAX_PLAYERS; i++) {
-		_players[i].load(stream);
+	// Check file size up front, record parsers below cannot run out of
+	// data in a valid savegame
+	if (size < SAVE_GAME_MIN_SIZE) {
+		throw std::runtime_error("Savegame file is too short");
 	}
 
-	_shipCount = stream.readUint16LE();
+	_gameConfig.load(stream);
+	stream.seek(COLONY_COUNT_OFFSET);
+	_colonyCount = stream.readUint16LE();
+	loadRecords(stream, colonyLayout, _colonies, sizeof(Colony),
+		MAX_COLONIES);
+	_planetCount = stream.readUint16LE();
+	loadRecords(stream, planetLayout, _planets, sizeof(Planet),
+		MAX_PLANETS);
+	_starSystemCount = stream.readUint16LE();
+	loadRecords(stream, starLayout,
+		static_cast<StarData*>(_starSystems), sizeof(Star), MAX_STARS);
 
-	for (i = 0; i < MAX_SHIPS; i++) {
-		_ships[i].load(stream);
+	for (i = 0; i < MAX_STARS; i++) {
+		_starSystems[i].owner = _starSystems[i].savedOwner;
 	}
 
+	loadRecords(stream, leaderLayout, _leaders, sizeof(Leader),
+		LEADER_COUNT);
+	_playerCount = stream.readUint16LE();
+	loadRecords(stream, playerLayout, _players, sizeof(Player),
+		MAX_PLAYERS);
+	_shipCount = stream.readUint16LE();
+	loadRecords(stream, shipLayout, _ships, sizeof(Ship), MAX_SHIPS);
+	stream.skip(GALAXY_OFFSET - stream.pos());
+	_galaxy.load(stream);
 	validate();
+	updateHotTables();
+	createIndexes();
 	createFleets();
+	updateStarRanges();
+	invalidateCache();
+
+	for (i = 0; i < GAMESTATE_ARRAY_COUNT; i++) {
+		markChanged(i);
+	}
+
+	copy = new uint8_t[size];
+	memcpy(copy, data, size);
+	delete[] _saveData;
+	_saveData = copy;
+	_saveSize = size;
+	_saveExact = SAVE_EXACT_UNKNOWN;
 }
 
 void GameState::load(const char *filename) {
-	File fr;
+	const void *data;
+	size_t size;
 
-	if (!fr.open(filename)) {
+	data = mapFile(filename, &size);
+
+	if (!data) {
 		throw std::runtime_error("Cannot open savegame file");
 	}
 
-	load(fr);
+	try {
+		load((const uint8_t*)data, size);
+	} catch (...) {
+		unmapFile(data, size);
+		throw;
+	}
+
+	unmapFile(data, size);
+}
+
+uint8_t *GameState::saveData(size_t *size) const {
+	uint8_t *ret, *ptr;
+	size_t length = _saveData ? _saveSize : SAVE_GAME_MIN_SIZE;
+
+	ret = new uint8_t[length];
+
+	if (_saveData) {
+		memcpy(ret, _saveData, length);
+	} else {
+		memset(ret, 0, length);
+	}
+
+	encodeRecord(gameConfigLayout, &_gameConfig, ret);
+	ptr = ret + COLONY_COUNT_OFFSET;
+	ptr = saveRecords(ptr, _colonyCount, colonyLayout, _colonies,
+		sizeof(Colony), MAX_COLONIES);
+	ptr = saveRecords(ptr, _planetCount, planetLayout, _planets,
+		sizeof(Planet), MAX_PLANETS);
+	ptr = saveRecords(ptr, _starSystemCount, starLayout,
+		static_cast<const StarData*>(_starSystems), sizeof(Star),
+		MAX_STARS);
+	encodeRecords(leaderLayout, _leaders, sizeof(Leader), ptr,
+		LEADER_COUNT);
+	ptr += LEADER_COUNT * leaderLayout.size;
+	ptr = saveRecords(ptr, _playerCount, playerLayout, _players,
+		sizeof(Player), MAX_PLAYERS);
+	saveRecords(ptr, _shipCount, shipLayout, _ships, sizeof(Ship),
+		MAX_SHIPS);
+	encodeRecord(galaxyLayout, &_galaxy, ret + GALAXY_OFFSET);
+	*size = length;
+	return ret;
+}
+
+void GameState::checkSaveData(void) const {
+	uint8_t *data;
+	size_t size;
+	GameState *orig = NULL;
+
+	if (_saveExact != SAVE_EXACT_UNKNOWN) {
+		return;
+	} else if (!_saveData) {
+		_saveExact = 1;
+		return;
+	}
+
+	try {
+		orig = new GameState;
+		orig->load(_saveData, _saveSize);
+		data = orig->saveData(&size);
+	} catch (...) {
+		delete orig;
+		throw;
+	}
+
+	delete orig;
+	_saveExact = size == _saveSize && !memcmp(data, _saveData, size);
+	delete[] data;
+}
+
+void GameState::save(const char *filename) const {
+	uint8_t *data;
+	size_t size;
+
+	checkSaveData();
+
+	if (!_saveExact) {
+		throw std::runtime_error("Savegame format is not supported");
+	}
+
+	data = saveData(&size);
+
+	try {
+		writeFileSync(filename, data, size);
+	} catch (...) {
+		delete[] data;
+		throw;
+	}
+
+	delete[] data;
+}
+
+void GameState::autosave(const char *filename) {
+	checkSaveData();
+
+	if (!_saveExact) {
+		throw std::runtime_error("Savegame format is not supported");
+	}
+
+	_saveWriter.write(filename, snapshot());
+}
+
+void GameState::waitForSave(void) {
+	_saveWriter.wait();
 }
 
 void GameState::validate(void) const {
@@ -2144,52 +2517,230 @@ void GameState::validate(void) const {
 	}
 }
 
+static void setMaskBit(uint64_t *mask, unsigned id, int value) {
+	uint64_t bit = (uint64_t)1 << (id % 64);
+
+	if (value) {
+		mask[id / 64] |= bit;
+	} else {
+		mask[id / 64] &= ~bit;
+	}
+}
+
+// Bits of existing stars in given bitset word
+static uint64_t starWordMask(unsigned word, unsigned count) {
+	if (count >= 64 * (word + 1)) {
+		return ~(uint64_t)0;
+	} else if (count <= 64 * word) {
+		return 0;
+	}
+
+	return ((uint64_t)1 << (count - 64 * word)) - 1;
+}
+
+static void setStarOwners(Star *stars, unsigned word, uint64_t bits,
+	int owner) {
+
+	unsigned i;
+
+	for (i = 64 * word; bits; i++, bits >>= 1) {
+		if (bits & 1) {
+			stars[i].owner = owner;
+		}
+	}
+}
+
 void GameState::setActivePlayer(unsigned player_id) {
 	unsigned i, j;
-	Player *pptr;
-	Star *sptr;
+	uint64_t colonized, known, rest;
+	VisibilityTable &vis = _visibility;
 
 	if (player_id >= _playerCount) {
 		throw std::out_of_range("Invalid player ID");
 	}
 
-	pptr = _players + player_id;
+	// update star system ownership cache, only stars with known
+	// colonies have an owner
+	for (i = 0; i < STAR_WORDS; i++) {
+		for (j = 0, colonized = 0; j < _playerCount; j++) {
+			colonized |= vis.colonies[j][i];
+		}
 
-	// update star system ownership cache
-	for (i = 0; i < _starSystemCount; i++) {
-		sptr = _starSystems + i;
-		sptr->owner = -1;
+		known = vis.named[player_id][i] & colonized;
+		setStarOwners(_starSystems, i, vis.owned[i] & ~known, -1);
 
-		if (!sptr->hasColony || !isStarExplored(sptr, player_id)) {
-			continue;
+		// Own colonies take precedence
+		setStarOwners(_starSystems, i, known & vis.colonies[player_id][i],
+			player_id);
+		rest = known & ~vis.colonies[player_id][i];
+
+		for (j = 0; j < _playerCount; j++) {
+			if (vis.visible[player_id] & (1 << j)) {
+				setStarOwners(_starSystems, i,
+					rest & vis.colonies[j][i], j);
+				rest &= ~vis.colonies[j][i];
+			}
+		}
+
+		setStarOwners(_starSystems, i, rest & vis.owned[i], -1);
+		vis.owned[i] = known & ~rest;
+	}
+
+	markChanged(GAMESTATE_STARS);
+}
+
+void GameState::updateStarRanges(void) {
+	unsigned i;
+
+	for (i = 0; i < MAX_PLAYERS; i++) {
+		updateStarRange(i);
+	}
+}
+
+void GameState::updateStarRange(unsigned player_id) {
+	unsigned i, j, count, range;
+	unsigned ids[MAX_STARS];
+	int planet;
+	uint64_t word, sources[STAR_WORDS];
+	uint64_t *inRange;
+	const Star *sptr;
+
+	if (player_id >= MAX_PLAYERS) {
+		throw std::out_of_range("Invalid player ID");
+	}
+
+	inRange = _visibility.inRange[player_id];
+	memset(inRange, 0, STAR_WORDS * sizeof(uint64_t));
+	memset(sources, 0, sizeof(sources));
+
+	if (player_id >= _playerCount) {
+		return;
+	}
+
+	for (i = 0; i < _colonyCount; i++) {
+		planet = _colonyTable.planet[i];
+
+		if (_colonyTable.owner[i] == player_id && planet >= 0 &&
+			planet < _planetCount) {
+			setMaskBit(sources, _planetTable.star[planet], 1);
 		}
+	}
+
+	range = _players[player_id].fuelRange() * PARSEC_SIZE;
 
-		if (sptr->hasColony & (1 << player_id)) {
-			sptr->owner = player_id;
+	for (i = 0; i < STAR_WORDS; i++) {
+		if (!sources[i]) {
 			continue;
 		}
 
-		for (j = 0; j < _playerCount; j++) {
-			if (sptr->hasColony & (1 << j) &&
-				pptr->isPlayerVisible(j)) {
+		// Unlimited range, every star is reachable
+		if (!range) {
+			for (j = 0; j < STAR_WORDS; j++) {
+				inRange[j] = starWordMask(j, _starSystemCount);
+			}
 
-				sptr->owner = j;
-				break;
+			return;
+		}
+
+		for (word = sources[i], j = 64 * i; word; word >>= 1, j++) {
+			if (!(word & 1) || j >= _starSystemCount) {
+				continue;
+			}
+
+			sptr = _starSystems + j;
+			count = findStars(sptr->x, sptr->y, range, ids,
+				MAX_STARS);
+
+			while (count--) {
+				setMaskBit(inRange, ids[count], 1);
 			}
 		}
 	}
 }
 
+int GameState::isStarInRange(unsigned star_id, unsigned player_id) const {
+	if (star_id >= _starSystemCount) {
+		throw std::out_of_range("Invalid star ID");
+	}
+
+	if (player_id >= _playerCount) {
+		throw std::out_of_range("Invalid player ID");
+	}
+
+	return (_visibility.inRange[player_id][star_id / 64] >>
+		(star_id % 64)) & 1;
+}
+
 unsigned GameState::findStar(int x, int y) const {
-	unsigned i;
+	SpatialItem<Star> ret;
 
-	for (i = 0; i < _starSystemCount; i++) {
-		if (_starSystems[i].x == x && _starSystems[i].y == y) {
-			return i;
-		}
+	if (!_starIndex.findPoint(x, y, &ret, 1)) {
+		throw std::runtime_error("No star at given coordinates");
+	}
+
+	return ret.key;
+}
+
+size_t GameState::findStars(int x, int y, unsigned width, unsigned height,
+	unsigned *ids, size_t max) const {
+
+	size_t i, count;
+	SpatialItem<Star> tmp[MAX_STARS];
+
+	count = _starIndex.findRect(x, y, width, height, tmp,
+		MIN(max, MAX_STARS));
+
+	for (i = 0; i < count; i++) {
+		ids[i] = tmp[i].key;
+	}
+
+	return count;
+}
+
+size_t GameState::findStars(int x, int y, unsigned radius, unsigned *ids,
+	size_t max) const {
+
+	size_t i, count;
+	SpatialItem<Star> tmp[MAX_STARS];
+
+	count = _starIndex.findRadius(x, y, radius, tmp, MIN(max, MAX_STARS));
+
+	for (i = 0; i < count; i++) {
+		ids[i] = tmp[i].key;
+	}
+
+	return count;
+}
+
+size_t GameState::findMovingFleets(int x, int y, unsigned width,
+	unsigned height, Fleet **fleets, size_t max) {
+
+	size_t i, count;
+	SpatialItem<Fleet> tmp[MAX_SHIPS];
+
+	count = _fleetIndex.findRect(x, y, width, height, tmp,
+		MIN(max, MAX_SHIPS));
+
+	for (i = 0; i < count; i++) {
+		fleets[i] = tmp[i].data;
+	}
+
+	return count;
+}
+
+size_t GameState::findMovingFleets(int x, int y, unsigned radius,
+	Fleet **fleets, size_t max) {
+
+	size_t i, count;
+	SpatialItem<Fleet> tmp[MAX_SHIPS];
+
+	count = _fleetIndex.findRadius(x, y, radius, tmp, MIN(max, MAX_SHIPS));
+
+	for (i = 0; i < count; i++) {
+		fleets[i] = tmp[i].data;
 	}
 
-	throw std::runtime_error("No star at given coordinates");
+	return count;
 }
 
 int GameState::getOrbitingPlanetID(unsigned star_id, unsigned orbit) const {
@@ -2247,9 +2798,33 @@ StarKnowledge GameState::isStarExplored(unsigned star_id,
 StarKnowledge GameState::isStarExplored(const Star *s,
 	unsigned player_id) const {
 
-	unsigned i;
+	unsigned i, id;
+	uint64_t bit;
 	const Player *p;
 
+	// Stars of this game state are looked up in visibility bitsets
+	if (s >= _starSystems && s < _starSystems + _starSystemCount) {
+		id = s - _starSystems;
+		bit = (uint64_t)1 << (id % 64);
+
+		if (player_id < MAX_PLAYERS &&
+			(_visibility.explored[player_id][id / 64] & bit)) {
+			return STAR_VISITED;
+		}
+
+		if (player_id >= _playerCount) {
+			throw std::out_of_range("Invalid player ID");
+		}
+
+		if (_visibility.charted[player_id][id / 64] & bit) {
+			return STAR_CHARTED;
+		} else if (_visibility.named[player_id][id / 64] & bit) {
+			return STAR_NAME_ONLY;
+		}
+
+		return STAR_UNEXPLORED;
+	}
+
 	if (s->visited & (1 << player_id)) {
 		return STAR_VISITED;
 	}
@@ -2273,6 +2848,14 @@ StarKnowledge GameState::isStarExplored(const Star *s,
 	return STAR_UNEXPLORED;
 }
 
+int GameState::isPlayerVisible(unsigned player_id, unsigned other_id) const {
+	if (player_id >= _playerCount || other_id >= MAX_PLAYERS) {
+		throw std::out_of_range("Invalid player ID");
+	}
+
+	return (_visibility.visible[player_id] >> other_id) & 1;
+}
+
 unsigned GameState::planetClimate(unsigned planet_id) const {
 	const Planet *ptr;
 
@@ -2285,20 +2868,14 @@ unsigned GameState::planetClimate(unsigned planet_id) const {
 	return ptr->climate;
 }
 
-unsigned GameState::planetMaxPop(unsigned planet_id, unsigned player_id) const {
+unsigned GameState::calcPlanetMaxPop(unsigned planet_id,
+	unsigned player_id) const {
+
 	unsigned ret, climate, climateFactor;
 	const Planet *ptr;
 	const Colony *cptr = NULL;
 	const Player *pptr;
 
-	if (planet_id >= _planetCount) {
-		throw std::out_of_range("Invalid planet ID");
-	}
-
-	if (player_id >= _playerCount) {
-		throw std::out_of_range("Invalid player ID");
-	}
-
 	ptr = _planets + planet_id;
 	climate = planetClimate(planet_id);
 
@@ -2337,6 +2914,99 @@ unsigned GameState::planetMaxPop(unsigned planet_id, unsigned player_id) const {
 	return ret;
 }
 
+unsigned GameState::planetMaxPop(unsigned planet_id, unsigned player_id) const {
+	uint16_t *entry;
+
+	if (planet_id >= _planetCount) {
+		throw std::out_of_range("Invalid planet ID");
+	}
+
+	if (player_id >= _playerCount) {
+		throw std::out_of_range("Invalid player ID");
+	}
+
+	entry = &_cache.maxPop[planet_id][player_id];
+
+	if (*entry != DERIVED_INVALID) {
+		if (!_cache.frozen) {
+			_cache.hits++;
+		}
+
+		return *entry;
+	}
+
+	_cache.misses++;
+	*entry = calcPlanetMaxPop(planet_id, player_id);
+	return *entry;
+}
+
+void GameState::calcShipStats(unsigned ship_id) const {
+	unsigned i;
+	ShipStrength tmp;
+
+	for (i = 0; i < 2; i++) {
+		evalShipStrength(&ship_id, 1, i, &tmp);
+		_cache.combatSpeed[ship_id][i] = tmp.combatSpeed;
+		_cache.beamOffense[ship_id][i] = tmp.beamOffense;
+		_cache.beamDefense[ship_id][i] = tmp.beamDefense;
+	}
+
+	_cache.shipValid[ship_id] = 1;
+}
+
+void GameState::freezeCache(void) {
+	unsigned i, j, k, count;
+	unsigned ids[STRENGTH_BATCH];
+	ShipStrength tmp[STRENGTH_BATCH];
+
+	_cache.frozen = 0;
+	invalidateCache();
+
+	for (i = 0; i < _planetCount; i++) {
+		for (j = 0; j < _playerCount; j++) {
+			_cache.maxPop[i][j] = calcPlanetMaxPop(i, j);
+		}
+	}
+
+	for (i = 0; i < _shipCount; i += count) {
+		count = MIN(_shipCount - i, STRENGTH_BATCH);
+
+		for (j = 0; j < count; j++) {
+			ids[j] = i + j;
+		}
+
+		for (k = 0; k < 2; k++) {
+			evalShipStrength(ids, count, k, tmp);
+
+			for (j = 0; j < count; j++) {
+				_cache.combatSpeed[i + j][k] = tmp[j].combatSpeed;
+				_cache.beamOffense[i + j][k] = tmp[j].beamOffense;
+				_cache.beamDefense[i + j][k] = tmp[j].beamDefense;
+			}
+		}
+	}
+
+	memset(_cache.shipValid, 1, _shipCount);
+	_cache.frozen = 1;
+}
+
+int GameState::cachedShipID(const Ship *sptr) const {
+	if (sptr < _ships || sptr >= _ships + _shipCount) {
+		return -1;
+	}
+
+	if (_cache.shipValid[sptr - _ships]) {
+		if (!_cache.frozen) {
+			_cache.hits++;
+		}
+	} else {
+		_cache.misses++;
+		calcShipStats(sptr - _ships);
+	}
+
+	return sptr - _ships;
+}
+
 unsigned GameState::shipCombatSpeed(unsigned ship_id, int ignoreDamage) const {
 	if (ship_id >= _shipCount) {
 		throw std::out_of_range("Invalid ship ID");
@@ -2344,9 +3014,15 @@ unsigned GameState::shipCombatSpeed(unsigned ship_id, int ignoreDamage) const {
 
 	return shipCombatSpeed(_ships + ship_id, ignoreDamage);
 }
+
 unsigned GameState::shipCombatSpeed(const Ship *sptr, int ignoreDamage) const {
-	int td = 0;
+	int td = 0, id = cachedShipID(sptr);
 
+	if (id >= 0) {
+		return _cache.combatSpeed[id][ignoreDamage ? 1 : 0];
+	}
+
+	// Ship outside of game state, e.g. design preview
 	if (sptr->owner < _playerCount) {
 		td = _players[sptr->owner].traits[TRAIT_TRANS_DIMENSIONAL];
 	}
@@ -2363,14 +3039,20 @@ int GameState::shipBeamOffense(unsigned ship_id, int ignoreDamage) const {
 }
 
 int GameState::shipBeamOffense(const Ship *sptr, int ignoreDamage) const {
-	int ret = sptr->beamOffense(ignoreDamage);
+	int ret, id = cachedShipID(sptr);
+
+	if (id >= 0) {
+		return _cache.beamOffense[id][ignoreDamage ? 1 : 0];
+	}
+
+	ret = sptr->beamOffense(ignoreDamage);
 
 	if (sptr->owner < _playerCount) {
 		ret += _players[sptr->owner].traits[TRAIT_SHIP_ATTACK];
 	}
 
 	if (sptr->officer >= 0) {
-		ret += _leaders[sptr->officer].skillBonus(SKILL_WEAPONRY);
+		ret += leaderSkillBonus(sptr->officer, SKILL_WEAPONRY);
 	}
 
 	return ret;
@@ -2385,7 +3067,11 @@ int GameState::shipBeamDefense(unsigned ship_id, int ignoreDamage) const {
 }
 
 int GameState::shipBeamDefense(const Ship *sptr, int ignoreDamage) const {
-	int ret;
+	int ret, id = cachedShipID(sptr);
+
+	if (id >= 0) {
+		return _cache.beamDefense[id][ignoreDamage ? 1 : 0];
+	}
 
 	if (sptr->owner < _playerCount) {
 		const Player *owner = _players + sptr->owner;
@@ -2398,28 +3084,682 @@ int GameState::shipBeamDefense(const Ship *sptr, int ignoreDamage) const {
 	}
 
 	if (sptr->officer >= 0) {
-		ret += _leaders[sptr->officer].skillBonus(SKILL_HELMSMAN);
+		ret += leaderSkillBonus(sptr->officer, SKILL_HELMSMAN);
 	}
 
 	return ret;
 }
 
-int GameState::leaderHireModifier(unsigned player_id) const {
+void GameState::invalidateCache(void) {
+	memset(_cache.maxPop, 0xff, sizeof(_cache.maxPop));
+	memset(_cache.shipValid, 0, sizeof(_cache.shipValid));
+}
+
+void GameState::invalidatePlayer(unsigned player_id) {
 	unsigned i;
-	int tmp, ret = 0;
-	const Leader *ptr;
+	int colony;
 
-	for (i = 0; i < LEADER_COUNT; i++) {
-		ptr = _leaders + i;
+	if (player_id >= MAX_PLAYERS) {
+		throw std::out_of_range("Invalid player ID");
+	}
 
-		if (ptr->playerIndex != (int)player_id || !ptr->isEmployed()) {
-			continue;
-		}
+	updatePlayerRow(player_id);
+	updateKnowledge(player_id);
+	updateStarRange(player_id);
+
+	// Colonized planets use owner stats regardless of the viewer
+	for (i = 0; i < _planetCount; i++) {
+		colony = _planetTable.colony[i];
+
+		if (colony >= 0 && _colonyTable.owner[colony] == player_id) {
+			invalidatePlanet(i);
+		} else {
+			_cache.maxPop[i][player_id] = DERIVED_INVALID;
+		}
+	}
+
+	for (i = 0; i < _shipCount; i++) {
+		if (_shipTable.owner[i] == player_id) {
+			_cache.shipValid[i] = 0;
+		}
+	}
+
+	markChanged(GAMESTATE_PLAYERS);
+	markChanged(GAMESTATE_LEADERS);
+}
+
+void GameState::invalidatePlanet(unsigned planet_id) {
+	unsigned i;
+
+	if (planet_id >= MAX_PLANETS) {
+		throw std::out_of_range("Invalid planet ID");
+	}
+
+	for (i = 0; i < MAX_PLAYERS; i++) {
+		_cache.maxPop[planet_id][i] = DERIVED_INVALID;
+	}
+
+	updatePlanetRow(planet_id);
+	markChanged(GAMESTATE_PLANETS);
+}
+
+void GameState::invalidateColony(unsigned colony_id) {
+	unsigned owner;
+
+	if (colony_id >= MAX_COLONIES) {
+		throw std::out_of_range("Invalid colony ID");
+	}
+
+	// Fuel range of both the previous and the new owner may change
+	owner = _colonyTable.owner[colony_id];
+	updateColonyRow(colony_id);
+	markChanged(GAMESTATE_COLONIES);
+
+	if (owner < MAX_PLAYERS) {
+		updateStarRange(owner);
+	}
+
+	owner = _colonyTable.owner[colony_id];
+
+	if (owner < MAX_PLAYERS) {
+		updateStarRange(owner);
+	}
+
+	if (_colonies[colony_id].planet >= 0 &&
+		_colonies[colony_id].planet < MAX_PLANETS) {
+		invalidatePlanet(_colonies[colony_id].planet);
+	}
+}
+
+void GameState::invalidateShip(unsigned ship_id) {
+	if (ship_id >= MAX_SHIPS) {
+		throw std::out_of_range("Invalid ship ID");
+	}
+
+	_cache.shipValid[ship_id] = 0;
+	updateShipRow(ship_id);
+	markChanged(GAMESTATE_SHIPS);
+}
+
+void GameState::invalidateLeader(unsigned leader_id) {
+	unsigned i;
+
+	if (leader_id >= LEADER_COUNT) {
+		throw std::out_of_range("Invalid leader ID");
+	}
+
+	updateLeaderRow(leader_id);
+
+	// Officer skills are included in cached ship stats
+	for (i = 0; i < _shipCount; i++) {
+		if (_ships[i].officer == (int)leader_id) {
+			_cache.shipValid[i] = 0;
+		}
+	}
+
+	markChanged(GAMESTATE_LEADERS);
+}
+
+void GameState::invalidateStar(unsigned star_id) {
+	if (star_id >= _starSystemCount) {
+		throw std::out_of_range("Invalid star ID");
+	}
+
+	updateStarRow(star_id);
+	markChanged(GAMESTATE_STARS);
+}
+
+void GameState::cacheStats(unsigned long *hits, unsigned long *misses) const {
+	*hits = _cache.hits;
+	*misses = _cache.misses;
+}
+
+void GameState::markChanged(unsigned array) {
+	if (array >= GAMESTATE_ARRAY_COUNT) {
+		throw std::out_of_range("Invalid game state array");
+	}
+
+	_versions[array]++;
+}
+
+unsigned long GameState::version(unsigned array) const {
+	if (array >= GAMESTATE_ARRAY_COUNT) {
+		throw std::out_of_range("Invalid game state array");
+	}
+
+	return _versions[array];
+}
+
+void GameState::updateSnapshot(GameSnapshot *snap) const {
+	unsigned i;
+	uint8_t *copy;
+	GameState *dest = &snap->_state;
+	const unsigned long *ver = snap->_versions;
+
+	for (i = 0; i < GAMESTATE_ARRAY_COUNT && ver[i] == _versions[i]; i++);
+
+	if (i >= GAMESTATE_ARRAY_COUNT) {
+		return;
+	}
+
+	// Old fleets must go before star count changes
+	dest->clearFleets();
+
+	// Savegame image changes only on load
+	if (ver[GAMESTATE_CONFIG] != _versions[GAMESTATE_CONFIG]) {
+		copy = NULL;
+
+		if (_saveData) {
+			copy = new uint8_t[_saveSize];
+			memcpy(copy, _saveData, _saveSize);
+		}
+
+		delete[] dest->_saveData;
+		dest->_saveData = copy;
+		dest->_saveSize = _saveSize;
+		dest->_saveExact = _saveExact;
+		dest->_gameConfig = _gameConfig;
+		dest->_galaxy = _galaxy;
+	}
+
+	// Star fleet lists belong to the snapshot, copy only star records
+	if (ver[GAMESTATE_STARS] != _versions[GAMESTATE_STARS]) {
+		dest->_starSystemCount = _starSystemCount;
+
+		for (i = 0; i < _starSystemCount; i++) {
+			static_cast<StarData&>(dest->_starSystems[i]) =
+				_starSystems[i];
+			dest->_starSystems[i].owner = _starSystems[i].owner;
+		}
+	}
+
+	if (ver[GAMESTATE_COLONIES] != _versions[GAMESTATE_COLONIES]) {
+		dest->_colonyCount = _colonyCount;
+
+		for (i = 0; i < _colonyCount; i++) {
+			dest->_colonies[i] = _colonies[i];
+		}
+	}
+
+	if (ver[GAMESTATE_PLANETS] != _versions[GAMESTATE_PLANETS]) {
+		dest->_planetCount = _planetCount;
+
+		for (i = 0; i < _planetCount; i++) {
+			dest->_planets[i] = _planets[i];
+		}
+	}
+
+	if (ver[GAMESTATE_LEADERS] != _versions[GAMESTATE_LEADERS]) {
+		for (i = 0; i < LEADER_COUNT; i++) {
+			dest->_leaders[i] = _leaders[i];
+		}
+	}
+
+	if (ver[GAMESTATE_PLAYERS] != _versions[GAMESTATE_PLAYERS]) {
+		dest->_playerCount = _playerCount;
+
+		for (i = 0; i < _playerCount; i++) {
+			dest->_players[i] = _players[i];
+		}
+	}
+
+	if (ver[GAMESTATE_SHIPS] != _versions[GAMESTATE_SHIPS]) {
+		dest->_shipCount = _shipCount;
+
+		for (i = 0; i < _shipCount; i++) {
+			dest->_ships[i] = _ships[i];
+		}
+	}
+
+	// Derived data is rebuilt the same way as in load()
+	dest->updateHotTables();
+	dest->createIndexes();
+	dest->createFleets();
+	dest->updateStarRanges();
+	dest->freezeCache();
+	memcpy(snap->_versions, _versions, sizeof(_versions));
+}
+
+GameSnapshot *GameState::snapshot(void) {
+	GameSnapshot *ret = _snapshot;
+
+	// Readers still use the last snapshot, leave it alone
+	if (ret && ret->isShared()) {
+		if (!memcmp(ret->_versions, _versions, sizeof(_versions))) {
+			ret->acquire();
+			return ret;
+		}
+
+		_snapshot = NULL;
+		ret->release();
+		ret = NULL;
+	}
+
+	if (!ret) {
+		ret = new GameSnapshot;
+		_snapshot = ret;
+	}
+
+	updateSnapshot(ret);
+	ret->acquire();
+	return ret;
+}
+
+void GameState::updateShipRow(unsigned ship_id) {
+	unsigned i, damaged;
+	const Ship *ptr = _ships + ship_id;
+
+	damaged = ptr->shieldDamage || ptr->driveDamage ||
+		ptr->computerDamage || ptr->armorDamage ||
+		ptr->structureDamage;
+
+	for (i = 0; i < sizeof(ptr->damagedSpecials); i++) {
+		damaged = damaged || ptr->damagedSpecials[i];
+	}
+
+	_shipTable.owner[ship_id] = ptr->owner;
+	_shipTable.status[ship_id] = ptr->status;
+	_shipTable.x[ship_id] = ptr->x;
+	_shipTable.y[ship_id] = ptr->y;
+	_shipTable.star[ship_id] = ptr->getStarID();
+	_shipTable.type[ship_id] = ptr->design.type;
+	_shipTable.size[ship_id] = ptr->design.size;
+	_shipTable.damaged[ship_id] = damaged;
+}
+
+void GameState::updatePlanetRow(unsigned planet_id) {
+	const Planet *ptr = _planets + planet_id;
+
+	_planetTable.colony[planet_id] = ptr->colony;
+	_planetTable.star[planet_id] = ptr->star;
+	_planetTable.type[planet_id] = ptr->type;
+	_planetTable.gravity[planet_id] = ptr->gravity;
+	_planetTable.minerals[planet_id] = ptr->minerals;
+	_planetTable.climate[planet_id] = ptr->colony >= 0 &&
+		ptr->colony < MAX_COLONIES ?
+		_colonies[ptr->colony].climate : ptr->climate;
+}
+
+void GameState::updateColonyRow(unsigned colony_id) {
+	_colonyTable.owner[colony_id] = _colonies[colony_id].owner;
+	_colonyTable.planet[colony_id] = _colonies[colony_id].planet;
+}
+
+void GameState::updatePlayerRow(unsigned player_id) {
+	unsigned i;
+	uint64_t bit;
+	uint8_t mask = 1 << player_id;
+	const Player *pptr = _players + player_id;
+	int valid = player_id < _playerCount;
+
+	memset(_techTable.known[player_id], 0, TECH_WORDS * sizeof(uint64_t));
+	memset(_techTable.researchable[player_id], 0,
+		TECH_WORDS * sizeof(uint64_t));
+	memset(_techTable.readyTopics[player_id], 0,
+		TOPIC_WORDS * sizeof(uint64_t));
+	memset(_techTable.knownTopics[player_id], 0,
+		TOPIC_WORDS * sizeof(uint64_t));
+
+	for (i = 0; i < MAX_TECHNOLOGIES; i++) {
+		bit = (uint64_t)1 << (i % 64);
+		_techTable.owners[i] &= ~mask;
+
+		if (valid && pptr->knowsTechnology(i)) {
+			_techTable.known[player_id][i / 64] |= bit;
+			_techTable.owners[i] |= mask;
+		}
+
+		if (valid && pptr->canResearchTech(i)) {
+			_techTable.researchable[player_id][i / 64] |= bit;
+		}
+	}
+
+	for (i = 0; valid && i < MAX_RESEARCH_TOPICS; i++) {
+		bit = (uint64_t)1 << (i % 64);
+
+		if (pptr->canResearchTopic(i)) {
+			_techTable.readyTopics[player_id][i / 64] |= bit;
+		} else if (pptr->researchTopics[i] == RSTATE_KNOWN) {
+			_techTable.knownTopics[player_id][i / 64] |= bit;
+		}
+	}
+}
+
+void GameState::updateLeaderRow(unsigned leader_id) {
+	unsigned i, id, tier;
+	const Leader *ptr = _leaders + leader_id;
+
+	_leaderTable.skills[leader_id] = 0;
+	_leaderTable.advanced[leader_id] = 0;
+
+	for (i = 0; i < MAX_SKILLS; i++) {
+		id = Leader::skillID(i);
+		tier = ptr->hasSkill(id);
+		_leaderTable.bonus[leader_id][i] = tier ? ptr->skillBonus(id) : 0;
+
+		if (tier) {
+			_leaderTable.skills[leader_id] |= (uint32_t)1 << i;
+		}
+
+		if (tier > 1) {
+			_leaderTable.advanced[leader_id] |= (uint32_t)1 << i;
+		}
+	}
+
+	_leaderTable.hireCost[leader_id] = ptr->hireCost(0);
+}
+
+void GameState::updateStarRow(unsigned star_id) {
+	unsigned i;
+	int explored, charted, named;
+	const Star *sptr = _starSystems + star_id;
+	uint8_t players = (1 << _playerCount) - 1;
+
+	for (i = 0; i < MAX_PLAYERS; i++) {
+		explored = sptr->visited & (1 << i);
+		charted = explored || (_visibility.galaxyCharted & (1 << i));
+		named = charted ||
+			(sptr->hasColony & _visibility.contacts[i] & players);
+		setMaskBit(_visibility.explored[i], star_id, explored);
+		setMaskBit(_visibility.charted[i], star_id, charted);
+		setMaskBit(_visibility.named[i], star_id, named);
+		setMaskBit(_visibility.colonies[i], star_id,
+			sptr->hasColony & (1 << i));
+	}
+}
+
+void GameState::updateKnowledge(unsigned player_id) {
+	unsigned i, j;
+	uint8_t bit = 1 << player_id;
+	uint64_t mask;
+	const Player *pptr = _players + player_id;
+	VisibilityTable &vis = _visibility;
+
+	vis.visible[player_id] = vis.contacts[player_id] = 0;
+	vis.galaxyCharted &= ~bit;
+
+	if (player_id < _playerCount) {
+		if (pptr->galaxyCharted || pptr->traits[TRAIT_OMNISCIENCE]) {
+			vis.galaxyCharted |= bit;
+		}
+
+		for (i = 0; i < MAX_PLAYERS; i++) {
+			if (pptr->playerContacts[i]) {
+				vis.contacts[player_id] |= 1 << i;
+			}
+
+			if (pptr->isPlayerVisible(i)) {
+				vis.visible[player_id] |= 1 << i;
+			}
+		}
+	}
+
+	for (i = 0; i < STAR_WORDS; i++) {
+		mask = vis.explored[player_id][i];
+
+		if (vis.galaxyCharted & bit) {
+			mask = starWordMask(i, _starSystemCount);
+		}
+
+		vis.charted[player_id][i] = mask;
+
+		// Stars colonized by known players
+		for (j = 0; j < _playerCount; j++) {
+			if (vis.contacts[player_id] & (1 << j)) {
+				mask |= vis.colonies[j][i];
+			}
+		}
+
+		vis.named[player_id][i] = mask;
+	}
+}
+
+void GameState::updateHotTables(void) {
+	unsigned i;
+
+	memset(&_visibility, 0, sizeof(_visibility));
+
+	for (i = 0; i < _starSystemCount; i++) {
+		updateStarRow(i);
+		setMaskBit(_visibility.owned, i, _starSystems[i].owner >= 0);
+	}
+
+	for (i = 0; i < MAX_PLAYERS; i++) {
+		updateKnowledge(i);
+	}
+
+	for (i = 0; i < LEADER_COUNT; i++) {
+		updateLeaderRow(i);
+	}
+
+	for (i = 0; i < MAX_PLAYERS; i++) {
+		updatePlayerRow(i);
+	}
+
+	for (i = 0; i < _shipCount; i++) {
+		updateShipRow(i);
+	}
+
+	for (i = 0; i < _planetCount; i++) {
+		updatePlanetRow(i);
+	}
+
+	for (i = 0; i < _colonyCount; i++) {
+		updateColonyRow(i);
+	}
+}
+
+const ShipTable &GameState::shipTable(void) const {
+	return _shipTable;
+}
+
+const PlanetTable &GameState::planetTable(void) const {
+	return _planetTable;
+}
+
+const ColonyTable &GameState::colonyTable(void) const {
+	return _colonyTable;
+}
+
+const TechTable &GameState::techTable(void) const {
+	return _techTable;
+}
+
+const LeaderTable &GameState::leaderTable(void) const {
+	return _leaderTable;
+}
+
+const VisibilityTable &GameState::visibilityTable(void) const {
+	return _visibility;
+}
+
+unsigned GameState::techOwners(unsigned tech_id) const {
+	if (tech_id >= MAX_TECHNOLOGIES) {
+		throw std::out_of_range("Invalid technology ID");
+	}
+
+	return _techTable.owners[tech_id];
+}
+
+void GameState::evalShipStrength(const unsigned *ship_ids, size_t count,
+	int ignoreDamage, ShipStrength *out) const {
+
+	size_t i, j, batch, specCount;
+	unsigned id, bits, size, maxHP, hp, minHP, speed;
+	StrengthInput in[STRENGTH_BATCH];
+	const Ship *sptr;
+
+	specCount = sizeof(strengthSpecials) / sizeof(strengthSpecials[0]);
+
+	for (; count > 0; count -= batch, ship_ids += batch, out += batch) {
+		batch = MIN(count, STRENGTH_BATCH);
+
+		// Gather inputs from ship records, owners and officers
+		for (i = 0; i < batch; i++) {
+			if (ship_ids[i] >= _shipCount) {
+				throw std::out_of_range("Invalid ship ID");
+			}
+
+			sptr = _ships + ship_ids[i];
+			size = sptr->design.size;
+			in[i].specials = 0;
+
+			for (j = 0; j < specCount; j++) {
+				id = strengthSpecials[j][0];
+				bits = sptr->design.specials[id / 8];
+
+				if (!ignoreDamage) {
+					bits &= ~sptr->damagedSpecials[id / 8];
+				}
+
+				if (bits & (1 << (id % 8))) {
+					in[i].specials |= strengthSpecials[j][1];
+				}
+			}
+
+			in[i].driveDamage = ignoreDamage ? 0 : sptr->driveDamage;
+			in[i].computerDamage = ignoreDamage ? 0 :
+				sptr->computerDamage;
+			in[i].maxComputerHP = size < MAX_COMBAT_SHIP_CLASSES ?
+				computerHPTable[size] : 0;
+			in[i].baseDriveHP = size < MAX_COMBAT_SHIP_CLASSES ?
+				driveHPTable[size] : 0;
+			in[i].baseSpeed = sptr->design.baseCombatSpeed;
+			in[i].computerBonus =
+				computerBonusTable[sptr->design.computer];
+			in[i].transDimensional = 0;
+			in[i].attackBonus =
+				shipCrewOffenseBonuses[sptr->crewLevel];
+			in[i].defenseBonus =
+				shipCrewDefenseBonuses[sptr->crewLevel];
+
+			if (sptr->owner < _playerCount) {
+				const Player *owner = _players + sptr->owner;
+
+				in[i].transDimensional =
+					owner->traits[TRAIT_TRANS_DIMENSIONAL] ?
+					1 : 0;
+				in[i].attackBonus +=
+					owner->traits[TRAIT_SHIP_ATTACK];
+				in[i].defenseBonus +=
+					owner->traits[TRAIT_SHIP_DEFENSE];
+			}
+
+			if (sptr->officer >= 0) {
+				in[i].attackBonus += leaderSkillBonus(
+					sptr->officer, SKILL_WEAPONRY);
+				in[i].defenseBonus += leaderSkillBonus(
+					sptr->officer, SKILL_HELMSMAN);
+			}
+		}
+
+		// Same formulas as ShipDesign methods over packed inputs
+		for (i = 0; i < batch; i++) {
+			maxHP = in[i].baseDriveHP;
+
+			if (in[i].specials & STRENGTH_REINFORCED_HULL) {
+				maxHP *= 3;
+			}
+
+			hp = in[i].driveDamage >= 100 ? 0 :
+				maxHP * (100 - in[i].driveDamage) / 100;
+			minHP = (2 * maxHP) / 3;
+			speed = in[i].baseSpeed;
+
+			if (in[i].specials & STRENGTH_AUGMENTED_ENGINES) {
+				speed += 5;
+			}
+
+			speed = minHP < hp ?
+				speed * (hp - minHP) / (maxHP - minHP) : 0;
+			speed += 4 * in[i].transDimensional;
+
+			out[i].combatSpeed = speed;
+			out[i].driveHP = hp;
+			out[i].computerHP =
+				in[i].computerDamage < in[i].maxComputerHP ?
+				in[i].maxComputerHP - in[i].computerDamage : 0;
+			out[i].beamOffense = in[i].attackBonus +
+				(out[i].computerHP ? in[i].computerBonus : 0) +
+				(in[i].specials & STRENGTH_BATTLE_SCANNER ?
+				50 : 0);
+			out[i].beamDefense = in[i].defenseBonus + 5 * speed +
+				(in[i].specials & STRENGTH_INERTIAL_NULLIFIER ?
+				100 : 0) +
+				(in[i].specials & STRENGTH_INERTIAL_STABILIZER ?
+				50 : 0);
+		}
+	}
+}
+
+void GameState::evalFleetStrength(const Fleet *flt, int ignoreDamage,
+	FleetStrength *out) const {
+
+	size_t i, j, count, total = flt->shipCount();
+	unsigned ids[STRENGTH_BATCH];
+	ShipStrength tmp[STRENGTH_BATCH];
+
+	memset(out, 0, sizeof(FleetStrength));
+	i = 0;
+
+	while (i < total) {
+		for (count = 0; count < STRENGTH_BATCH && i < total; i++) {
+			if (flt->getShip(i)->design.type == COMBAT_SHIP) {
+				ids[count++] = flt->getShipID(i);
+			}
+		}
+
+		evalShipStrength(ids, count, ignoreDamage, tmp);
+
+		for (j = 0; j < count; j++) {
+			if (!out->combatShips ||
+				tmp[j].combatSpeed < out->minCombatSpeed) {
+				out->minCombatSpeed = tmp[j].combatSpeed;
+			}
+
+			out->combatShips++;
+			out->beamOffense += tmp[j].beamOffense;
+			out->beamDefense += tmp[j].beamDefense;
+			out->computerHP += tmp[j].computerHP;
+			out->driveHP += tmp[j].driveHP;
+		}
+	}
+}
+
+int GameState::leaderSkillBonus(unsigned leader_id, unsigned skill) const {
+	if (leader_id >= LEADER_COUNT) {
+		throw std::out_of_range("Invalid leader ID");
+	}
+
+	return _leaderTable.bonus[leader_id][Leader::skillIndex(skill)];
+}
+
+unsigned GameState::leaderHireCost(unsigned leader_id, int modifier) const {
+	int ret;
+
+	if (leader_id >= LEADER_COUNT) {
+		throw std::out_of_range("Invalid leader ID");
+	}
+
+	ret = _leaderTable.hireCost[leader_id] + modifier;
+	return MAX(ret, 0);
+}
+
+int GameState::leaderHireModifier(unsigned player_id) const {
+	unsigned i, famous = Leader::skillIndex(SKILL_FAMOUS);
+	int ret = 0;
+	const Leader *ptr;
+
+	for (i = 0; i < LEADER_COUNT; i++) {
+		ptr = _leaders + i;
+
+		if (ptr->playerIndex != (int)player_id || !ptr->isEmployed()) {
+			continue;
+		}
 
 		// The bonus is not cumulative, only the leader with
 		// the highest effect counts
-		tmp = ptr->skillBonus(SKILL_FAMOUS);
-		ret = MIN(tmp, ret);
+		ret = MIN(_leaderTable.bonus[i][famous], ret);
 	}
 
 	return ret;
@@ -2432,11 +3772,12 @@ unsigned GameState::leaderMaintenanceCost(unsigned leader_id,
 	if (leader_id >= LEADER_COUNT) {
 		throw std::out_of_range("Invalid leader ID");
 	} else if (leader_id == LEADER_ID_LOKNAR ||
-		_leaders[leader_id].hasSkill(SKILL_MEGAWEALTH)) {
+		(_leaderTable.skills[leader_id] &
+		((uint32_t)1 << Leader::skillIndex(SKILL_MEGAWEALTH)))) {
 		return 0;
 	}
 
-	ret = (_leaders[leader_id].hireCost(modifier) + 99) / 100;
+	ret = (leaderHireCost(leader_id, modifier) + 99) / 100;
 	return MAX(ret, 1);
 }
 
@@ -2476,98 +3817,114 @@ void GameState::sort_ids(unsigned *id_list, unsigned length, int player,
 	sort_ids(id_list + j, length - j, player, cmp);
 }
 
-void GameState::dump(void) const {
-	const char *trait_names[] = {
-		"Government", "Population", "Farming", "Industry", "Science",
-		"Money", "Ship defense", "Ship attack", "Ground combat",
-		"Spying", "Low G homeworld", "High G homeworld", "Aquatic",
-		"Subterranean", "Large homeworld", "Rich homeworld",
-		"Artifacts homeworld", "Cybernetic", "Lithovore", "Repulsive",
-		"Charismatic", "Uncreative", "Creative", "Tolerant",
-		"Fantastic traders", "Telepathic", "Lucky", "Omniscience",
-		"Stealthy ships", "Trans-dimensional", "Warlord"
-	};
+void GameState::sort_ids(unsigned *id_list, unsigned length, int player,
+	gamestate_key_func key) {
 
-	fprintf(stdout, "=== Config ===\n");
-	fprintf(stdout, "Version: %d\n", _gameConfig.version);
-	fprintf(stdout, "Save game name: %s\n", _gameConfig.saveGameName);
-	fprintf(stdout, "Stardate: %d\n", _gameConfig.stardate);
-	fprintf(stdout, "End of turn summary: %d\n", _gameConfig.endOfTurnSummary);
-	fprintf(stdout, "End of turn wait: %d\n", _gameConfig.endOfTurnWait);
-	fprintf(stdout, "Random events: %d\n", _gameConfig.randomEvents);
-	fprintf(stdout, "Enemy moves: %d\n", _gameConfig.enemyMoves);
-	fprintf(stdout, "Expanding help: %d\n", _gameConfig.expandingHelp);
-	fprintf(stdout, "Autoselect ships: %d\n", _gameConfig.autoSelectShips);
-	fprintf(stdout, "Animations: %d\n", _gameConfig.animations);
-	fprintf(stdout, "Auto select colony: %d\n", _gameConfig.autoSelectColony);
-	fprintf(stdout, "Show relocation lines: %d\n", _gameConfig.showRelocationLines);
-	fprintf(stdout, "Show GNN Report: %d\n", _gameConfig.showGNNReport);
-	fprintf(stdout, "Auto delete trade good housing: %d\n", _gameConfig.autoDeleteTradeGoodHousing);
-	fprintf(stdout, "Show only serious turn summary: %d\n", _gameConfig.showOnlySeriousTurnSummary);
-	fprintf(stdout, "Ship initiative: %d\n", _gameConfig.shipInitiative);
-
-	fprintf(stdout, "=== Galaxy ===\n");
-	fprintf(stdout, "Size factor: %d\n", _galaxy.sizeFactor);
-	fprintf(stdout, "width: %d\n", _galaxy.width);
-	fprintf(stdout, "height: %d\n", _galaxy.height);
-
-	fprintf(stdout, "\n=== Hero ===\n");
-	for (int i = 0; i < LEADER_COUNT; i++) {
-		fprintf(stdout, "Name: %s\n", _leaders[i].name);
-		fprintf(stdout, "Title: %s\n", _leaders[i].title);
-		fprintf(stdout, "Type: %d\n", _leaders[i].type);
-		fprintf(stdout, "Experience: %d\n", _leaders[i].experience);
-		fprintf(stdout, "Common skills: %u\n", _leaders[i].commonSkills);
-		fprintf(stdout, "Special skills: %u\n", _leaders[i].specialSkills);
-		for (int j = 0; j < MAX_LEADER_TECH_SKILLS; j++) {
-			fprintf(stdout, "Tech: %d\n", _leaders[i].techs[j]);
-		}
-		fprintf(stdout, "Picture: %d\n", _leaders[i].picture);
-		fprintf(stdout, "Skill value: %d\n", _leaders[i].skillValue);
-		fprintf(stdout, "Level: %d\n", _leaders[i].level);
-		fprintf(stdout, "Location: %d\n", _leaders[i].location);
-		fprintf(stdout, "ETA: %d\n", _leaders[i].eta);
-		fprintf(stdout, "Level up: %d\n", _leaders[i].displayLevelUp);
-		fprintf(stdout, "Status: %d\n", _leaders[i].status);
-		fprintf(stdout, "Player: %d\n", _leaders[i].playerIndex);
-	}
-
-	fprintf(stdout, "\n=== Players (%d) ===\n", _playerCount);
-	for (int i = 0; i < _playerCount; i++) {
-		fprintf(stdout, "Name:\t%s\tRace:\t%s\n",
-			_players[i].name, _players[i].race);
-		fprintf(stdout, "Picture:\t\t%d\tColor:\t\t\t%d\tPersonality:\t\t%d\n",
-			_players[i].picture, _players[i].color, _players[i].personality);
-		fprintf(stdout, "Objective:\t\t%d\tTax rate:\t\t%d\tBC:\t\t\t%d\n",
-			_players[i].objective, _players[i].taxRate, _players[i].BC);
-		fprintf(stdout, "Total freighters:\t%d\tUsed freighters:\t%d\tCommand points:\t\t%d\n",
-			_players[i].totalFreighters, _players[i].surplusFreighters, _players[i].commandPoints);
-		fprintf(stdout, "Total production:\t%d\tRP:\t\t\t%d\tFood:\t\t\t%d\n",
-			_players[i].industryProduced, _players[i].researchProduced, _players[i].surplusFood);
-		fprintf(stdout, "Yearly BC:\t\t%d\tResearch progress:\t%u\tResearch Topic:\t\t%d\n",
-			_players[i].surplusBC, _players[i].researchProgress, (int)_players[i].researchTopic);
-		fprintf(stdout, "Research Item:\t\t%d\n",
-			_players[i].researchItem);
-
-		fprintf(stdout, "--- Traits ---\n");
-		printf("- Government: %d\n",
-			_players[i].traits[TRAIT_GOVERNMENT]);
-
-		for (int j = 1; j < TRAITS_COUNT; j++) {
-			if (_players[i].traits[j]) {
-				printf("- %s: %d\n", trait_names[j],
-					_players[i].traits[j]);
-			}
+	unsigned i;
+	SortKey *items;
+
+	if (length <= 1) {
+		return;
+	}
+
+	items = new SortKey[2 * length];
+
+	try {
+		for (i = 0; i < length; i++) {
+			items[i].key = key(this, player, id_list[i]);
+			items[i].id = id_list[i];
 		}
+	} catch (...) {
+		delete[] items;
+		throw;
+	}
+
+	radixSort(items, items + length, length);
+
+	for (i = 0; i < length; i++) {
+		id_list[i] = items[i].id;
+	}
+
+	delete[] items;
+}
+
+// Print all records of one savegame section
+static void dumpSection(const char *title, const RecordLayout &layout,
+	const void *records, size_t stride, unsigned count) {
+
+	unsigned i;
+	const uint8_t *ptr = (const uint8_t*)records;
+
+	fprintf(stdout, "\n=== %s (%u) ===\n", title, count);
+
+	for (i = 0; i < count; i++, ptr += stride) {
+		fprintf(stdout, "--- %s %u ---\n", layout.name, i);
+		dumpRecord(layout, ptr, stdout);
 	}
+}
+
+void GameState::dump(void) const {
+	fprintf(stdout, "=== Config ===\n");
+	dumpRecord(gameConfigLayout, &_gameConfig, stdout);
+
+	fprintf(stdout, "\n=== Galaxy ===\n");
+	dumpRecord(galaxyLayout, &_galaxy, stdout);
+
+	dumpSection("Colonies", colonyLayout, _colonies, sizeof(Colony),
+		_colonyCount);
+	dumpSection("Planets", planetLayout, _planets, sizeof(Planet),
+		_planetCount);
+	dumpSection("Stars", starLayout, static_cast<const StarData*>(
+		_starSystems), sizeof(Star), _starSystemCount);
+	dumpSection("Heroes", leaderLayout, _leaders, sizeof(Leader),
+		LEADER_COUNT);
+	dumpSection("Players", playerLayout, _players, sizeof(Player),
+		_playerCount);
+	dumpSection("Ships", shipLayout, _ships, sizeof(Ship), _shipCount);
+}
+
+// Sort key giving the same order as Ship::operator<()
+static uint32_t shipSortKey(const Ship *s) {
+	return (s->design.type << 24) | ((0xff - s->design.size) << 16) |
+		(s->design.builder << 8) | (0xff - s->design.picture);
+}
 
-	fprintf(stdout, "Number of stars: %d\n", _starSystemCount);
-	for (int i = 0; i < _starSystemCount; i++) {
-		const Star &star = _starSystems[i];
-		fprintf(stdout, "\nName:\t%s (%d)\n", star.name, i);
-		fprintf(stdout, "Class:\t\t%x\t\tSize:\t\t%x\t\tPicture:\t%x\n", (unsigned)star.spectralClass, (unsigned)star.size, star.pictureType);
-		fprintf(stdout, "Position:\t%d,%d\tPrimary owner:\t%d\n", star.x, star.y, star.owner);
-		fprintf(stdout, "Special:\t%d\t\tWormhole:\t%d\n", (int)star.special, star.wormhole);
+GameSnapshot::GameSnapshot(void) : _refs(1) {
+	memset(_versions, 0, sizeof(_versions));
+}
+
+GameSnapshot::~GameSnapshot(void) {
+
+}
+
+int GameSnapshot::isShared(void) {
+	int ret;
+
+	_lock.lock();
+	ret = _refs > 1;
+	_lock.unlock();
+	return ret;
+}
+
+const GameState &GameSnapshot::state(void) const {
+	return _state;
+}
+
+void GameSnapshot::acquire(void) {
+	_lock.lock();
+	_refs++;
+	_lock.unlock();
+}
+
+void GameSnapshot::release(void) {
+	unsigned refs;
+
+	_lock.lock();
+	refs = --_refs;
+	_lock.unlock();
+
+	if (!refs) {
+		delete this;
 	}
 }
 
@@ -2640,9 +3997,9 @@ Fleet::~Fleet(void) {
 	delete[] _ships;
 }
 
-void Fleet::addShip(unsigned ship_id) {
+Ship *Fleet::checkShip(unsigned ship_id) {
 	Ship *s;
-	int dest, i = 0, j = _shipCount, pos;
+	int dest;
 
 	if (ship_id >= _parent->_shipCount) {
 		throw std::out_of_range("Invalid ship ID");
@@ -2661,6 +4018,15 @@ void Fleet::addShip(unsigned ship_id) {
 		throw std::runtime_error("Ship state does not match fleet");
 	}
 
+	return s;
+}
+
+void Fleet::addShip(unsigned ship_id) {
+	Ship *s;
+	int i = 0, j = _shipCount, pos;
+
+	s = checkShip(ship_id);
+
 	if (_shipCount >= _maxShips) {
 		unsigned *tmp;
 		size_t size = 2 * _maxShips;
@@ -2697,6 +4063,54 @@ void Fleet::addShip(unsigned ship_id) {
 	// FIXME: update _hasNavigator, recalculate speed, eta and update ships
 }
 
+void Fleet::addShips(const unsigned *ship_ids, size_t count) {
+	size_t i;
+	Ship *s;
+	unsigned *tmp;
+	SortKey *keys;
+
+	for (i = 0; i < count; i++) {
+		checkShip(ship_ids[i]);
+	}
+
+	if (_shipCount + count > _maxShips) {
+		size_t size = _shipCount + count;
+
+		tmp = new unsigned[size];
+		memcpy(tmp, _ships, _shipCount * sizeof(unsigned));
+		delete[] _ships;
+		_ships = tmp;
+		_maxShips = size;
+	}
+
+	keys = new SortKey[2 * (_shipCount + count)];
+
+	for (i = 0; i < count; i++) {
+		s = _parent->_ships + ship_ids[i];
+		_ships[_shipCount++] = ship_ids[i];
+		_shipTypeCounts[s->design.type]++;
+
+		if (s->design.type == COMBAT_SHIP) {
+			_combatCounts[s->design.size]++;
+		}
+	}
+
+	for (i = 0; i < _shipCount; i++) {
+		keys[i].key = shipSortKey(_parent->_ships + _ships[i]);
+		keys[i].id = _ships[i];
+	}
+
+	// Stable sort gives the same order as adding ships one by one
+	radixSort(keys, keys + _shipCount, _shipCount);
+
+	for (i = 0; i < _shipCount; i++) {
+		_ships[i] = keys[i].id;
+	}
+
+	delete[] keys;
+	// FIXME: update _hasNavigator, recalculate speed, eta and update ships
+}
+
 void Fleet::removeShip(size_t pos) {
 	size_t i;
 	const Ship *s;
@@ -2811,6 +4225,120 @@ uint16_t Fleet::getY(void) const {
 	return _y;
 }
 
+uint8_t Fleet::getWarpSpeed(void) const {
+	return _warpSpeed;
+}
+
+PlanetFilter::PlanetFilter(const GameState *game, unsigned player) :
+	_game(game), _player(player) {
+
+	if (player >= MAX_PLAYERS) {
+		throw std::out_of_range("Invalid player ID");
+	}
+
+	memset(_candidates, 0, sizeof(_candidates));
+	memset(_masks, 0, sizeof(_masks));
+}
+
+void PlanetFilter::setBit(uint64_t *mask, unsigned planet_id, int value) {
+	uint64_t bit = (uint64_t)1 << (planet_id % 64);
+
+	if (value) {
+		mask[planet_id / 64] |= bit;
+	} else {
+		mask[planet_id / 64] &= ~bit;
+	}
+}
+
+void PlanetFilter::update(void) {
+	unsigned i;
+
+	memset(_candidates, 0, sizeof(_candidates));
+	memset(_masks, 0, sizeof(_masks));
+
+	for (i = 0; i < _game->_starSystemCount; i++) {
+		updateStar(i);
+	}
+}
+
+void PlanetFilter::updateStar(unsigned star_id) {
+	unsigned i, id;
+	int owner, safe, inRange, candidate, habitable;
+	const Star *sptr;
+	const Player *player = _game->_players + _player;
+	const BilistNode<Fleet> *node;
+	const PlanetTable &planets = _game->planetTable();
+
+	if (star_id >= _game->_starSystemCount) {
+		throw std::out_of_range("Invalid star ID");
+	}
+
+	sptr = _game->_starSystems + star_id;
+	candidate = _game->isStarExplored(sptr, _player) >= STAR_CHARTED;
+	// Hostile colony in this star system
+	safe = !(sptr->hasColony & ~(1 << _player));
+
+	// Hostile fleet orbiting star
+	// FIXME: ignore hidden fleets (known but unvisited star)
+	for (node = sptr->getOrbitingFleets(); safe && node;
+		node = node->next()) {
+		if (node->data && node->data->getOwner() != _player) {
+			safe = 0;
+		}
+	}
+
+	inRange = _game->isStarInRange(star_id, _player);
+
+	for (i = 0; i < MAX_ORBITS; i++) {
+		if (sptr->planetIndex[i] < 0) {
+			continue;
+		}
+
+		id = sptr->planetIndex[i];
+		owner = -1;
+
+		if (planets.colony[id] >= 0) {
+			owner = _game->colonyTable().owner[planets.colony[id]];
+		}
+
+		// Ignore invalid and own planets
+		habitable = planets.type[id] == PlanetType::HABITABLE;
+		setBit(_candidates, id, candidate && habitable &&
+			owner != (int)_player);
+		setBit(_masks[PLANET_FILTER_NO_ENEMY], id, safe);
+		setBit(_masks[PLANET_FILTER_GRAVITY], id, habitable &&
+			player->gravityPenalty(planets.gravity[id]) >= 0);
+		setBit(_masks[PLANET_FILTER_CLIMATE], id,
+			planets.climate[id] >= PlanetClimate::DESERT);
+		setBit(_masks[PLANET_FILTER_MINERALS], id,
+			planets.minerals[id] >= PlanetMinerals::ABUNDANT);
+		setBit(_masks[PLANET_FILTER_RANGE], id, inRange);
+	}
+}
+
+unsigned PlanetFilter::filter(unsigned flags, unsigned *ids) const {
+	unsigned i, j, count = 0;
+	uint64_t word;
+
+	for (i = 0; i < PLANET_FILTER_WORDS; i++) {
+		word = _candidates[i];
+
+		for (j = 0; j < PLANET_FILTER_COUNT; j++) {
+			if (flags & (1 << j)) {
+				word &= _masks[j][i];
+			}
+		}
+
+		for (j = 0; word; j++, word >>= 1) {
+			if (word & 1) {
+				ids[count++] = 64 * i + j;
+			}
+		}
+	}
+
+	return count;
+}
+
 int cmpPlanetClimate(const GameState *game, int player, unsigned a,
 	unsigned b) {
 
@@ -2836,3 +4364,16 @@ int cmpPlanetMaxPop(const GameState *game, int player, unsigned a,
 	popB = game->planetMaxPop(b, player);
 	return popB - popA;
 }
+
+// Planet lists are sorted in descending order
+uint32_t keyPlanetClimate(const GameState *game, int player, unsigned id) {
+	return ~(uint32_t)game->planetClimate(id);
+}
+
+uint32_t keyPlanetMinerals(const GameState *game, int player, unsigned id) {
+	return ~(uint32_t)game->_planets[id].minerals;
+}
+
+uint32_t keyPlanetMaxPop(const GameState *game, int player, unsigned id) {
+	return ~(uint32_t)game->planetMaxPop(id, player);
+}
@@ -24,6 +24,7 @@
 #include "stream.h"
 
 #define SAVE_GAME_NAME_SIZE 37
+#define SAVE_GAME_CONFIG_SIZE 59
 #define LEADER_COUNT 67
 #define LEADER_ID_LOKNAR 65
 #define LEADER_DATA_SIZE 59
@@ -53,8 +54,25 @@
 #define GRAVITY_LEVEL_COUNT 3
 #define TRAITS_COUNT 31
 
+// Player objectives, OBJECTIVE_HUMAN marks human players
+#define OBJECTIVE_DIPLOMAT 0
+#define OBJECTIVE_MILITARIST 1
+#define OBJECTIVE_EXPANSIONIST 2
+#define OBJECTIVE_TECHNOLOGIST 3
+#define OBJECTIVE_INDUSTRIALIST 4
+#define OBJECTIVE_ECOLOGIST 5
+#define AI_OBJECTIVE_COUNT 6
 #define OBJECTIVE_HUMAN 100
 
+// AI player personalities
+#define PERSONALITY_XENOPHOBIC 0
+#define PERSONALITY_RUTHLESS 1
+#define PERSONALITY_AGGRESSIVE 2
+#define PERSONALITY_ERRATIC 3
+#define PERSONALITY_HONORABLE 4
+#define PERSONALITY_PACIFISTIC 5
+#define AI_PERSONALITY_COUNT 6
+
 #define SHIP_NAME_SIZE 16
 
 #define MAX_LEADER_TECH_SKILLS 3
@@ -87,6 +105,33 @@
 #define NPC_FLEET_OWNERS (MAX_FLEET_OWNERS - MAX_PLAYERS)
 
 #define MAX_SPIES 0x3f
+// Galaxy coordinate units per parsec
+#define PARSEC_SIZE 30
+// Unknown value marker in DerivedCache
+#define DERIVED_INVALID 0xffff
+
+// Record arrays tracked by GameState version counters
+#define GAMESTATE_CONFIG 0
+#define GAMESTATE_STARS 1
+#define GAMESTATE_COLONIES 2
+#define GAMESTATE_PLANETS 3
+#define GAMESTATE_LEADERS 4
+#define GAMESTATE_PLAYERS 5
+#define GAMESTATE_SHIPS 6
+#define GAMESTATE_ARRAY_COUNT 7
+
+// Planet filter predicates
+#define PLANET_FILTER_NO_ENEMY 0
+#define PLANET_FILTER_GRAVITY 1
+#define PLANET_FILTER_CLIMATE 2
+#define PLANET_FILTER_MINERALS 3
+#define PLANET_FILTER_RANGE 4
+#define PLANET_FILTER_COUNT 5
+#define PLANET_FILTER_WORDS ((MAX_PLANETS + 63) / 64)
+// Research state bitset sizes
+#define TECH_WORDS ((MAX_TECHNOLOGIES + 63) / 64)
+#define TOPIC_WORDS ((MAX_RESEARCH_TOPICS + 63) / 64)
+#define STAR_WORDS ((MAX_STARS + 63) / 64)
 #define SPY_MISSION_MASK 0xc0
 #define SPY_MISSION_STEAL 0
 #define SPY_MISSION_SABOTAGE 0x40
@@ -769,9 +814,13 @@ extern const unsigned galaxySizeFactors[GALAXY_ZOOM_LEVELS];
 
 class Fleet;
 class GameState;
+class GameSnapshot;
 
 typedef int (*gamestate_cmp_func)(const GameState *gamestate, int player,
 	unsigned a, unsigned b);
+// Returns integer sort key of entity, lower keys are sorted first
+typedef uint32_t (*gamestate_key_func)(const GameState *gamestate, int player,
+	unsigned id);
 
 struct GameConfig {
 	uint32_t version;
@@ -794,7 +843,7 @@ struct GameConfig {
 
 	GameConfig(void);
 
-	void load(ReadStream &stream);
+	void load(DataCursor &stream);
 };
 
 struct Nebula {
@@ -803,7 +852,7 @@ struct Nebula {
 
 	Nebula(void);
 
-	void load(ReadStream &stream);
+	void load(DataCursor &stream);
 
 	void validate(void) const;
 };
@@ -817,7 +866,7 @@ struct Galaxy {
 
 	Galaxy(void);
 
-	void load(ReadStream &stream);
+	void load(DataCursor &stream);
 
 	void validate(void) const;
 };
@@ -831,7 +880,7 @@ struct Colonist {
 
 	Colonist(void);
 
-	void load(ReadStream &stream);
+	void load(DataCursor &stream);
 };
 
 struct Colony {
@@ -929,7 +978,7 @@ struct Colony {
 
 	Colony(void);
 
-	void load(ReadStream &stream);
+	void load(DataCursor &stream);
 
 	void validate(void) const;
 };
@@ -958,7 +1007,7 @@ struct Planet {
 
 	Planet(void);
 
-	void load(ReadStream &stream);
+	void load(DataCursor &stream);
 
 	unsigned baseProduction(void) const;
 
@@ -987,7 +1036,7 @@ struct Leader {
 
 	Leader(void);
 
-	void load(ReadStream &stream);
+	void load(DataCursor &stream);
 
 	unsigned expLevel(void) const;
 	const char *rank(void) const;
@@ -1012,6 +1061,11 @@ struct Leader {
 
 	// Find skill number (e.g. icon ID) for given skill ID
 	static unsigned skillNum(unsigned id);
+
+	// Convert between skill ID and dense skill index in range
+	// [0, MAX_SKILLS), used as bit and column number in LeaderTable
+	static unsigned skillIndex(unsigned id);
+	static unsigned skillID(unsigned index);
 };
 
 struct ShipWeapon {
@@ -1021,7 +1075,7 @@ struct ShipWeapon {
 	uint16_t mods;
 	uint8_t ammo;
 
-	void load(ReadStream &stream);
+	void load(DataCursor &stream);
 
 	unsigned arcID(void) const;
 	const char *arcAbbr(void) const;
@@ -1043,7 +1097,7 @@ struct ShipDesign {
 
 	ShipDesign(void);
 
-	void load(ReadStream &stream);
+	void load(DataCursor &stream);
 
 	int hasSpecial(unsigned id) const;
 	int hasWorkingSpecial(unsigned id, const uint8_t* specDamage) const;
@@ -1073,7 +1127,7 @@ struct SettlerInfo {
 	unsigned eta;
 	unsigned job;
 
-	void load(ReadStream &stream);
+	void load(DataCursor &stream);
 };
 
 struct Player {
@@ -1144,13 +1198,16 @@ struct Player {
 
 	Player(void);
 
-	void load(SeekableReadStream &stream);
+	void load(DataCursor &stream);
 
 	int gravityPenalty(unsigned gravity) const;
 
 	// returns 0/1 for applied techs, or current level for hyper techs
 	unsigned knowsTechnology(unsigned tech_id) const;
 
+	// Ship range from colonies in parsecs, 0 means unlimited range
+	unsigned fuelRange(void) const;
+
 	// returns 1 if the topic can be researched now
 	int canResearchTopic(unsigned topic_id) const;
 	unsigned researchCost(unsigned topic_id, int full) const;
@@ -1170,21 +1227,15 @@ struct Player {
 	void validate(void) const;
 };
 
-class Star {
-private:
-	BilistNode<Fleet> _firstOrbitingFleet, _lastOrbitingFleet;
-	BilistNode<Fleet> _firstLeavingFleet, _lastLeavingFleet;
-
-	// Do NOT implement
-	Star(const Star &other);
-	const Star &operator=(const Star &other);
-
-public:
+// Star data stored in savegame
+struct StarData {
 	char name[STARS_NAME_SIZE];
 	uint16_t x;
 	uint16_t y;
 	uint8_t size;
-	int8_t owner;
+	// Owner byte of the savegame, written back unchanged. Use Star::owner
+	// for display.
+	int8_t savedOwner;
 	uint8_t pictureType;
 	uint8_t spectralClass;
 	// Remembers the last selected planet for the system for each player
@@ -1247,13 +1298,30 @@ public:
 	uint8_t inNebula;
 	// Has the ancient artifacts app been given out yet?
 	uint8_t artifactsGaveApp;
+};
+
+class Star : public StarData {
+private:
+	BilistNode<Fleet> _firstOrbitingFleet, _lastOrbitingFleet;
+	BilistNode<Fleet> _firstLeavingFleet, _lastLeavingFleet;
+
+	// Do NOT implement
+	Star(const Star &other);
+	const Star &operator=(const Star &other);
+
+public:
+	// Owner as seen by the active player, -1 = unknown or none. Starts
+	// as savedOwner, GameState::setActivePlayer() updates it.
+	int8_t owner;
 
 	Star(void);
 	~Star(void);
 
-	void load(ReadStream &stream);
+	void load(DataCursor &stream);
 
 	void addFleet(Fleet *f);
+	// Delete all orbiting and leaving fleets
+	void clearFleets(void);
 	BilistNode<Fleet> *getOrbitingFleets(void);
 	BilistNode<Fleet> *getLeavingFleets(void);
 	const BilistNode<Fleet> *getOrbitingFleets(void) const;
@@ -1287,7 +1355,7 @@ struct Ship {
 	bool operator>(const Ship &other) const;
 	bool operator>=(const Ship &other) const;
 
-	void load(ReadStream &stream);
+	void load(DataCursor &stream);
 
 	// _starSystemCount is the special ID of Antaran homeworld
 	unsigned getStarID(void) const;
@@ -1310,9 +1378,161 @@ struct Ship {
 	void validate(void) const;
 };
 
+// Combat values of one ship, see GameState::evalShipStrength()
+struct ShipStrength {
+	int beamOffense, beamDefense;
+	unsigned combatSpeed, computerHP, driveHP;
+};
+
+// Combat values of all combat ships in a fleet
+struct FleetStrength {
+	unsigned combatShips;
+	long beamOffense, beamDefense;
+	unsigned computerHP, driveHP;
+	// Speed of the slowest combat ship, 0 if there are none
+	unsigned minCombatSpeed;
+};
+
+// Frequently scanned fields of ship, planet and colony records stored
+// in separate arrays. The records stay authoritative, GameState refreshes
+// the tables on load and in invalidate*() calls.
+struct ShipTable {
+	uint8_t owner[MAX_SHIPS], status[MAX_SHIPS];
+	uint16_t x[MAX_SHIPS], y[MAX_SHIPS];
+	// Ship::getStarID()
+	uint16_t star[MAX_SHIPS];
+	uint8_t type[MAX_SHIPS], size[MAX_SHIPS];
+	// Nonzero if any ship system has damage
+	uint8_t damaged[MAX_SHIPS];
+};
+
+struct PlanetTable {
+	int16_t colony[MAX_PLANETS];
+	uint8_t star[MAX_PLANETS], type[MAX_PLANETS];
+	uint8_t gravity[MAX_PLANETS], minerals[MAX_PLANETS];
+	// GameState::planetClimate()
+	uint8_t climate[MAX_PLANETS];
+};
+
+struct ColonyTable {
+	uint8_t owner[MAX_COLONIES];
+	int16_t planet[MAX_COLONIES];
+};
+
+// Decoded skills of all leaders indexed by Leader::skillIndex(). Bonuses
+// depend on experience level, call GameState::invalidateLeader() after
+// leader experience or skills change.
+struct LeaderTable {
+	// Bit N is set if the leader has skill with index N
+	uint32_t skills[LEADER_COUNT];
+	// Skills at advanced tier
+	uint32_t advanced[LEADER_COUNT];
+	// Leader::skillBonus()
+	int16_t bonus[LEADER_COUNT][MAX_SKILLS];
+	// Leader::hireCost() without modifier
+	unsigned hireCost[LEADER_COUNT];
+};
+
+// Star knowledge of all players as bitsets over star IDs, see
+// GameState::isStarExplored(). Visited stars are also charted and charted
+// stars are also named.
+struct VisibilityTable {
+	uint64_t explored[MAX_PLAYERS][STAR_WORDS];
+	uint64_t charted[MAX_PLAYERS][STAR_WORDS];
+	uint64_t named[MAX_PLAYERS][STAR_WORDS];
+	// Stars with colonies of each player, Star::hasColony
+	uint64_t colonies[MAX_PLAYERS][STAR_WORDS];
+	// Stars which have Star::owner set
+	uint64_t owned[STAR_WORDS];
+	// Stars within fuel range of each player's colonies and outposts
+	uint64_t inRange[MAX_PLAYERS][STAR_WORDS];
+	// Player::isPlayerVisible() and Player::playerContacts bitmasks
+	uint8_t visible[MAX_PLAYERS], contacts[MAX_PLAYERS];
+	// Players who know the whole galaxy map
+	uint8_t galaxyCharted;
+};
+
+// Research state of all players as bitsets over tech and topic IDs.
+// Hyper-advanced techs count as known from the first level.
+struct TechTable {
+	uint64_t known[MAX_PLAYERS][TECH_WORDS];
+	uint64_t researchable[MAX_PLAYERS][TECH_WORDS];
+	// Topics in RSTATE_READY and RSTATE_KNOWN state
+	uint64_t readyTopics[MAX_PLAYERS][TOPIC_WORDS];
+	uint64_t knownTopics[MAX_PLAYERS][TOPIC_WORDS];
+	// Players who know each tech, bit N is player N
+	uint8_t owners[MAX_TECHNOLOGIES];
+};
+
+// Encodes a game snapshot and writes it to disk in background
+class SaveWriter : public Thread {
+private:
+	GameSnapshot *_snapshot;
+	char *_path;
+
+	// Do NOT implement
+	SaveWriter(const SaveWriter &other);
+	const SaveWriter &operator=(const SaveWriter &other);
+
+	void clear(void);
+
+protected:
+	void run(void);
+
+public:
+	SaveWriter(void);
+	~SaveWriter(void);
+
+	// Start saving snapshot to path. Waits for the previous save to
+	// finish first. SaveWriter takes over one snapshot reference.
+	void write(const char *path, GameSnapshot *snap);
+
+	// Wait until the current save is finished. Throws exception if
+	// the write failed.
+	void wait(void);
+};
+
+// Memoized values derived from several game records. Entries are filled
+// on first use and stay valid until explicitly invalidated.
+struct DerivedCache {
+	// Max population per planet and player, DERIVED_INVALID if unknown
+	uint16_t maxPop[MAX_PLANETS][MAX_PLAYERS];
+	// Ship stats indexed by the ignoreDamage flag
+	uint8_t shipValid[MAX_SHIPS];
+	uint8_t combatSpeed[MAX_SHIPS][2];
+	int16_t beamOffense[MAX_SHIPS][2], beamDefense[MAX_SHIPS][2];
+	unsigned long hits, misses;
+	// Filled up front and shared by reader threads, don't count hits
+	uint8_t frozen;
+};
+
 class GameState {
 private:
 	BilistNode<Fleet> _firstMovingFleet, _lastMovingFleet;
+	// Original savegame data, unknown bytes are written back unchanged
+	uint8_t *_saveData;
+	size_t _saveSize;
+	// Encoding the loaded records reproduces the original file,
+	// SAVE_EXACT_UNKNOWN until the first save after load
+	mutable uint8_t _saveExact;
+	SaveWriter _saveWriter;
+	// Star positions and moving fleets in galaxy coordinates. Fleets
+	// are keyed by insertion order to match the moving fleet list.
+	// Fleet position never changes after creation, addFleet() and
+	// removeFleet() keep the fleet index current.
+	SpatialGrid<Star> _starIndex;
+	SpatialGrid<Fleet> _fleetIndex;
+	unsigned _fleetSerial;
+	mutable DerivedCache _cache;
+	ShipTable _shipTable;
+	PlanetTable _planetTable;
+	ColonyTable _colonyTable;
+	TechTable _techTable;
+	LeaderTable _leaderTable;
+	VisibilityTable _visibility;
+	// Change counters of record arrays and the last snapshot taken
+	unsigned long _versions[GAMESTATE_ARRAY_COUNT];
+	GameSnapshot *_snapshot;
 
 	// Do NOT implement
 	GameState(const GameState &other);
@@ -1321,11 +1541,36 @@ private:
 protected:
 	Fleet *findFleet(unsigned owner, unsigned status, unsigned x,
 		unsigned y, unsigned star);
+	void createIndexes(void);
 	void createFleets(void);
+	void clearFleets(void);
+	// Decode the original file again and check that encoding it
+	// reproduces the file. Records may have changed since load, so they
+	// cannot be used. Runs only once per loaded file.
+	void checkSaveData(void) const;
+	// Copy record arrays which changed since the snapshot was taken and
+	// rebuild derived data of the snapshot
+	void updateSnapshot(GameSnapshot *snap) const;
 
 	void addFleet(Fleet *flt);
 	void removeFleet(Fleet *flt);
 
+	unsigned calcPlanetMaxPop(unsigned planet_id,
+		unsigned player_id) const;
+	void calcShipStats(unsigned ship_id) const;
+	// Fill all cache entries and stop further cache writes
+	void freezeCache(void);
+	void updateShipRow(unsigned ship_id);
+	void updatePlanetRow(unsigned planet_id);
+	void updateColonyRow(unsigned colony_id);
+	void updatePlayerRow(unsigned player_id);
+	void updateLeaderRow(unsigned leader_id);
+	void updateStarRow(unsigned star_id);
+	// Recalculate charted and named star bitsets of the player
+	void updateKnowledge(unsigned player_id);
+	// Returns ship ID if sptr points into the ship table, -1 otherwise
+	int cachedShipID(const Ship *sptr) const;
+
 public:
 	struct GameConfig _gameConfig;
 	struct Galaxy _galaxy;
@@ -1344,15 +1589,83 @@ public:
 	GameState(void);
 	~GameState(void);
 
-	void load(SeekableReadStream &stream);
+	// Parse savegame file data in a single pass
+	void load(const uint8_t *data, size_t size);
 	void load(const char *filename);
+	// Encode game state into savegame file data. Returns new[] allocated
+	// buffer.
+	uint8_t *saveData(size_t *size) const;
+	// Write savegame file. Throws exception if the loaded savegame could
+	// not be reproduced byte for byte, saving would corrupt it.
+	void save(const char *filename) const;
+	// Take a snapshot of the game state, encode it and write it to disk
+	// in background thread
+	void autosave(const char *filename);
+	// Wait until background save finishes
+	void waitForSave(void);
 	void validate(void) const;
 	void dump(void) const;
 
 	// update cached values which depend on active player
 	void setActivePlayer(unsigned player_id);
+	// Recalculate fuel range tables of all players. invalidateColony()
+	// and invalidatePlayer() update ranges of the affected players.
+	void updateStarRanges(void);
+	void updateStarRange(unsigned player_id);
+	int isStarInRange(unsigned star_id, unsigned player_id) const;
+
+	// Derived value cache and hot field table invalidation. Call
+	// invalidatePlayer() after player techs, traits or leaders change,
+	// invalidatePlanet() or invalidateColony() after planet or colony
+	// changes, invalidateShip() after any ship record change and
+	// invalidateLeader() after leader experience or skills change.
+	// invalidateStar() after visits or colony presence at the star change,
+	// call setActivePlayer() afterwards to update star owners. Star
+	// knowledge is only set by load() for now, turn processing will need
+	// to call invalidateStar() once exploration and colonization exist.
+	void invalidateCache(void);
+	void invalidatePlayer(unsigned player_id);
+	void invalidatePlanet(unsigned planet_id);
+	void invalidateColony(unsigned colony_id);
+	void invalidateShip(unsigned ship_id);
+	void invalidateLeader(unsigned leader_id);
+	void invalidateStar(unsigned star_id);
+	void cacheStats(unsigned long *hits, unsigned long *misses) const;
+	// Record change of an array which has no invalidate*() call above,
+	// e.g. stars, leaders or game config. Snapshots depend on it.
+	void markChanged(unsigned array);
+	// Current change counter of a record array
+	unsigned long version(unsigned array) const;
+
+	// Consistent read-only copy of the current game state for use in
+	// other threads. Only record arrays changed since the previous
+	// snapshot are copied. The caller must release() the snapshot.
+	// Fleets of the snapshot belong to the snapshot state.
+	GameSnapshot *snapshot(void);
+
+	// Rebuild all hot field tables from records
+	void updateHotTables(void);
+	const ShipTable &shipTable(void) const;
+	const PlanetTable &planetTable(void) const;
+	const ColonyTable &colonyTable(void) const;
+	const TechTable &techTable(void) const;
+	const LeaderTable &leaderTable(void) const;
+	const VisibilityTable &visibilityTable(void) const;
+	// Bitmask of players who know the technology
+	unsigned techOwners(unsigned tech_id) const;
 
 	unsigned findStar(int x, int y) const;
+	// Find stars or moving fleets in area given in galaxy coordinates.
+	// Results are stored in ID or moving fleet list order, the return
+	// value is the number of stored items.
+	size_t findStars(int x, int y, unsigned width, unsigned height,
+		unsigned *ids, size_t max) const;
+	size_t findStars(int x, int y, unsigned radius, unsigned *ids,
+		size_t max) const;
+	size_t findMovingFleets(int x, int y, unsigned width, unsigned height,
+		Fleet **fleets, size_t max);
+	size_t findMovingFleets(int x, int y, unsigned radius, Fleet **fleets,
+		size_t max);
 	int getOrbitingPlanetID(unsigned star_id, unsigned orbit) const;
 	Planet *getOrbitingPlanet(unsigned star_id, unsigned orbit);
 	BilistNode<Fleet> *getMovingFleets(void);
@@ -1362,6 +1675,7 @@ public:
 	StarKnowledge isStarExplored(unsigned star_id,
 		unsigned player_id) const;
 	StarKnowledge isStarExplored(const Star *s, unsigned player_id) const;
+	int isPlayerVisible(unsigned player_id, unsigned other_id) const;
 
 	unsigned planetClimate(unsigned planet_id) const;
 	unsigned planetMaxPop(unsigned planet_id, unsigned player_id) const;
@@ -1373,11 +1687,58 @@ public:
 	int shipBeamDefense(unsigned ship_id, int ignoreDamage) const;
 	int shipBeamDefense(const Ship *sptr, int ignoreDamage) const;
 
+	// Evaluate combat values of many ships in one pass. Race traits and
+	// officer skills are included like in shipBeamOffense() and others.
+	// With ignoreDamage, HP values are the undamaged maximums.
+	void evalShipStrength(const unsigned *ship_ids, size_t count,
+		int ignoreDamage, ShipStrength *out) const;
+	void evalFleetStrength(const Fleet *flt, int ignoreDamage,
+		FleetStrength *out) const;
+
+	// Leader skill queries answered from LeaderTable
+	int leaderSkillBonus(unsigned leader_id, unsigned skill) const;
+	unsigned leaderHireCost(unsigned leader_id, int modifier) const;
 	int leaderHireModifier(unsigned player_id) const;
 	unsigned leaderMaintenanceCost(unsigned leader_id, int modifier) const;
 
 	void sort_ids(unsigned *id_list, unsigned length, int player,
 		gamestate_cmp_func cmp);
+	// Stable linear time sort, each key is extracted only once
+	void sort_ids(unsigned *id_list, unsigned length, int player,
+		gamestate_key_func key);
+};
+
+// Reference counted frozen copy of GameState. Changes of the live game
+// state never affect existing snapshots.
+class GameSnapshot {
+private:
+	GameState _state;
+	unsigned long _versions[GAMESTATE_ARRAY_COUNT];
+	unsigned _refs;
+	Mutex _lock;
+
+	// Do NOT implement
+	GameSnapshot(const GameSnapshot &other);
+	const GameSnapshot &operator=(const GameSnapshot &other);
+
+protected:
+	GameSnapshot(void);
+	~GameSnapshot(void);
+
+	// Returns 1 if anybody else than the live GameState holds
+	// a reference
+	int isShared(void);
+
+public:
+	const GameState &state(void) const;
+
+	// Take another reference, e.g. before passing the snapshot
+	// to another thread
+	void acquire(void);
+	// Drop reference, the snapshot is deleted with the last one
+	void release(void);
+
+	friend class GameState;
 };
 
 class Fleet : public Recyclable {
@@ -1396,6 +1757,9 @@ private:
 	// Do NOT implement
 	const Fleet &operator=(const Fleet &other);
 
+protected:
+	Ship *checkShip(unsigned ship_id);
+
 public:
 	Fleet(GameState *parent, unsigned flagship);
 	Fleet(const Fleet &other);
@@ -1405,6 +1769,8 @@ public:
 	// to add more ships to existing fleet, copy and discard it instead.
 	// Removing ships is allowed at any time.
 	void addShip(unsigned ship_id);
+	// Add many ships at once and sort the ship list only once
+	void addShips(const unsigned *ship_ids, size_t count);
 	void removeShip(size_t pos);
 
 	unsigned getShipID(size_t pos) const;
@@ -1429,6 +1795,34 @@ public:
 	uint8_t getStatus(void) const;
 	uint16_t getX(void) const;
 	uint16_t getY(void) const;
+	uint8_t getWarpSpeed(void) const;
+};
+
+// Planets matching filter predicates of one player. Each predicate has
+// its own bitset over planet IDs, filter() combines them word by word.
+class PlanetFilter {
+private:
+	const GameState *_game;
+	unsigned _player;
+	// Habitable planets in charted star systems not owned by the player
+	uint64_t _candidates[PLANET_FILTER_WORDS];
+	uint64_t _masks[PLANET_FILTER_COUNT][PLANET_FILTER_WORDS];
+
+	void setBit(uint64_t *mask, unsigned planet_id, int value);
+
+public:
+	PlanetFilter(const GameState *game, unsigned player);
+
+	// Recalculate all bitsets
+	void update(void);
+	// Recalculate bitsets of planets orbiting the star, e.g. after
+	// a fleet arrival or colony ownership change
+	void updateStar(unsigned star_id);
+
+	// Store IDs of planets which match all predicates selected in flags
+	// ((1 << PLANET_FILTER_*) bitmask) into ids in ascending order.
+	// Returns the number of stored IDs.
+	unsigned filter(unsigned flags, unsigned *ids) const;
 };
 
 int cmpPlanetClimate(const GameState *game, int player, unsigned a,
@@ -1437,4 +1831,9 @@ int cmpPlanetMinerals(const GameState *game, int player, unsigned a,
 	unsigned b);
 int cmpPlanetMaxPop(const GameState *game, int player, unsigned a, unsigned b);
 
+// Sort keys matching the comparators above
+uint32_t keyPlanetClimate(const GameState *game, int player, unsigned id);
+uint32_t keyPlanetMinerals(const GameState *game, int player, unsigned id);
+uint32_t keyPlanetMaxPop(const GameState *game, int player, unsigned id);
+
 #endif
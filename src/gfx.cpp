@@ -20,6 +20,7 @@
 #include <cstdio>
 #include <cstring>
 #include <stdexcept>
+#include "cache.h"
 #include "gfx.h"
 #include "lbx.h"
 #include "screen.h"
@@ -32,6 +33,7 @@
 
 #define TITLE_PALSIZE 9
 #define FONT_PALSIZE 4
+#define FONT_CACHE_VERSION 1
 
 static const char *font_archives[LANG_COUNT] = {"fonts.lbx", "fontsg.lbx",
 	"fontsf.lbx", "fontss.lbx", "fontsi.lbx"};
@@ -304,14 +306,75 @@ Image::Image(SeekableReadStream &stream, const uint8_t *base_palette) :
 	_width(0), _height(0), _frames(0), _palcount(0), _textureIDs(NULL),
 	_palettes(NULL) {
 
-	load(stream, &base_palette, base_palette ? 1 : 0);
+	load(stream, &base_palette, base_palette ? 1 : 0, NULL);
 }
 
 Image::Image(SeekableReadStream &stream, const uint8_t **base_palettes,
-	unsigned palcount) : _width(0), _height(0), _frames(0), _palcount(0),
-	_textureIDs(NULL), _palettes(NULL) {
+	unsigned palcount, CacheWriter *cache) : _width(0), _height(0),
+	_frames(0), _palcount(0), _textureIDs(NULL), _palettes(NULL) {
 
-	load(stream, base_palettes, palcount);
+	load(stream, base_palettes, palcount, cache);
+}
+
+Image::Image(CacheReader &cache) : _width(0), _height(0), _frames(0),
+	_palcount(0), _textureIDs(NULL), _palettes(NULL) {
+
+	unsigned i, count, framecount, palcount;
+	uint64_t size, total;
+
+	_width = cache.readUint32();
+	_height = cache.readUint32();
+	framecount = cache.readUint32();
+	_frametime = cache.readUint32();
+	_flags = cache.readUint32();
+	palcount = cache.readUint32();
+	size = uint64_t(_width) * _height * sizeof(uint32_t);
+
+	if (!_width || !_height || _width > 0xffff || _height > 0xffff ||
+		!framecount || framecount > 0xffff || !palcount) {
+		throw std::runtime_error("Invalid cached image header");
+	}
+
+	// Per-variant data size, no overflow with the limits above
+	total = size * framecount + PALSIZE;
+
+	if (total > cache.remaining() ||
+		palcount > cache.remaining() / total) {
+		throw std::runtime_error("Premature end of cache data");
+	}
+
+	_palettes = new uint8_t*[palcount];
+	memset(_palettes, 0, palcount * sizeof(uint8_t*));
+	_palcount = palcount;
+
+	try {
+		for (i = 0; i < _palcount; i++) {
+			_palettes[i] = new uint8_t[PALSIZE];
+			memcpy(_palettes[i], cache.readBlock(PALSIZE), PALSIZE);
+		}
+
+		_textureIDs = new unsigned[framecount * _palcount];
+	} catch (...) {
+		clear();
+		throw;
+	}
+
+	// Frames are uploaded straight from cache data
+	for (count = 0; count < framecount * _palcount; count++) {
+		try {
+			_textureIDs[count] = gameScreen->registerTexture(_width,
+				_height, (const uint32_t*)cache.readBlock(size));
+		} catch (...) {
+			for (i = 0; i < count; i++) {
+				gameScreen->freeTexture(_textureIDs[i]);
+			}
+
+			clear();
+			throw;
+		}
+	}
+
+	_frames = framecount;
 }
 
 Image::~Image(void) {
@@ -319,7 +382,7 @@ Image::~Image(void) {
 }
 
 void Image::load(SeekableReadStream &stream, const uint8_t **base_palettes,
-	unsigned palcount) {
+	unsigned palcount, CacheWriter *cache) {
 
 	unsigned i, palstart, palsize, framecount;
 	size_t *offsets;
@@ -342,6 +405,13 @@ void Image::load(SeekableReadStream &stream, const uint8_t **base_palettes,
 	offsets = loadFrameOffsets(stream, framecount);
 	_palcount = palcount ? palcount : 1;
 
+	// Small images are not worth caching, leave the writer empty
+	// instead of copying every decoded frame into it
+	if (cache && (size_t)_palcount * (PALSIZE + framecount * _width *
+		_height * sizeof(uint32_t)) < IMAGE_CACHE_MIN_SIZE) {
+		cache = NULL;
+	}
+
 	try {
 		_palettes = new uint8_t*[_palcount];
 	} catch (...) {
@@ -399,9 +469,29 @@ void Image::load(SeekableReadStream &stream, const uint8_t **base_palettes,
 
 	_frames = framecount;
 
+	try {
+		if (cache) {
+			cache->writeUint32(_width);
+			cache->writeUint32(_height);
+			cache->writeUint32(_frames);
+			cache->writeUint32(_frametime);
+			cache->writeUint32(_flags);
+			cache->writeUint32(_palcount);
+
+			for (i = 0; i < _palcount; i++) {
+				cache->writeBlock(_palettes[i], PALSIZE);
+			}
+		}
+	} catch (...) {
+		_frames = 0;
+		delete[] offsets;
+		clear();
+		throw;
+	}
+
 	for (i = 0; i < _palcount; i++) {
 		try {
-			loadFrames(stream, i, offsets);
+			loadFrames(stream, i, offsets, cache);
 		} catch (...) {
 			delete[] offsets;
 			clear();
@@ -413,7 +503,7 @@ void Image::load(SeekableReadStream &stream, const uint8_t **base_palettes,
 }
 
 void Image::loadFrames(SeekableReadStream &stream, unsigned variant,
-	const size_t *offsets) {
+	const size_t *offsets, CacheWriter *cache) {
 
 	unsigned i, fpos = variant * _frames;
 	uint32_t *buffer;
@@ -436,6 +526,11 @@ void Image::loadFrames(SeekableReadStream &stream, unsigned variant,
 				*substream);
 			_textureIDs[fpos] = gameScreen->registerTexture(_width,
 				_height, buffer);
+
+			if (cache) {
+				cache->writeBlock(buffer,
+					_width * _height * sizeof(uint32_t));
+			}
 		} catch (...) {
 			for (i = 0; i < fpos; i++) {
 				gameScreen->freeTexture(_textureIDs[i]);
@@ -982,10 +1077,15 @@ const uint8_t *Font::fontPalette(unsigned color) {
 	return font_palettes[color];
 }
 
-FontManager::FontManager(unsigned lang_id) : _fontCount(0) {
+FontManager::FontManager(unsigned lang_id, int packing) : _fontCount(0) {
 	MemoryReadStream *stream;
 
 	memset(_fonts, 0, FONTSIZE_COUNT * sizeof(Font*));
+
+	if (!packing && loadCache(lang_id)) {
+		return;
+	}
+
 	stream = gameAssets->rawData(font_archives[lang_id], 0);
 
 	try {
@@ -996,6 +1096,16 @@ FontManager::FontManager(unsigned lang_id) : _fontCount(0) {
 	}
 
 	delete stream;
+
+	if (packing) {
+		return;
+	}
+
+	try {
+		saveCache(lang_id);
+	} catch (...) {
+		// The game works fine without cache
+	}
 }
 
 FontManager::~FontManager(void) {
@@ -1161,6 +1271,132 @@ void FontManager::clear(void) {
 	_fontCount = 0;
 }
 
+int FontManager::loadCache(unsigned lang_id) {
+	size_t size;
+	const uint8_t *data;
+	const AssetBundle *bundle = gameAssets ? gameAssets->bundle() : NULL;
+	CacheKey key("fonts", FONT_CACHE_VERSION);
+	CacheFile file;
+	StringBuffer filename;
+
+	if (bundle) {
+		filename.printf("fonts/%u", lang_id);
+		data = bundle->find(filename.c_str(), &size);
+
+		if (data) {
+			CacheReader reader(data, size);
+
+			if (readCache(reader)) {
+				return 1;
+			}
+		}
+	}
+
+	// Missing data files will be reported by the full loader
+	try {
+		key.addDataFile(font_archives[lang_id]);
+		filename.printf("fonts%u.cache", lang_id);
+
+		if (!file.open(filename.c_str(), key)) {
+			return 0;
+		}
+	} catch (...) {
+		return 0;
+	}
+
+	CacheReader reader(file.data(), file.size());
+	return readCache(reader);
+}
+
+int FontManager::readCache(CacheReader &reader) {
+	unsigned i, j, count;
+	uint64_t size;
+	Font *ptr;
+
+	try {
+		count = reader.readUint32();
+
+		if (count > FONTSIZE_COUNT) {
+			throw std::runtime_error("Invalid font count");
+		}
+
+		for (i = 0; i < count; i++) {
+			ptr = new Font(reader.readUint32());
+			_fonts[_fontCount++] = ptr;
+			ptr->_width = reader.readUint32();
+			ptr->_title = reader.readUint32();
+			ptr->_glyphCount = reader.readUint32();
+
+			if (ptr->_glyphCount > 256) {
+				throw std::runtime_error("Invalid glyph count");
+			}
+
+			ptr->_glyphs = new Font::Glyph[ptr->_glyphCount];
+			memcpy(ptr->_glyphs, reader.readBlock(ptr->_glyphCount *
+				sizeof(Font::Glyph)),
+				ptr->_glyphCount * sizeof(Font::Glyph));
+
+			for (j = 0; j < ptr->_glyphCount; j++) {
+				if (uint64_t(ptr->_glyphs[j].offset) +
+					ptr->_glyphs[j].width + 2 > ptr->_width) {
+					throw std::runtime_error(
+						"Invalid glyph metrics");
+				}
+			}
+
+			size = uint64_t(ptr->_width) * (ptr->_height + 2);
+
+			if (size > reader.remaining()) {
+				throw std::runtime_error(
+					"Premature end of cache data");
+			}
+
+			ptr->_bitmap = new uint8_t[size];
+			memcpy(ptr->_bitmap, reader.readBlock(size), size);
+		}
+
+		if (!reader.eos()) {
+			throw std::runtime_error("Trailing garbage in cache");
+		}
+	} catch (...) {
+		// Damaged cache, fall back to decoding the original file
+		clear();
+		return 0;
+	}
+
+	return 1;
+}
+
+void FontManager::saveCache(unsigned lang_id) {
+	CacheKey key("fonts", FONT_CACHE_VERSION);
+	CacheWriter writer;
+	StringBuffer filename;
+
+	key.addDataFile(font_archives[lang_id]);
+	filename.printf("fonts%u.cache", lang_id);
+	writeCache(writer);
+	writer.save(filename.c_str(), key);
+}
+
+void FontManager::writeCache(CacheWriter &writer) const {
+	unsigned i;
+	const Font *ptr;
+
+	writer.writeUint32(_fontCount);
+
+	for (i = 0; i < _fontCount; i++) {
+		ptr = _fonts[i];
+		writer.writeUint32(ptr->_height);
+		writer.writeUint32(ptr->_width);
+		writer.writeUint32(ptr->_title);
+		writer.writeUint32(ptr->_glyphCount);
+		writer.writeBlock(ptr->_glyphs,
+			ptr->_glyphCount * sizeof(Font::Glyph));
+		writer.writeBlock(ptr->_bitmap,
+			ptr->_width * (ptr->_height + 2));
+	}
+}
+
 Font *FontManager::getFont(unsigned id) {
 	if (id >= _fontCount) {
 		throw std::out_of_range("Invalid font ID");
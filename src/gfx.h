@@ -230,9 +230,9 @@ private:
 
 protected:
 	void load(SeekableReadStream &stream, const uint8_t **base_palettes,
-		unsigned palcount);
+		unsigned palcount, CacheWriter *cache);
 	void loadFrames(SeekableReadStream &stream, unsigned variant,
-		const size_t *offsets);
+		const size_t *offsets, CacheWriter *cache);
 	void decodeFrame(uint32_t *buffer, uint32_t *palette,
 		MemoryReadStream &stream);
 	void clear(void);
@@ -240,8 +240,13 @@ protected:
 public:
 	explicit Image(SeekableReadStream &stream,
 		const uint8_t *base_palette = NULL);
+
+	// If cache is not NULL, decoded frames will be written into it
 	Image(SeekableReadStream &stream, const uint8_t **base_palettes,
-		unsigned palcount);
+		unsigned palcount, CacheWriter *cache = NULL);
+
+	// Load decoded frames written by the constructor above
+	explicit Image(CacheReader &cache);
 	~Image(void);
 
 	unsigned width(void) const;
@@ -362,13 +367,25 @@ protected:
 	void loadFonts(SeekableReadStream &stream);
 	void clear(void);
 
+	// Load decoded fonts from asset bundle or cache file. Returns 0 if
+	// the cache is missing or out of date.
+	int loadCache(unsigned lang_id);
+	int readCache(CacheReader &reader);
+	void saveCache(unsigned lang_id);
+
 public:
-	FontManager(unsigned lang_id);
+	// With packing set, fonts are loaded directly from game data files
+	// without touching the runtime cache
+	FontManager(unsigned lang_id, int packing = 0);
 	~FontManager(void);
 
 	Font *getFont(unsigned id);
 	Font *fitFont(unsigned fontsize, unsigned maxwidth, const char *str);
 	unsigned fontCount(void) const;
+
+	// Write decoded fonts in cache format, used by the asset bundle
+	// packer
+	void writeCache(CacheWriter &writer) const;
 };
 
 extern FontManager *gameFonts;
@@ -1257,6 +1257,14 @@ void WidgetContainer::handleMouseUp(int x, int y, unsigned button) {
 	}
 }
 
+void WidgetContainer::handleKeyDown(unsigned key) {
+
+}
+
+void WidgetContainer::handleTextInput(const char *text) {
+
+}
+
 CompositeWidget::CompositeWidget(unsigned x, unsigned y, unsigned width,
 	unsigned height) : Widget(x, y, width, height), WidgetContainer() {
 
@@ -1557,6 +1565,28 @@ void GuiView::handleMouseUp(int x, int y, unsigned button) {
 	WidgetContainer::handleMouseUp(x, y, button);
 }
 
+void GuiView::handleKeyDown(unsigned key) {
+	BilistNode<GuiWindow> *node = _firstWindow.next();
+
+	if (node && node != &_lastWindow) {
+		node->data->handleKeyDown(key);
+		return;
+	}
+
+	WidgetContainer::handleKeyDown(key);
+}
+
+void GuiView::handleTextInput(const char *text) {
+	BilistNode<GuiWindow> *node = _firstWindow.next();
+
+	if (node && node != &_lastWindow) {
+		node->data->handleTextInput(text);
+		return;
+	}
+
+	WidgetContainer::handleTextInput(text);
+}
+
 void GuiView::redraw(int x, int y, unsigned curtick) {
 	redraw(curtick);
 }
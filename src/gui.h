@@ -30,6 +30,13 @@
 
 #define WIDGET_SPRITES (MBUTTON_COUNT + 2)
 
+#define KEY_OTHER 0
+#define KEY_BACKSPACE 1
+#define KEY_ENTER 2
+#define KEY_ESCAPE 3
+#define KEY_UP 4
+#define KEY_DOWN 5
+
 #define ANIM_LOOP -1	// play the animation in a loop
 #define ANIM_ONCE -2	// hide the animation after playing once
 #define ANIM_STICKY -3	// play the animation once and freeze on last frame
@@ -398,6 +405,10 @@ public:
 	virtual void handleMouseMove(int x, int y, unsigned buttons);
 	virtual void handleMouseDown(int x, int y, unsigned button);
 	virtual void handleMouseUp(int x, int y, unsigned button);
+
+	// Keyboard input is ignored by default. Text is UTF-8 encoded.
+	virtual void handleKeyDown(unsigned key);
+	virtual void handleTextInput(const char *text);
 };
 
 class CompositeWidget : public Widget, public WidgetContainer {
@@ -483,6 +494,10 @@ public:
 	void handleMouseDown(int x, int y, unsigned button);
 	void handleMouseUp(int x, int y, unsigned button);
 
+	// Keyboard input goes to the topmost window, if any
+	void handleKeyDown(unsigned key);
+	void handleTextInput(const char *text);
+
 	void redraw(int x, int y, unsigned curtick);
 	virtual void redraw(unsigned curtick) = 0;
 
@@ -18,6 +18,7 @@
  */
 
 #include <cstring>
+#include <stdexcept>
 #include "screen.h"
 #include "lang.h"
 #include "guimisc.h"
@@ -41,8 +42,13 @@
 #define ERROR_ARCHIVE "warning.lbx"
 #define ASSET_ERROR_BACKGROUND 0
 
+#define HELP_SEARCH_QUERY_Y 11
+#define HELP_SEARCH_RESULT_Y 36
+#define HELP_SEARCH_LINE_HEIGHT 13
+
 MessageBoxWindow::MessageBoxWindow(GuiView *parent, const char *text,
-	unsigned flags) : GuiWindow(parent, flags) {
+	unsigned flags) : GuiWindow(parent, flags), _helpPalette(NULL),
+	_helpSearch(0) {
 
 	initAssets();
 	_text.setFont(FONTSIZE_MEDIUM, FONT_COLOR_DEFAULT);
@@ -54,7 +60,8 @@ MessageBoxWindow::MessageBoxWindow(GuiView *parent, const char *text,
 }
 
 MessageBoxWindow::MessageBoxWindow(GuiView *parent, const char *title,
-	const char *text, unsigned flags) : GuiWindow(parent, flags) {
+	const char *text, unsigned flags) : GuiWindow(parent, flags),
+	_helpPalette(NULL), _helpSearch(0) {
 
 	initAssets();
 	_text.setFont(FONTSIZE_TITLE, TITLE_COLOR_HELP, 2, OUTLINE_NONE, 2);
@@ -68,7 +75,8 @@ MessageBoxWindow::MessageBoxWindow(GuiView *parent, const char *title,
 }
 
 MessageBoxWindow::MessageBoxWindow(GuiView *parent, unsigned help_id,
-	const uint8_t *palette, unsigned flags) : GuiWindow(parent, flags) {
+	const uint8_t *palette, unsigned flags) : GuiWindow(parent, flags),
+	_helpPalette(palette), _helpSearch(1) {
 
 	unsigned twidth, y = 0;
 	ImageAsset icon;
@@ -108,7 +116,8 @@ MessageBoxWindow::MessageBoxWindow(GuiView *parent, unsigned help_id,
 }
 
 MessageBoxWindow::MessageBoxWindow(GuiView *parent, Technology tech,
-	unsigned cost, unsigned flags) : GuiWindow(parent, flags) {
+	unsigned cost, unsigned flags) : GuiWindow(parent, flags),
+	_helpPalette(NULL), _helpSearch(0) {
 	const HelpText *entry;
 	const char *str;
 	StringBuffer buf;
@@ -155,6 +164,12 @@ void MessageBoxWindow::initWidgets(void) {
 		GuiMethod<GuiWindow>(*this, &MessageBoxWindow::close));
 }
 
+void MessageBoxWindow::handleTextInput(const char *text) {
+	if (_helpSearch) {
+		new HelpSearchWindow(_parent, _helpPalette, text);
+	}
+}
+
 void MessageBoxWindow::redraw(unsigned curtick) {
 	unsigned y, by = _header->height(), fh = _footer->height();
 
@@ -174,6 +189,214 @@ void MessageBoxWindow::redraw(unsigned curtick) {
 	redrawWidgets(_x, _y, curtick);
 }
 
+HelpSearchWindow::HelpSearchWindow(GuiView *parent, const uint8_t *palette,
+	const char *query, unsigned flags) : GuiWindow(parent, flags),
+	_palette(palette), _query(query ? query : ""), _resultCount(0),
+	_selected(-1), _queryLabel(NULL) {
+
+	unsigned i;
+
+	for (i = 0; i < HELP_SEARCH_RESULTS; i++) {
+		_resultLabels[i] = NULL;
+	}
+
+	_header = gameAssets->getImage(TEXTBOX_ARCHIVE, ASSET_TEXTBOX_HEADER);
+	_body = gameAssets->getImage(TEXTBOX_ARCHIVE, ASSET_TEXTBOX_BODY,
+		_header->palette());
+	_footer = gameAssets->getImage(TEXTBOX_ARCHIVE, ASSET_TEXTBOX_FOOTER,
+		_header->palette());
+	_width = _header->width();
+	_height = _header->height() + _footer->height() +
+		HELP_SEARCH_RESULT_Y - 20 +
+		HELP_SEARCH_RESULTS * HELP_SEARCH_LINE_HEIGHT;
+	_x = (SCREEN_WIDTH - _width) / 2;
+	_y = (SCREEN_HEIGHT - _height) / 2;
+
+	initWidgets();
+	updateResults();
+}
+
+HelpSearchWindow::~HelpSearchWindow(void) {
+
+}
+
+void HelpSearchWindow::initWidgets(void) {
+	unsigned i;
+	Widget *w;
+
+	_queryLabel = new LabelWidget(20, HELP_SEARCH_QUERY_Y, _width - 40,
+		HELP_SEARCH_RESULT_Y - HELP_SEARCH_QUERY_Y - 4);
+	addWidget(_queryLabel);
+
+	for (i = 0; i < HELP_SEARCH_RESULTS; i++) {
+		_resultLabels[i] = new LabelWidget(20, HELP_SEARCH_RESULT_Y +
+			i * HELP_SEARCH_LINE_HEIGHT, _width - 40,
+			HELP_SEARCH_LINE_HEIGHT);
+		addWidget(_resultLabels[i]);
+		_resultLabels[i]->setMouseOverCallback(GuiMethod(*this,
+			&HelpSearchWindow::highlightResult, i));
+		_resultLabels[i]->setMouseUpCallback(MBUTTON_LEFT,
+			GuiMethod(*this, &HelpSearchWindow::clickResult, i));
+	}
+
+	w = createWidget(158, _height - 27, 64, 19);
+	w->setClickSprite(MBUTTON_LEFT, TEXTBOX_ARCHIVE, ASSET_TEXTBOX_BUTTON,
+		_header->palette(), 1);
+	w->setMouseUpCallback(MBUTTON_LEFT,
+		GuiMethod<GuiWindow>(*this, &HelpSearchWindow::close));
+}
+
+void HelpSearchWindow::updateResults(void) {
+	unsigned i, asset;
+	const char *title;
+	StringBuffer buf;
+
+	buf = _query;
+	buf += '_';
+	_queryLabel->setText(buf.c_str(), FONTSIZE_BIG, FONT_COLOR_HELP);
+
+	try {
+		_resultCount = gameLang->search(_query.c_str(), _results,
+			HELP_SEARCH_RESULTS);
+	} catch (std::exception &e) {
+		// Search index build failed, show the reason instead
+		_resultCount = 0;
+		_selected = -1;
+		_resultLabels[0]->setText(e.what(), FONTSIZE_SMALL,
+			FONT_COLOR_HELP);
+
+		for (i = 1; i < HELP_SEARCH_RESULTS; i++) {
+			_resultLabels[i]->clear();
+		}
+
+		return;
+	}
+
+	_selected = _resultCount ? 0 : -1;
+
+	for (i = 0; i < HELP_SEARCH_RESULTS; i++) {
+		if (i >= _resultCount) {
+			_resultLabels[i]->clear();
+			continue;
+		}
+
+		if (_results[i].type == SEARCH_DOC_HELP) {
+			title = gameLang->help(_results[i].id)->title;
+		} else {
+			asset = _results[i].type == SEARCH_DOC_SPECIAL_TECH ?
+				TXT_TECH_SPECIAL_NAME : TXT_TECH_WEAPON_NAME;
+			title = gameLang->techdesc(asset, _results[i].id);
+		}
+
+		_resultLabels[i]->setText(title, FONTSIZE_SMALL,
+			FONT_COLOR_HELP);
+	}
+}
+
+void HelpSearchWindow::highlightResult(int x, int y, int arg) {
+	if (arg >= 0 && (unsigned)arg < _resultCount) {
+		_selected = arg;
+	}
+}
+
+void HelpSearchWindow::clickResult(int x, int y, int arg) {
+	const TextSearchResult *res;
+	unsigned name, desc;
+
+	if (arg < 0 || (unsigned)arg >= _resultCount) {
+		return;
+	}
+
+	res = _results + arg;
+
+	if (res->type == SEARCH_DOC_HELP) {
+		new MessageBoxWindow(_parent, res->id, _palette);
+		return;
+	}
+
+	if (res->type == SEARCH_DOC_SPECIAL_TECH) {
+		name = TXT_TECH_SPECIAL_NAME;
+		desc = TXT_TECH_SPECIAL_DESC;
+	} else {
+		name = TXT_TECH_WEAPON_NAME;
+		desc = TXT_TECH_WEAPON_DESC;
+	}
+
+	new MessageBoxWindow(_parent, gameLang->techdesc(name, res->id),
+		gameLang->techdesc(desc, res->id));
+}
+
+void HelpSearchWindow::handleKeyDown(unsigned key) {
+	size_t len = _query.length();
+	const char *str = _query.c_str();
+
+	switch (key) {
+	case KEY_BACKSPACE:
+		if (!len) {
+			break;
+		}
+
+		// Remove the whole UTF-8 character
+		for (len--; len && (str[len] & 0xc0) == 0x80; len--);
+
+		_query.truncate(len);
+		updateResults();
+		break;
+
+	case KEY_ENTER:
+		clickResult(0, 0, _selected);
+		break;
+
+	case KEY_ESCAPE:
+		close();
+		break;
+
+	case KEY_UP:
+		if (_selected > 0) {
+			_selected--;
+		}
+
+		break;
+
+	case KEY_DOWN:
+		if (_selected + 1 < (int)_resultCount) {
+			_selected++;
+		}
+
+		break;
+	}
+}
+
+void HelpSearchWindow::handleTextInput(const char *text) {
+	_query += text;
+	updateResults();
+}
+
+void HelpSearchWindow::redraw(unsigned curtick) {
+	unsigned y, by = _header->height(), fh = _footer->height();
+
+	gameScreen->fillRect(_x + 9, _y + 9, _width - 18, _height - 40,
+		16, 16, 24);
+
+	for (y = 10; y < _height - 31; y += 3) {
+		gameScreen->fillRect(_x + 9, _y + y, _width - 18, 1,
+			36, 36, 40);
+	}
+
+	_header->draw(_x, _y);
+	gameScreen->drawTextureTile(_body->textureID(0), _x, _y + by, 0, 0,
+		_width, _height - by - fh);
+	_footer->draw(_x, _y + _height - fh);
+
+	if (_selected >= 0) {
+		gameScreen->fillRect(_x + 18, _y + HELP_SEARCH_RESULT_Y +
+			_selected * HELP_SEARCH_LINE_HEIGHT, _width - 36,
+			HELP_SEARCH_LINE_HEIGHT, 56, 56, 72);
+	}
+
+	redrawWidgets(_x, _y, curtick);
+}
+
 ConfirmationWindow::ConfirmationWindow(GuiView *parent, const char *text,
 	unsigned flags) : GuiWindow(parent, flags) {
 
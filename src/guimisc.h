@@ -26,10 +26,14 @@
 
 #define STUB(view) { new MessageBoxWindow(view, "Not implemented yet"); }
 
+#define HELP_SEARCH_RESULTS 12
+
 class MessageBoxWindow : public GuiWindow {
 private:
 	ImageAsset _header, _body, _footer;
 	TextLayout _text;
+	const uint8_t *_helpPalette;
+	int _helpSearch;
 
 	void initAssets(void);
 	void initWidgets(void);
@@ -46,6 +50,38 @@ public:
 		unsigned flags = WINDOW_MOVABLE | WINDOW_MODAL);
 	~MessageBoxWindow(void);
 
+	// Typing into help window opens help search
+	void handleTextInput(const char *text);
+
+	void redraw(unsigned curtick);
+};
+
+class HelpSearchWindow : public GuiWindow {
+private:
+	ImageAsset _header, _body, _footer;
+	const uint8_t *_palette;
+	StringBuffer _query;
+	TextSearchResult _results[HELP_SEARCH_RESULTS];
+	unsigned _resultCount;
+	int _selected;
+	LabelWidget *_queryLabel;
+	LabelWidget *_resultLabels[HELP_SEARCH_RESULTS];
+
+	void initWidgets(void);
+	void updateResults(void);
+
+public:
+	HelpSearchWindow(GuiView *parent, const uint8_t *palette,
+		const char *query = NULL,
+		unsigned flags = WINDOW_MOVABLE | WINDOW_MODAL);
+	~HelpSearchWindow(void);
+
+	void highlightResult(int x, int y, int arg);
+	void clickResult(int x, int y, int arg);
+
+	void handleKeyDown(unsigned key);
+	void handleTextInput(const char *text);
+
 	void redraw(unsigned curtick);
 };
 
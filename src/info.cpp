@@ -36,6 +36,15 @@
 #define INFO_BAR_COUNT 7
 #define INFO_BAR_COLORS 8
 
+#define HISTORY_GRAPH_X 20
+#define HISTORY_GRAPH_Y 138
+#define HISTORY_GRAPH_WIDTH 378
+#define HISTORY_GRAPH_HEIGHT 270
+#define HISTORY_LEGEND_COLUMNS 4
+
+#define SUMMARY_ROW_HEIGHT 12
+#define SUMMARY_ROW_COUNT 12
+
 static const uint8_t bar_color_maps[INFO_BAR_COUNT][INFO_BAR_COLORS] = {
 	{0, 176, 152, 153, 154, 155, 156, 157},
 	{0, 176, 13, 15, 17, 19, 20, 22},
@@ -46,6 +55,17 @@ static const uint8_t bar_color_maps[INFO_BAR_COUNT][INFO_BAR_COLORS] = {
 	{0, 176, 181, 182, 183, 184, 185, 186},
 };
 
+static const uint8_t historyLineColors[MAX_PLAYERS * 3] = {
+	RGB(0xfc0000), RGB(0xd4c418), RGB(0x209c1c), RGB(0xc8c8c8),
+	RGB(0x305ca0), RGB(0xa47050), RGB(0x8c6098), RGB(0xd0680c)
+};
+
+static const char *summaryLabels[SUMMARY_ROW_COUNT] = {
+	"Colonies", "Outposts", "Population", "Food", "Industry", "Research",
+	"Fleets", "Combat ships", "Colony ships", "Total ships", "Known techs",
+	"Hyper-advanced levels"
+};
+
 static void drawInfoBox(int x, int y, unsigned width, unsigned height) {
 	unsigned ypos;
 
@@ -84,8 +104,9 @@ static void drawInfoBox(int x, int y, unsigned width, unsigned height) {
 }
 
 HistoryGraphWidget::HistoryGraphWidget(unsigned x, unsigned y, unsigned width,
-	unsigned height, const GameState *game, int activePlayer) :
-	Widget(x, y, width, height), _game(game), _activePlayer(activePlayer) {
+	unsigned height, const GameState *game, EmpireAggregates *stats,
+	int activePlayer) : Widget(x, y, width, height), _game(game),
+	_stats(stats), _activePlayer(activePlayer) {
 
 }
 
@@ -93,9 +114,20 @@ HistoryGraphWidget::~HistoryGraphWidget(void) {
 
 }
 
+int HistoryGraphWidget::isPlayerShown(unsigned player_id) const {
+	return _activePlayer == (int)player_id ||
+		_game->_players[player_id].eliminated ||
+		_game->isPlayerVisible(_activePlayer, player_id);
+}
+
 void HistoryGraphWidget::redraw(int x, int y, unsigned curtick) {
-	Font *titleFnt;
+	unsigned i, j, k, count, color;
+	int gx, gy;
+	Font *titleFnt, *itemFnt;
 	const char *str;
+	const int16_t *px, *py;
+	const uint8_t *rgb;
+	StringBuffer buf;
 
 	if (isHidden()) {
 		return;
@@ -104,6 +136,7 @@ void HistoryGraphWidget::redraw(int x, int y, unsigned curtick) {
 	x += getX();
 	y += getY();
 	titleFnt = gameFonts->getFont(FONTSIZE_TITLE);
+	itemFnt = gameFonts->getFont(FONTSIZE_SMALL);
 
 	str = gameLang->misctext(TXT_MISC_BILLTEXT, BILL_INFO_TITLE_HISTORY);
 	titleFnt->centerText(x + 208, y + 31, TITLE_COLOR_INFO, str,
@@ -111,6 +144,37 @@ void HistoryGraphWidget::redraw(int x, int y, unsigned curtick) {
 
 	drawInfoBox(x + 14, y + 60, 390, 63);
 	drawInfoBox(x + 14, y + 132, 390, 282);
+
+	// Polylines are rebuilt only after the game state changes
+	_stats->setGraph(HISTORY_TOTAL, HISTORY_GRAPH_WIDTH,
+		HISTORY_GRAPH_HEIGHT);
+	count = _stats->graphPoints();
+	px = _stats->graphX();
+	gx = x + HISTORY_GRAPH_X;
+	gy = y + HISTORY_GRAPH_Y;
+
+	for (i = 0, j = 0; i < _game->_playerCount; i++) {
+		if (!isPlayerShown(i)) {
+			continue;
+		}
+
+		buf = _game->_players[i].race;
+		buf.toUpper();
+		color = FONT_COLOR_INFO_RED + _game->_players[i].color;
+		itemFnt->centerText(x + 63 + 97 * (j % HISTORY_LEGEND_COLUMNS),
+			y + 72 + 24 * (j / HISTORY_LEGEND_COLUMNS), color,
+			buf.c_str(), OUTLINE_NONE, 2);
+		j++;
+
+		py = _stats->graphY(i);
+		rgb = historyLineColors + 3 * (_game->_players[i].color %
+			MAX_PLAYERS);
+
+		for (k = 1; k < count; k++) {
+			gameScreen->drawLine(gx + px[k - 1], gy + py[k - 1],
+				gx + px[k], gy + py[k], rgb[0], rgb[1], rgb[2]);
+		}
+	}
 }
 
 TechReviewWidget::TechReviewWidget(unsigned x, unsigned y, unsigned width,
@@ -176,7 +240,7 @@ unsigned RaceInfoWidget::playerCount(void) const {
 
 	for (i = 0, ret = 0; i < _game->_playerCount; i++) {
 		if (_activePlayer == (int)i || _game->_players[i].eliminated ||
-			_game->_players[_activePlayer].isPlayerVisible(i)) {
+			_game->isPlayerVisible(_activePlayer, i)) {
 			ret++;
 		}
 	}
@@ -206,7 +270,7 @@ void RaceInfoWidget::redraw(int x, int y, unsigned curtick) {
 
 	for (i = 0, pcount = 1; i < _game->_playerCount; i++) {
 		if (_activePlayer == (int)i || _game->_players[i].eliminated ||
-			!players[0]->isPlayerVisible(i)) {
+			!_game->isPlayerVisible(_activePlayer, i)) {
 			continue;
 		}
 
@@ -311,8 +375,9 @@ void RaceInfoWidget::redraw(int x, int y, unsigned curtick) {
 }
 
 TurnSummaryWidget::TurnSummaryWidget(unsigned x, unsigned y, unsigned width,
-	unsigned height, const GameState *game, int activePlayer) :
-	Widget(x, y, width, height), _game(game), _activePlayer(activePlayer) {
+	unsigned height, const GameState *game, EmpireAggregates *stats,
+	int activePlayer) : Widget(x, y, width, height), _game(game),
+	_stats(stats), _activePlayer(activePlayer) {
 
 }
 
@@ -321,8 +386,13 @@ TurnSummaryWidget::~TurnSummaryWidget(void) {
 }
 
 void TurnSummaryWidget::redraw(int x, int y, unsigned curtick) {
-	Font *titleFnt;
+	unsigned i, width;
+	int ypos;
+	long rows[SUMMARY_ROW_COUNT];
+	Font *titleFnt, *itemFnt;
 	const char *str;
+	const EmpireStats &stats = _stats->player(_activePlayer);
+	StringBuffer buf;
 
 	if (isHidden()) {
 		return;
@@ -331,6 +401,7 @@ void TurnSummaryWidget::redraw(int x, int y, unsigned curtick) {
 	x += getX();
 	y += getY();
 	titleFnt = gameFonts->getFont(FONTSIZE_TITLE);
+	itemFnt = gameFonts->getFont(FONTSIZE_SMALL);
 
 	str = gameLang->misctext(TXT_MISC_BILLTEXT,
 		BILL_INFO_TITLE_TURN_SUMMARY);
@@ -338,6 +409,31 @@ void TurnSummaryWidget::redraw(int x, int y, unsigned curtick) {
 		OUTLINE_NONE, 3);
 
 	drawInfoBox(x + 12, y + 60, 395, 355);
+
+	// FIXME: Turn events are not recorded yet, show empire totals instead
+	// FIXME: Find the original label strings
+	rows[0] = stats.colonies;
+	rows[1] = stats.outposts;
+	rows[2] = stats.population;
+	rows[3] = stats.food;
+	rows[4] = stats.industry;
+	rows[5] = stats.research;
+	rows[6] = stats.fleets;
+	rows[7] = stats.combatShips;
+	rows[8] = stats.colonyShips;
+	rows[9] = stats.ships;
+	rows[10] = stats.techs;
+	rows[11] = stats.hyperLevels;
+
+	for (i = 0; i < SUMMARY_ROW_COUNT; i++) {
+		ypos = y + 72 + i * SUMMARY_ROW_HEIGHT;
+		itemFnt->renderText(x + 28, ypos, FONT_COLOR_INFO_NORMAL,
+			summaryLabels[i], OUTLINE_NONE, 2);
+		buf.printf("%ld", rows[i]);
+		width = itemFnt->textWidth(buf.c_str(), 2);
+		itemFnt->renderText(x + 390 - width, ypos,
+			FONT_COLOR_INFO_NORMAL, buf.c_str(), OUTLINE_NONE, 2);
+	}
 }
 
 DocsWidget::DocsWidget(unsigned x, unsigned y, unsigned width,
@@ -372,7 +468,7 @@ void DocsWidget::redraw(int x, int y, unsigned curtick) {
 }
 
 InfoView::InfoView(GameState *game, int activePlayer) : _game(game),
-	_activePlayer(activePlayer), _panelChoice(NULL) {
+	_stats(game), _activePlayer(activePlayer), _panelChoice(NULL) {
 
 	ImageAsset cursor;
 	const uint8_t *pal;
@@ -384,6 +480,7 @@ InfoView::InfoView(GameState *game, int activePlayer) : _game(game),
 	_barMask = gameAssets->getBitmap(INFO_ARCHIVE, ASSET_INFO_VBAR_MASK);
 	_barLabel = gameAssets->getBitmap(INFO_ARCHIVE, ASSET_INFO_BAR_LABEL);
 	_barFoot = gameAssets->getBitmap(INFO_ARCHIVE, ASSET_INFO_VBAR_FOOT);
+	_stats.update();
 
 	initWidgets();
 }
@@ -421,7 +518,7 @@ void InfoView::initWidgets(void) {
 	_panelChoice->setValue(i < INFO_PANEL_COUNT ? i : 0);
 
 	_panels[0] = new HistoryGraphWidget(206, 0, SCREEN_WIDTH - 206,
-		SCREEN_HEIGHT, _game, _activePlayer);
+		SCREEN_HEIGHT, _game, &_stats, _activePlayer);
 	addWidget(_panels[0]);
 	_panels[1] = new TechReviewWidget(206, 0, SCREEN_WIDTH - 206,
 		SCREEN_HEIGHT, _game, _activePlayer);
@@ -430,7 +527,7 @@ void InfoView::initWidgets(void) {
 		SCREEN_HEIGHT, _game, _activePlayer);
 	addWidget(_panels[2]);
 	_panels[3] = new TurnSummaryWidget(206, 0, SCREEN_WIDTH - 206,
-		SCREEN_HEIGHT, _game, _activePlayer);
+		SCREEN_HEIGHT, _game, &_stats, _activePlayer);
 	addWidget(_panels[3]);
 	_panels[4] = new DocsWidget(206, 0, SCREEN_WIDTH - 206, SCREEN_HEIGHT);
 	addWidget(_panels[4]);
@@ -457,6 +554,7 @@ void InfoView::redraw(unsigned curtick) {
 	StringBuffer buf;
 	uint8_t barpal[PALSIZE];
 
+	_stats.update();
 	maintcosts[0] = pptr->bcProduced;
 	maintcosts[1] = pptr->buildingMaintenance;
 	maintcosts[2] = pptr->freighterMaintenance;
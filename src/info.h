@@ -23,17 +23,23 @@
 #include "lbx.h"
 #include "gui.h"
 #include "gamestate.h"
+#include "stats.h"
 
 #define INFO_PANEL_COUNT 5
 
 class HistoryGraphWidget : public Widget {
 private:
 	const GameState *_game;
+	EmpireAggregates *_stats;
 	int _activePlayer;
 
+protected:
+	int isPlayerShown(unsigned player_id) const;
+
 public:
 	HistoryGraphWidget(unsigned x, unsigned y, unsigned width,
-		unsigned height, const GameState *game, int _activePlayer);
+		unsigned height, const GameState *game,
+		EmpireAggregates *stats, int _activePlayer);
 	~HistoryGraphWidget(void);
 
 	void redraw(int x, int y, unsigned curtick);
@@ -76,11 +82,13 @@ public:
 class TurnSummaryWidget : public Widget {
 private:
 	const GameState *_game;
+	EmpireAggregates *_stats;
 	int _activePlayer;
 
 public:
 	TurnSummaryWidget(unsigned x, unsigned y, unsigned width,
-		unsigned height, const GameState *game, int _activePlayer);
+		unsigned height, const GameState *game,
+		EmpireAggregates *stats, int _activePlayer);
 	~TurnSummaryWidget(void);
 
 	void redraw(int x, int y, unsigned curtick);
@@ -100,6 +108,7 @@ private:
 	ImageAsset _bg;
 	BitmapAsset _vbar, _barLabel, _barMask, _barFoot;
 	GameState *_game;
+	EmpireAggregates _stats;
 	int _activePlayer;
 	ChoiceWidget *_panelChoice;
 	Widget *_panels[INFO_PANEL_COUNT];
@@ -0,0 +1,696 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cstring>
+#include "utils.h"
+#include "layout.h"
+
+#define LAYOUT_BLOCK_SIZE 16
+
+static uint32_t readFileValue(const uint8_t *src, unsigned width,
+	unsigned isSigned) {
+
+	uint32_t ret = 0;
+	unsigned i;
+
+	for (i = width; i > 0; i--) {
+		ret = (ret << 8) | src[i - 1];
+	}
+
+	if (isSigned && width < 4 && (ret >> (8 * width - 1))) {
+		ret |= ~0U << (8 * width);
+	}
+
+	return ret;
+}
+
+static void writeFileValue(uint8_t *dest, unsigned width, uint32_t value) {
+	unsigned i;
+
+	for (i = 0; i < width; i++, value >>= 8) {
+		dest[i] = value & 0xff;
+	}
+}
+
+static uint32_t readMemberValue(const uint8_t *src, size_t width,
+	unsigned isSigned) {
+
+	uint8_t val8;
+	uint16_t val16;
+	uint32_t val32;
+
+	switch (width) {
+	case 1:
+		val8 = *src;
+		return isSigned ? (uint32_t)(int8_t)val8 : val8;
+
+	case 2:
+		memcpy(&val16, src, 2);
+		return isSigned ? (uint32_t)(int16_t)val16 : val16;
+
+	default:
+		memcpy(&val32, src, 4);
+		return val32;
+	}
+}
+
+static void writeMemberValue(uint8_t *dest, size_t width, uint32_t value) {
+	uint8_t val8 = value;
+	uint16_t val16 = value;
+
+	switch (width) {
+	case 1:
+		*dest = val8;
+		break;
+
+	case 2:
+		memcpy(dest, &val16, 2);
+		break;
+
+	default:
+		memcpy(dest, &value, 4);
+		break;
+	}
+}
+
+// Little endian file integer of the given type
+template <class T> static inline T loadFileValue(const uint8_t *src);
+
+template <> inline uint8_t loadFileValue<uint8_t>(const uint8_t *src) {
+	return src[0];
+}
+
+template <> inline int8_t loadFileValue<int8_t>(const uint8_t *src) {
+	return (int8_t)src[0];
+}
+
+template <> inline uint16_t loadFileValue<uint16_t>(const uint8_t *src) {
+	return src[0] | (src[1] << 8);
+}
+
+template <> inline int16_t loadFileValue<int16_t>(const uint8_t *src) {
+	return (int16_t)(src[0] | (src[1] << 8));
+}
+
+template <> inline uint32_t loadFileValue<uint32_t>(const uint8_t *src) {
+	return src[0] | (src[1] << 8) | (src[2] << 16) |
+		((uint32_t)src[3] << 24);
+}
+
+// Convert column of file integers of type F to members of type M. Signed
+// file values are sign extended to the member width.
+template <class F, class M> static void convertColumn(uint8_t *dest,
+	size_t destStride, const uint8_t *src, size_t srcStride,
+	unsigned count) {
+
+	unsigned i;
+	M value;
+
+	for (i = 0; i < count; i++, src += srcStride, dest += destStride) {
+		value = (M)loadFileValue<F>(src);
+		memcpy(dest, &value, sizeof(M));
+	}
+}
+
+template <class F> static void convertColumn(size_t memberWidth,
+	uint8_t *dest, size_t destStride, const uint8_t *src,
+	size_t srcStride, unsigned count) {
+
+	switch (memberWidth) {
+	case 1:
+		convertColumn<F, uint8_t>(dest, destStride, src, srcStride,
+			count);
+		break;
+
+	case 2:
+		convertColumn<F, uint16_t>(dest, destStride, src, srcStride,
+			count);
+		break;
+
+	default:
+		convertColumn<F, uint32_t>(dest, destStride, src, srcStride,
+			count);
+		break;
+	}
+}
+
+// Convert one integer column of count records. Each combination of file
+// and member width has its own tight loop.
+static void decodeColumn(const FieldLayout &field, uint8_t *dest,
+	size_t destStride, const uint8_t *src, size_t srcStride,
+	unsigned count) {
+
+	unsigned i;
+	uint32_t val32;
+
+	switch (field.width) {
+	case 1:
+		if (field.isSigned) {
+			convertColumn<int8_t>(field.memberWidth, dest,
+				destStride, src, srcStride, count);
+		} else {
+			convertColumn<uint8_t>(field.memberWidth, dest,
+				destStride, src, srcStride, count);
+		}
+
+		break;
+
+	case 2:
+		if (field.isSigned) {
+			convertColumn<int16_t>(field.memberWidth, dest,
+				destStride, src, srcStride, count);
+		} else {
+			convertColumn<uint16_t>(field.memberWidth, dest,
+				destStride, src, srcStride, count);
+		}
+
+		break;
+
+	case 4:
+		convertColumn<uint32_t>(field.memberWidth, dest, destStride,
+			src, srcStride, count);
+		break;
+
+	default:
+		for (i = 0; i < count; i++, src += srcStride,
+			dest += destStride) {
+			val32 = readFileValue(src, field.width, field.isSigned);
+			writeMemberValue(dest, field.memberWidth, val32);
+		}
+
+		break;
+	}
+}
+
+// Extract bitfield column from file integers of type F to members of type M
+template <class F, class M> static void decodeBits(const FieldLayout &field,
+	uint8_t *dest, size_t destStride, const uint8_t *src,
+	size_t srcStride, unsigned count) {
+
+	unsigned i, shift = field.shift;
+	uint32_t mask = ~0U >> (32 - field.bits);
+	M value;
+
+	for (i = 0; i < count; i++, src += srcStride, dest += destStride) {
+		value = (loadFileValue<F>(src) >> shift) & mask;
+		memcpy(dest, &value, sizeof(M));
+	}
+}
+
+template <class F> static void decodeBits(const FieldLayout &field,
+	uint8_t *dest, size_t destStride, const uint8_t *src,
+	size_t srcStride, unsigned count) {
+
+	switch (field.memberWidth) {
+	case 1:
+		decodeBits<F, uint8_t>(field, dest, destStride, src,
+			srcStride, count);
+		break;
+
+	case 2:
+		decodeBits<F, uint16_t>(field, dest, destStride, src,
+			srcStride, count);
+		break;
+
+	default:
+		decodeBits<F, uint32_t>(field, dest, destStride, src,
+			srcStride, count);
+		break;
+	}
+}
+
+// Decode count records field by field
+static void decodeFields(const RecordLayout &layout, uint8_t *dest,
+	size_t destStride, const uint8_t *src, size_t srcStride,
+	unsigned count) {
+
+	unsigned i, j, k;
+	uint32_t value;
+	uint8_t *ptr;
+	const uint8_t *sptr;
+
+	for (i = 0; i < layout.fieldCount; i++) {
+		const FieldLayout &field = layout.fields[i];
+
+		ptr = dest + field.memberOffset;
+		sptr = src + field.offset;
+
+		switch (field.type) {
+		case FIELD_INT:
+			// Byte arrays need no conversion
+			if (field.width == 1 && field.memberWidth == 1 &&
+				field.count > 1) {
+				for (j = 0; j < count; j++) {
+					memcpy(ptr + j * destStride,
+						sptr + j * srcStride,
+						field.count);
+				}
+
+				break;
+			}
+
+			for (k = 0; k < field.count; k++) {
+				decodeColumn(field, ptr + k * field.memberWidth,
+					destStride, sptr + k * field.width,
+					srcStride, count);
+			}
+
+			break;
+
+		case FIELD_STRING:
+			for (j = 0; j < count; j++) {
+				memcpy(ptr, sptr, field.count);
+				ptr[field.count - 1] = '\0';
+				ptr += destStride;
+				sptr += srcStride;
+			}
+
+			break;
+
+		case FIELD_BITS:
+			switch (field.width) {
+			case 1:
+				decodeBits<uint8_t>(field, ptr, destStride,
+					sptr, srcStride, count);
+				break;
+
+			case 2:
+				decodeBits<uint16_t>(field, ptr, destStride,
+					sptr, srcStride, count);
+				break;
+
+			case 4:
+				decodeBits<uint32_t>(field, ptr, destStride,
+					sptr, srcStride, count);
+				break;
+
+			default:
+				for (j = 0; j < count; j++) {
+					value = readFileValue(sptr, field.width,
+						0);
+					value = (value >> field.shift) &
+						(~0U >> (32 - field.bits));
+					writeMemberValue(ptr, field.memberWidth,
+						value);
+					ptr += destStride;
+					sptr += srcStride;
+				}
+
+				break;
+			}
+
+			break;
+
+		case FIELD_RECORD:
+			// Nested array items are records with their own stride.
+			// Run the column loops along the longer dimension.
+			if (field.count > count) {
+				for (j = 0; j < count; j++) {
+					decodeFields(*field.record,
+						ptr + j * destStride,
+						field.memberWidth,
+						sptr + j * srcStride,
+						field.width, field.count);
+				}
+
+				break;
+			}
+
+			for (k = 0; k < field.count; k++) {
+				decodeFields(*field.record,
+					ptr + k * field.memberWidth, destStride,
+					sptr + k * field.width, srcStride, count);
+			}
+
+			break;
+		}
+	}
+}
+
+// Store low bytes of value as little endian file integer of type T
+template <class T> static inline void storeFileValue(uint8_t *dest,
+	uint32_t value);
+
+template <> inline void storeFileValue<uint8_t>(uint8_t *dest,
+	uint32_t value) {
+
+	dest[0] = value;
+}
+
+template <> inline void storeFileValue<uint16_t>(uint8_t *dest,
+	uint32_t value) {
+
+	dest[0] = value & 0xff;
+	dest[1] = (value >> 8) & 0xff;
+}
+
+template <> inline void storeFileValue<uint32_t>(uint8_t *dest,
+	uint32_t value) {
+
+	dest[0] = value & 0xff;
+	dest[1] = (value >> 8) & 0xff;
+	dest[2] = (value >> 16) & 0xff;
+	dest[3] = (value >> 24) & 0xff;
+}
+
+// Convert column of members of type M to file integers of type F. Signed
+// members are sign extended to the file width.
+template <class M, class F> static void encodeColumn(uint8_t *dest,
+	size_t destStride, const uint8_t *src, size_t srcStride,
+	unsigned count) {
+
+	unsigned i;
+	M value;
+
+	for (i = 0; i < count; i++, src += srcStride, dest += destStride) {
+		memcpy(&value, src, sizeof(M));
+		storeFileValue<F>(dest, (uint32_t)value);
+	}
+}
+
+template <class M> static void encodeColumn(unsigned width, uint8_t *dest,
+	size_t destStride, const uint8_t *src, size_t srcStride,
+	unsigned count) {
+
+	switch (width) {
+	case 1:
+		encodeColumn<M, uint8_t>(dest, destStride, src, srcStride,
+			count);
+		break;
+
+	case 2:
+		encodeColumn<M, uint16_t>(dest, destStride, src, srcStride,
+			count);
+		break;
+
+	default:
+		encodeColumn<M, uint32_t>(dest, destStride, src, srcStride,
+			count);
+		break;
+	}
+}
+
+static void encodeColumn(const FieldLayout &field, uint8_t *dest,
+	size_t destStride, const uint8_t *src, size_t srcStride,
+	unsigned count) {
+
+	unsigned i;
+	uint32_t value;
+
+	if (field.width != 1 && field.width != 2 && field.width != 4) {
+		for (i = 0; i < count; i++, src += srcStride,
+			dest += destStride) {
+			value = readMemberValue(src, field.memberWidth,
+				field.isSigned);
+			writeFileValue(dest, field.width, value);
+		}
+
+		return;
+	}
+
+	switch (field.memberWidth) {
+	case 1:
+		if (field.isSigned) {
+			encodeColumn<int8_t>(field.width, dest, destStride,
+				src, srcStride, count);
+		} else {
+			encodeColumn<uint8_t>(field.width, dest, destStride,
+				src, srcStride, count);
+		}
+
+		break;
+
+	case 2:
+		if (field.isSigned) {
+			encodeColumn<int16_t>(field.width, dest, destStride,
+				src, srcStride, count);
+		} else {
+			encodeColumn<uint16_t>(field.width, dest, destStride,
+				src, srcStride, count);
+		}
+
+		break;
+
+	default:
+		encodeColumn<uint32_t>(field.width, dest, destStride, src,
+			srcStride, count);
+		break;
+	}
+}
+
+// Merge bitfield column of members of type M into file integers of type F
+template <class F, class M> static void encodeBits(const FieldLayout &field,
+	uint8_t *dest, size_t destStride, const uint8_t *src,
+	size_t srcStride, unsigned count) {
+
+	unsigned i, shift = field.shift;
+	uint32_t value, mask = (~0U >> (32 - field.bits)) << shift;
+	M member;
+
+	for (i = 0; i < count; i++, src += srcStride, dest += destStride) {
+		memcpy(&member, src, sizeof(M));
+		value = (((uint32_t)member << shift) & mask) |
+			(loadFileValue<F>(dest) & ~mask);
+		storeFileValue<F>(dest, value);
+	}
+}
+
+template <class F> static void encodeBits(const FieldLayout &field,
+	uint8_t *dest, size_t destStride, const uint8_t *src,
+	size_t srcStride, unsigned count) {
+
+	switch (field.memberWidth) {
+	case 1:
+		encodeBits<F, uint8_t>(field, dest, destStride, src,
+			srcStride, count);
+		break;
+
+	case 2:
+		encodeBits<F, uint16_t>(field, dest, destStride, src,
+			srcStride, count);
+		break;
+
+	default:
+		encodeBits<F, uint32_t>(field, dest, destStride, src,
+			srcStride, count);
+		break;
+	}
+}
+
+// Encode count records field by field
+static void encodeFields(const RecordLayout &layout, uint8_t *dest,
+	size_t destStride, const uint8_t *src, size_t srcStride,
+	unsigned count) {
+
+	unsigned i, j, k;
+	uint32_t value, mask;
+	uint8_t *dptr;
+	const uint8_t *ptr;
+
+	for (i = 0; i < layout.fieldCount; i++) {
+		const FieldLayout &field = layout.fields[i];
+
+		ptr = src + field.memberOffset;
+		dptr = dest + field.offset;
+
+		switch (field.type) {
+		case FIELD_INT:
+			if (field.width == 1 && field.memberWidth == 1) {
+				for (j = 0; j < count; j++) {
+					memcpy(dptr + j * destStride,
+						ptr + j * srcStride,
+						field.count);
+				}
+
+				break;
+			}
+
+			for (k = 0; k < field.count; k++) {
+				encodeColumn(field, dptr + k * field.width,
+					destStride, ptr + k * field.memberWidth,
+					srcStride, count);
+			}
+
+			break;
+
+		case FIELD_STRING:
+			// Keep the original terminator byte
+			for (j = 0; j < count; j++) {
+				memcpy(dptr + j * destStride,
+					ptr + j * srcStride, field.count - 1);
+			}
+
+			break;
+
+		case FIELD_BITS:
+			switch (field.width) {
+			case 1:
+				encodeBits<uint8_t>(field, dptr, destStride,
+					ptr, srcStride, count);
+				break;
+
+			case 2:
+				encodeBits<uint16_t>(field, dptr, destStride,
+					ptr, srcStride, count);
+				break;
+
+			case 4:
+				encodeBits<uint32_t>(field, dptr, destStride,
+					ptr, srcStride, count);
+				break;
+
+			default:
+				mask = (~0U >> (32 - field.bits)) <<
+					field.shift;
+
+				for (j = 0; j < count; j++) {
+					value = readMemberValue(ptr,
+						field.memberWidth, 0);
+					value = (value << field.shift) & mask;
+					value |= readFileValue(dptr,
+						field.width, 0) & ~mask;
+					writeFileValue(dptr, field.width,
+						value);
+					ptr += srcStride;
+					dptr += destStride;
+				}
+
+				break;
+			}
+
+			break;
+
+		case FIELD_RECORD:
+			// Same loop order as in decodeFields()
+			if (field.count > count) {
+				for (j = 0; j < count; j++) {
+					encodeFields(*field.record,
+						dptr + j * destStride,
+						field.width,
+						ptr + j * srcStride,
+						field.memberWidth,
+						field.count);
+				}
+
+				break;
+			}
+
+			for (k = 0; k < field.count; k++) {
+				encodeFields(*field.record,
+					dptr + k * field.width, destStride,
+					ptr + k * field.memberWidth, srcStride,
+					count);
+			}
+
+			break;
+		}
+	}
+}
+
+void decodeRecord(const RecordLayout &layout, void *dest,
+	const uint8_t *src) {
+
+	decodeFields(layout, (uint8_t*)dest, 0, src, 0, 1);
+}
+
+void decodeRecords(const RecordLayout &layout, void *dest, size_t stride,
+	const uint8_t *src, unsigned count) {
+
+	unsigned i, block;
+	uint8_t *ptr = (uint8_t*)dest;
+
+	// Column loops over the whole array would walk every record once per
+	// field. Convert small blocks of records which stay in cache instead.
+	for (i = 0; i < count; i += block) {
+		block = MIN(count - i, LAYOUT_BLOCK_SIZE);
+		decodeFields(layout, ptr + i * stride, stride,
+			src + i * layout.size, layout.size, block);
+	}
+}
+
+void encodeRecord(const RecordLayout &layout, const void *src,
+	uint8_t *dest) {
+
+	encodeFields(layout, dest, 0, (const uint8_t*)src, 0, 1);
+}
+
+void encodeRecords(const RecordLayout &layout, const void *src, size_t stride,
+	uint8_t *dest, unsigned count) {
+
+	unsigned i, block;
+	const uint8_t *ptr = (const uint8_t*)src;
+
+	for (i = 0; i < count; i += block) {
+		block = MIN(count - i, LAYOUT_BLOCK_SIZE);
+		encodeFields(layout, dest + i * layout.size, layout.size,
+			ptr + i * stride, stride, block);
+	}
+}
+
+void dumpRecord(const RecordLayout &layout, const void *src, FILE *out,
+	unsigned indent) {
+
+	unsigned i, j;
+	uint32_t value;
+	const uint8_t *base = (const uint8_t*)src, *ptr;
+
+	for (i = 0; i < layout.fieldCount; i++) {
+		const FieldLayout &field = layout.fields[i];
+
+		ptr = base + field.memberOffset;
+		fprintf(out, "%*s%s:", 2 * indent, "", field.name);
+
+		switch (field.type) {
+		case FIELD_INT:
+		case FIELD_BITS:
+			for (j = 0; j < field.count; j++) {
+				value = readMemberValue(ptr, field.memberWidth,
+					field.isSigned);
+
+				if (field.isSigned) {
+					fprintf(out, " %d", (int32_t)value);
+				} else {
+					fprintf(out, " %u", value);
+				}
+
+				ptr += field.memberWidth;
+			}
+
+			fputc('\n', out);
+			break;
+
+		case FIELD_STRING:
+			fprintf(out, " %s\n", (const char*)ptr);
+			break;
+
+		case FIELD_RECORD:
+			fputc('\n', out);
+
+			for (j = 0; j < field.count; j++) {
+				fprintf(out, "%*s[%u]\n", 2 * indent + 2, "",
+					j);
+				dumpRecord(*field.record, ptr, out,
+					indent + 2);
+				ptr += field.memberWidth;
+			}
+
+			break;
+		}
+	}
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef LAYOUT_H_
+#define LAYOUT_H_
+
+#include <cstddef>
+#include <cstdio>
+#include <inttypes.h>
+#include <type_traits>
+
+// Little endian integer or integer array
+#define FIELD_INT 0
+// Null terminated char array, the last byte is always cleared on load
+#define FIELD_STRING 1
+// Unsigned bitfield of little endian integer
+#define FIELD_BITS 2
+// Nested record or record array
+#define FIELD_RECORD 3
+
+struct RecordLayout;
+
+// Binary layout of one struct member in a fixed size file record
+struct FieldLayout {
+	const char *name;
+	unsigned type;
+	// Offset and size of one array item in the file record. For bitfields,
+	// width is the size of the integer which contains the bits.
+	unsigned offset, width;
+	// Offset and size of one array item in memory
+	size_t memberOffset, memberWidth;
+	unsigned count, isSigned;
+	unsigned shift, bits;
+	const RecordLayout *record;
+};
+
+struct RecordLayout {
+	const char *name;
+	// Size of the record in file and in memory
+	size_t size, memberSize;
+	const FieldLayout *fields;
+	unsigned fieldCount;
+};
+
+#define LAYOUT_MEMBER_TYPE(rtype, member) \
+	std::remove_extent<decltype(((rtype*)0)->member)>::type
+
+#define LAYOUT_FIELD(kind, rtype, member, offset, width, shift, bits, rec) \
+	{#member, kind, offset, width, offsetof(rtype, member), \
+	sizeof(LAYOUT_MEMBER_TYPE(rtype, member)), \
+	sizeof(((rtype*)0)->member) / \
+	sizeof(LAYOUT_MEMBER_TYPE(rtype, member)), \
+	std::is_signed<LAYOUT_MEMBER_TYPE(rtype, member)>::value, shift, \
+	bits, rec}
+
+// Integer field or array, signedness and array length are taken from
+// the struct member
+#define LAYOUT_INT(rtype, member, offset, width) \
+	LAYOUT_FIELD(FIELD_INT, rtype, member, offset, width, 0, 0, NULL)
+#define LAYOUT_STRING(rtype, member, offset) \
+	LAYOUT_FIELD(FIELD_STRING, rtype, member, offset, 1, 0, 0, NULL)
+#define LAYOUT_BITS(rtype, member, offset, width, shift, bits) \
+	LAYOUT_FIELD(FIELD_BITS, rtype, member, offset, width, shift, bits, \
+	NULL)
+#define LAYOUT_RECORD(rtype, member, offset, layout) \
+	LAYOUT_FIELD(FIELD_RECORD, rtype, member, offset, (layout).size, 0, \
+	0, &(layout))
+
+#define RECORD_LAYOUT(rtype, size, fields) \
+	{#rtype, size, sizeof(rtype), fields, \
+	sizeof(fields) / sizeof(fields[0])}
+
+// Convert file record to struct. Bytes not covered by the layout are
+// ignored.
+void decodeRecord(const RecordLayout &layout, void *dest,
+	const uint8_t *src);
+
+// Convert array of consecutive file records. Stride is the distance between
+// structs in memory, it may be larger than layout.memberSize.
+void decodeRecords(const RecordLayout &layout, void *dest, size_t stride,
+	const uint8_t *src, unsigned count);
+
+// Convert struct to file record. Bytes not covered by the layout are left
+// unchanged so that unknown data survives load and save.
+void encodeRecord(const RecordLayout &layout, const void *src,
+	uint8_t *dest);
+
+// Convert array of structs to consecutive file records
+void encodeRecords(const RecordLayout &layout, const void *src, size_t stride,
+	uint8_t *dest, unsigned count);
+
+// Print all fields of the struct, one per line
+void dumpRecord(const RecordLayout &layout, const void *src, FILE *out,
+	unsigned indent = 0);
+
+#endif
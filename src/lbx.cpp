@@ -20,6 +20,7 @@
 #include <stdexcept>
 #include <cstring>
 #include "system.h"
+#include "cache.h"
 #include "gfx.h"
 #include "gamestate.h"
 
@@ -34,6 +35,16 @@
 #define HELP_INDEX_SIZE 84
 #define MSGENG_ENTRY_SIZE 1063
 
+#define LOADTASK_FILE 0
+#define LOADTASK_ASSET 1
+#define LOADTASK_STRINGS 2
+#define LOADTASK_METHOD 3
+#define TEXT_LOAD_TASKS (TXT_MISC_COUNT + TXT_TECH_COUNT + 20)
+#define TEXT_CACHE_LISTS (TXT_MISC_COUNT + TXT_TECH_COUNT + 17)
+#define TEXT_CACHE_VERSION 1
+#define IMAGE_CACHE_VERSION 1
+#define IMAGE_CACHE_NAME "image"
+
 #define ANTARMSG_ARCHIVE "antarmsg.lbx"
 #define COUNCMSG_ARCHIVE "councmsg.lbx"
 #define RACENAME_ARCHIVE "racename.lbx"
@@ -68,6 +79,69 @@ static const char *officer_archives[] = {"herodata.lbx", "herodatg.lbx",
 static const char *help_archives[] = {"help.lbx", "ger_help.lbx",
 	"fre_help.lbx", "spa_help.lbx", "ita_help.lbx"};
 
+// Cache key covers all source archives of the given language
+static void textCacheKey(CacheKey &key, unsigned lang_id) {
+	unsigned i;
+
+	key.addValue(lang_id);
+
+	for (i = 0; i < TXT_MISC_COUNT; i++) {
+		key.addDataFile(misc_archives[i]);
+	}
+
+	key.addDataFile(ANTARMSG_ARCHIVE);
+	key.addDataFile(COUNCMSG_ARCHIVE);
+	key.addDataFile(maintext_archives[lang_id]);
+	key.addDataFile(eventmsg_archives[lang_id]);
+	key.addDataFile(rstring_archives[lang_id]);
+	key.addDataFile(credits_archives[lang_id]);
+	key.addDataFile(skildesc_archives[lang_id]);
+	key.addDataFile(techdesc_archives[lang_id]);
+	key.addDataFile(RACENAME_ARCHIVE);
+	key.addDataFile(SHIPNAME_ARCHIVE);
+	key.addDataFile(STARNAME_ARCHIVE);
+	key.addDataFile(estrings_archives[lang_id]);
+	key.addDataFile(hstrings_archives[lang_id]);
+	key.addDataFile(RACESTUF_ARCHIVE);
+	key.addDataFile(TECHNAME_ARCHIVE);
+	key.addDataFile(diplomsg_archives[lang_id]);
+	key.addDataFile(help_archives[lang_id]);
+	key.addDataFile(officer_archives[lang_id]);
+}
+
+static uint64_t paletteHash(const uint8_t **palettes, unsigned palcount) {
+	unsigned i;
+	uint8_t flag;
+	uint64_t ret = cacheHash(&palcount, sizeof(palcount));
+
+	for (i = 0; i < palcount; i++) {
+		flag = palettes[i] ? 1 : 0;
+		ret = cacheHash(&flag, sizeof(flag), ret);
+
+		if (palettes[i]) {
+			ret = cacheHash(palettes[i], PALSIZE, ret);
+		}
+	}
+
+	return ret;
+}
+
+static char *copyCacheString(CacheReader &reader) {
+	const char *str = reader.readString();
+
+	return str ? copystr(str) : NULL;
+}
+
+static unsigned readCacheCount(CacheReader &reader, size_t limit) {
+	unsigned ret = reader.readUint32();
+
+	if (ret > limit) {
+		throw std::runtime_error("Invalid item count in cache data");
+	}
+
+	return ret;
+}
+
 static LBXArchive *openLBX(const char *filename) {
 	char *realname = NULL, *path = NULL;
 	LBXArchive *ret;
@@ -88,6 +162,59 @@ static LBXArchive *openLBX(const char *filename) {
 	return ret;
 }
 
+// Load a single string list or run one of the TextManager loaders
+class TextManager::LoadTask : public Task {
+private:
+	TextManager *_parent;
+	StringList *_list;
+	void (TextManager::*_method)(unsigned);
+	const char *_filename;
+	unsigned _type, _args[4];
+
+protected:
+	void run(void);
+
+public:
+	LoadTask(void);
+
+	void loadFile(StringList *list, const char *filename, unsigned offset,
+		unsigned step, unsigned group_id, unsigned groups);
+	void loadAsset(StringList *list, const char *filename,
+		unsigned asset_id);
+	void loadStrings(StringList *list, const char *filename,
+		unsigned asset_id, unsigned offset);
+	void loadMethod(TextManager *parent,
+		void (TextManager::*method)(unsigned), unsigned lang_id);
+};
+
+class TextManagerTask : public Task {
+private:
+	unsigned _lang;
+
+protected:
+	void run(void);
+
+public:
+	TextManager *result;
+	unsigned ticks;
+
+	explicit TextManagerTask(unsigned lang_id);
+};
+
+class FontManagerTask : public Task {
+private:
+	unsigned _lang;
+
+protected:
+	void run(void);
+
+public:
+	FontManager *result;
+	unsigned ticks;
+
+	explicit FontManagerTask(unsigned lang_id);
+};
+
 static MemoryReadStream *loadLBXAsset(const char *filename,
 	unsigned asset_id) {
 	LBXArchive *lbx = NULL;
@@ -382,8 +509,108 @@ void TextManager::StringList::loadStrings(const char *filename,
 	delete asset;
 }
 
-TextManager::TextManager(unsigned lang_id) : _officerTitle(NULL),
-	_diplomsg(NULL), _diplomsgCount(0), _help(NULL), _helpCount(0) {
+void TextManager::StringList::loadCache(CacheReader &reader) {
+	unsigned i, newsize;
+
+	clear();
+	newsize = readCacheCount(reader, reader.remaining());
+
+	if (!newsize) {
+		return;
+	}
+
+	data = new char*[newsize];
+	memset(data, 0, newsize * sizeof(char*));
+	size = newsize;
+
+	for (i = 0; i < size; i++) {
+		data[i] = copyCacheString(reader);
+	}
+}
+
+void TextManager::StringList::saveCache(CacheWriter &writer) const {
+	unsigned i;
+
+	writer.writeUint32(size);
+
+	for (i = 0; i < size; i++) {
+		writer.writeString(data[i]);
+	}
+}
+
+TextManager::LoadTask::LoadTask(void) : _parent(NULL), _list(NULL),
+	_method(NULL), _filename(NULL), _type(LOADTASK_FILE) {
+
+	memset(_args, 0, sizeof(_args));
+}
+
+void TextManager::LoadTask::loadFile(StringList *list, const char *filename,
+	unsigned offset, unsigned step, unsigned group_id, unsigned groups) {
+
+	_type = LOADTASK_FILE;
+	_list = list;
+	_filename = filename;
+	_args[0] = offset;
+	_args[1] = step;
+	_args[2] = group_id;
+	_args[3] = groups;
+}
+
+void TextManager::LoadTask::loadAsset(StringList *list, const char *filename,
+	unsigned asset_id) {
+
+	_type = LOADTASK_ASSET;
+	_list = list;
+	_filename = filename;
+	_args[0] = asset_id;
+}
+
+void TextManager::LoadTask::loadStrings(StringList *list,
+	const char *filename, unsigned asset_id, unsigned offset) {
+
+	_type = LOADTASK_STRINGS;
+	_list = list;
+	_filename = filename;
+	_args[0] = asset_id;
+	_args[1] = offset;
+}
+
+void TextManager::LoadTask::loadMethod(TextManager *parent,
+	void (TextManager::*method)(unsigned), unsigned lang_id) {
+
+	_type = LOADTASK_METHOD;
+	_parent = parent;
+	_method = method;
+	_args[0] = lang_id;
+}
+
+void TextManager::LoadTask::run(void) {
+	switch (_type) {
+	case LOADTASK_FILE:
+		_list->loadFile(_filename, _args[0], _args[1], _args[2],
+			_args[3]);
+		break;
+
+	case LOADTASK_ASSET:
+		_list->loadAsset(_filename, _args[0]);
+		break;
+
+	case LOADTASK_STRINGS:
+		_list->loadStrings(_filename, _args[0], _args[1]);
+		break;
+
+	case LOADTASK_METHOD:
+		(_parent->*_method)(_args[0]);
+		break;
+
+	default:
+		throw std::logic_error("Invalid text load task");
+	}
+}
+
+TextManager::TextManager(unsigned lang_id, int packing) :
+	_officerTitle(NULL), _diplomsg(NULL), _diplomsgCount(0), _help(NULL),
+	_helpCount(0), _searchIndex(NULL) {
 
 	unsigned i;
 
@@ -392,10 +619,34 @@ TextManager::TextManager(unsigned lang_id) : _officerTitle(NULL),
 		_helpIndexCount[i] = 0;
 	}
 
-	load(lang_id);
+	if (packing) {
+		load(lang_id);
+		return;
+	}
+
+	if (!loadCache(lang_id)) {
+		load(lang_id);
+
+		try {
+			saveCache(lang_id);
+		} catch (...) {
+			// The game works fine without cache
+		}
+	}
+
+	try {
+		_searchIndex = new TextSearchIndex(this);
+		_searchIndex->build();
+	} catch (...) {
+		delete _searchIndex;
+		clear();
+		throw;
+	}
 }
 
 TextManager::~TextManager(void) {
+	// Stop the index builder before freeing the strings
+	delete _searchIndex;
 	clear();
 }
 
@@ -418,7 +669,9 @@ void TextManager::clear(void) {
 	delete[] _help;
 	_officerTitle = NULL;
 	_diplomsg = NULL;
+	_diplomsgCount = 0;
 	_help = NULL;
+	_helpCount = 0;
 }
 
 void TextManager::loadDiplomsg(unsigned lang_id) {
@@ -583,8 +836,11 @@ void TextManager::loadOfficerTitles(unsigned lang_id) {
 		_officerTitle = new char*[count];
 		memset(_officerTitle, 0, count * sizeof(char*));
 
+		DataCursor data((const uint8_t*)asset->dataPtr() + asset->pos(),
+			asset->size() - asset->pos());
+
 		for (i = 0; i < count; i++) {
-			tmp.load(*asset);
+			tmp.load(data);
 			_officerTitle[i] = copystr(tmp.title);
 		}
 
@@ -599,46 +855,254 @@ void TextManager::loadOfficerTitles(unsigned lang_id) {
 }
 
 void TextManager::load(unsigned lang_id) {
-	unsigned i;
+	unsigned i, count = 0;
+	LoadTask tasks[TEXT_LOAD_TASKS];
+	// The pool must be destroyed before the tasks
+	WorkerPool pool;
 
 	for (i = 0; i < TXT_MISC_COUNT; i++) {
-		_misctext[i].loadFile(misc_archives[i], lang_id, LANG_GROUPS,
-			0, 1);
+		tasks[count++].loadFile(_misctext + i, misc_archives[i],
+			lang_id, LANG_GROUPS, 0, 1);
 	}
 
-	_antarmsg.loadFile(ANTARMSG_ARCHIVE, 0, 1, lang_id, LANG_GROUPS);
-	_councmsg.loadFile(COUNCMSG_ARCHIVE, 0, 1, lang_id, LANG_GROUPS);
-	_maintext.loadFile(maintext_archives[lang_id], 0, 1, 0, 1);
-	_eventmsg.loadFile(eventmsg_archives[lang_id], 0, 1, 0, 1);
-	_rstring.loadStrings(rstring_archives[lang_id], 0, 4);
-	_credits.loadAsset(credits_archives[lang_id], 0);
-	_skillname.loadAsset(skildesc_archives[lang_id], 0);
-	_skilldesc.loadAsset(skildesc_archives[lang_id], 1);
-
-	for (unsigned i = 0; i < TXT_TECH_COUNT; i++) {
-		_techdesc[i].loadAsset(techdesc_archives[lang_id], i);
+	tasks[count++].loadFile(&_antarmsg, ANTARMSG_ARCHIVE, 0, 1, lang_id,
+		LANG_GROUPS);
+	tasks[count++].loadFile(&_councmsg, COUNCMSG_ARCHIVE, 0, 1, lang_id,
+		LANG_GROUPS);
+	tasks[count++].loadFile(&_maintext, maintext_archives[lang_id], 0, 1,
+		0, 1);
+	tasks[count++].loadFile(&_eventmsg, eventmsg_archives[lang_id], 0, 1,
+		0, 1);
+	tasks[count++].loadStrings(&_rstring, rstring_archives[lang_id], 0, 4);
+	tasks[count++].loadAsset(&_credits, credits_archives[lang_id], 0);
+	tasks[count++].loadAsset(&_skillname, skildesc_archives[lang_id], 0);
+	tasks[count++].loadAsset(&_skilldesc, skildesc_archives[lang_id], 1);
+
+	for (i = 0; i < TXT_TECH_COUNT; i++) {
+		tasks[count++].loadAsset(_techdesc + i,
+			techdesc_archives[lang_id], i);
 	}
 
-	_racename.loadAsset(RACENAME_ARCHIVE, 0);
-	_shipname.loadAsset(SHIPNAME_ARCHIVE, 0);
-	_homeworlds.loadAsset(STARNAME_ARCHIVE, 0);
-	_starname.loadAsset(STARNAME_ARCHIVE, 1);
-	_estrings.loadStrings(estrings_archives[lang_id], 0, 6);
-	_hstrings.loadStrings(hstrings_archives[lang_id], 0, 6);
-	_raceTraits.loadStrings(RACESTUF_ARCHIVE, lang_id, 0);
-	_raceInfo.loadStrings(RACESTUF_ARCHIVE, 8 + lang_id, 0);
-	_techname.loadStrings(TECHNAME_ARCHIVE, lang_id, 0);
+	tasks[count++].loadAsset(&_racename, RACENAME_ARCHIVE, 0);
+	tasks[count++].loadAsset(&_shipname, SHIPNAME_ARCHIVE, 0);
+	tasks[count++].loadAsset(&_homeworlds, STARNAME_ARCHIVE, 0);
+	tasks[count++].loadAsset(&_starname, STARNAME_ARCHIVE, 1);
+	tasks[count++].loadStrings(&_estrings, estrings_archives[lang_id], 0,
+		6);
+	tasks[count++].loadStrings(&_hstrings, hstrings_archives[lang_id], 0,
+		6);
+	tasks[count++].loadStrings(&_raceTraits, RACESTUF_ARCHIVE, lang_id, 0);
+	tasks[count++].loadStrings(&_raceInfo, RACESTUF_ARCHIVE, 8 + lang_id,
+		0);
+	tasks[count++].loadStrings(&_techname, TECHNAME_ARCHIVE, lang_id, 0);
+	tasks[count++].loadMethod(this, &TextManager::loadDiplomsg, lang_id);
+	tasks[count++].loadMethod(this, &TextManager::loadHelp, lang_id);
+	tasks[count++].loadMethod(this, &TextManager::loadOfficerTitles,
+		lang_id);
 
 	try {
-		loadDiplomsg(lang_id);
-		loadHelp(lang_id);
-		loadOfficerTitles(lang_id);
+		for (i = 0; i < count; i++) {
+			pool.add(tasks + i);
+		}
+
+		pool.wait();
 	} catch (...) {
+		pool.wait();
 		clear();
 		throw;
 	}
 }
 
+unsigned TextManager::stringLists(StringList **lists) {
+	unsigned i, count = 0;
+
+	for (i = 0; i < TXT_MISC_COUNT; i++) {
+		lists[count++] = _misctext + i;
+	}
+
+	lists[count++] = &_antarmsg;
+	lists[count++] = &_councmsg;
+	lists[count++] = &_maintext;
+	lists[count++] = &_eventmsg;
+	lists[count++] = &_rstring;
+	lists[count++] = &_credits;
+	lists[count++] = &_skillname;
+	lists[count++] = &_skilldesc;
+
+	for (i = 0; i < TXT_TECH_COUNT; i++) {
+		lists[count++] = _techdesc + i;
+	}
+
+	lists[count++] = &_racename;
+	lists[count++] = &_shipname;
+	lists[count++] = &_homeworlds;
+	lists[count++] = &_starname;
+	lists[count++] = &_estrings;
+	lists[count++] = &_hstrings;
+	lists[count++] = &_raceTraits;
+	lists[count++] = &_raceInfo;
+	lists[count++] = &_techname;
+	return count;
+}
+
+int TextManager::loadCache(unsigned lang_id) {
+	size_t size;
+	const uint8_t *data;
+	const AssetBundle *bundle = gameAssets ? gameAssets->bundle() : NULL;
+	CacheKey key("text", TEXT_CACHE_VERSION);
+	CacheFile file;
+	StringBuffer filename;
+
+	if (bundle) {
+		filename.printf("text/%u", lang_id);
+		data = bundle->find(filename.c_str(), &size);
+
+		if (data) {
+			CacheReader reader(data, size);
+
+			if (readCache(reader)) {
+				return 1;
+			}
+		}
+	}
+
+	// Missing data files will be reported by the full loader
+	try {
+		textCacheKey(key, lang_id);
+		filename.printf("text%u.cache", lang_id);
+
+		if (!file.open(filename.c_str(), key)) {
+			return 0;
+		}
+	} catch (...) {
+		return 0;
+	}
+
+	CacheReader reader(file.data(), file.size());
+	return readCache(reader);
+}
+
+int TextManager::readCache(CacheReader &reader) {
+	unsigned i, j, count;
+	StringList *lists[TEXT_CACHE_LISTS];
+
+	count = stringLists(lists);
+
+	try {
+		for (i = 0; i < count; i++) {
+			lists[i]->loadCache(reader);
+		}
+
+		count = readCacheCount(reader, reader.remaining());
+		_diplomsg = new StringList[count];
+		_diplomsgCount = count;
+
+		for (i = 0; i < count; i++) {
+			_diplomsg[i].loadCache(reader);
+		}
+
+		_officerTitle = new char*[LEADER_COUNT];
+		memset(_officerTitle, 0, LEADER_COUNT * sizeof(char*));
+
+		for (i = 0; i < LEADER_COUNT; i++) {
+			_officerTitle[i] = copyCacheString(reader);
+		}
+
+		count = readCacheCount(reader, reader.remaining());
+		_help = new HelpText[count];
+		_helpCount = count;
+
+		for (i = 0; i < count; i++) {
+			_help[i].title = copyCacheString(reader);
+			_help[i].text = copyCacheString(reader);
+			_help[i].archive = copyCacheString(reader);
+			_help[i].asset_id = reader.readUint32();
+			_help[i].frame = reader.readUint32();
+			_help[i].section = reader.readUint32();
+			_help[i].nextParagraph = reader.readUint32();
+		}
+
+		for (i = 0; i < TXT_HELPSECTION_COUNT; i++) {
+			count = readCacheCount(reader, reader.remaining());
+			_helpIndex[i] = new HelpLink[count];
+			_helpIndexCount[i] = count;
+
+			for (j = 0; j < count; j++) {
+				_helpIndex[i][j].title =
+					copyCacheString(reader);
+				_helpIndex[i][j].id = reader.readUint32();
+			}
+		}
+
+		if (!reader.eos()) {
+			throw std::runtime_error("Trailing garbage in cache");
+		}
+	} catch (...) {
+		// Damaged cache, fall back to loading the original files
+		for (i = 0; i < TEXT_CACHE_LISTS; i++) {
+			lists[i]->clear();
+		}
+
+		clear();
+		return 0;
+	}
+
+	return 1;
+}
+
+void TextManager::saveCache(unsigned lang_id) {
+	CacheKey key("text", TEXT_CACHE_VERSION);
+	CacheWriter writer;
+	StringBuffer filename;
+
+	textCacheKey(key, lang_id);
+	filename.printf("text%u.cache", lang_id);
+	writeCache(writer);
+	writer.save(filename.c_str(), key);
+}
+
+void TextManager::writeCache(CacheWriter &writer) {
+	unsigned i, j, count;
+	StringList *lists[TEXT_CACHE_LISTS];
+
+	count = stringLists(lists);
+
+	for (i = 0; i < count; i++) {
+		lists[i]->saveCache(writer);
+	}
+
+	writer.writeUint32(_diplomsgCount);
+
+	for (i = 0; i < _diplomsgCount; i++) {
+		_diplomsg[i].saveCache(writer);
+	}
+
+	for (i = 0; i < LEADER_COUNT; i++) {
+		writer.writeString(_officerTitle[i]);
+	}
+
+	writer.writeUint32(_helpCount);
+
+	for (i = 0; i < _helpCount; i++) {
+		writer.writeString(_help[i].title);
+		writer.writeString(_help[i].text);
+		writer.writeString(_help[i].archive);
+		writer.writeUint32(_help[i].asset_id);
+		writer.writeUint32(_help[i].frame);
+		writer.writeUint32(_help[i].section);
+		writer.writeUint32(_help[i].nextParagraph);
+	}
+
+	for (i = 0; i < TXT_HELPSECTION_COUNT; i++) {
+		writer.writeUint32(_helpIndexCount[i]);
+
+		for (j = 0; j < _helpIndexCount[i]; j++) {
+			writer.writeString(_helpIndex[i][j].title);
+			writer.writeUint32(_helpIndex[i][j].id);
+		}
+	}
+}
+
 const char *TextManager::antarmsg(unsigned str_id) const {
 	return _antarmsg[str_id];
 }
@@ -687,6 +1151,14 @@ const char *TextManager::techdesc(unsigned asset_id, unsigned str_id) const {
 	return _techdesc[asset_id][str_id];
 }
 
+unsigned TextManager::techdescCount(unsigned asset_id) const {
+	if (asset_id >= TXT_TECH_COUNT) {
+		throw std::out_of_range("Ship tech group ID out of range");
+	}
+
+	return _techdesc[asset_id].size;
+}
+
 const char *TextManager::racename(unsigned str_id) const {
 	return _racename[str_id];
 }
@@ -747,6 +1219,10 @@ const struct HelpText *TextManager::help(unsigned id) const {
 	return _help + id;
 }
 
+unsigned TextManager::helpCount(void) const {
+	return _helpCount;
+}
+
 const struct HelpLink *TextManager::helpIndex(unsigned section_id,
 	unsigned entry_id) const {
 
@@ -761,6 +1237,24 @@ const struct HelpLink *TextManager::helpIndex(unsigned section_id,
 	return _helpIndex[section_id] + entry_id;
 }
 
+unsigned TextManager::helpIndexCount(unsigned section_id) const {
+	if (section_id >= TXT_HELPSECTION_COUNT) {
+		throw std::out_of_range("Help section ID out of range");
+	}
+
+	return _helpIndexCount[section_id];
+}
+
+unsigned TextManager::search(const char *query, TextSearchResult *results,
+	unsigned maxcount) {
+
+	if (!_searchIndex) {
+		return 0;
+	}
+
+	return _searchIndex->search(query, results, maxcount);
+}
+
 LBXCacheEntry::LBXCacheEntry(void) {
 
 }
@@ -795,11 +1289,23 @@ void LBXAsset::release(void) {
 	ref->release();
 }
 
-AssetManager::AssetManager(void) : _curfile(NULL), _cache(NULL),
-	_cacheCount(0), _cacheSize(32) {
+AssetManager::AssetManager(uint64_t imageCacheLimit) : _curfile(NULL),
+	_cache(NULL), _cacheCount(0), _cacheSize(32), _imageCache(NULL),
+	_bundle(NULL) {
 
 	_cache = new FileCache[_cacheSize];
 	memset(_cache, 0, _cacheSize * sizeof(FileCache));
+
+	if (!imageCacheLimit) {
+		return;
+	}
+
+	try {
+		_imageCache = new CacheIndex(IMAGE_CACHE_NAME, imageCacheLimit);
+	} catch (...) {
+		// The game works fine without cache
+		_imageCache = NULL;
+	}
 }
 
 AssetManager::~AssetManager(void) {
@@ -811,6 +1317,8 @@ AssetManager::~AssetManager(void) {
 		delete[] _cache[i].bitmaps;
 	}
 
+	delete _bundle;
+	delete _imageCache;
 	delete _curfile;
 	delete[] _cache;
 }
@@ -860,6 +1368,8 @@ AssetManager::FileCache *AssetManager::getCache(const char *filename) {
 	_cacheCount++;
 	_cache[i].filename = realname;
 	_cache[i].size = 0;
+	_cache[i].fileSize = 0;
+	_cache[i].fileTime = 0;
 	_cache[i].images = NULL;
 	_cache[i].bitmaps = NULL;
 	return _cache + i;
@@ -905,11 +1415,87 @@ MemoryReadStream *AssetManager::rawData(FileCache *entry, unsigned id) {
 	return _curfile->loadAsset(id);
 }
 
+Image *AssetManager::loadCachedImage(FileCache *entry, unsigned id,
+	const uint8_t **palettes, unsigned palcount) {
+
+	uint64_t hash, palhash = paletteHash(palettes, palcount);
+	char *path;
+	Image *img;
+	CacheKey key("image", IMAGE_CACHE_VERSION);
+	CacheWriter writer;
+	CacheFile file;
+	StringBuffer filename;
+
+	if (!entry->fileSize) {
+		path = dataPath(entry->filename);
+		fileInfo(path, &entry->fileSize, &entry->fileTime);
+		delete[] path;
+	}
+
+	key.addFileInfo(entry->filename, entry->fileSize, entry->fileTime);
+	key.addValue(id);
+	key.addValue(palhash & 0xffffffff);
+	key.addValue(palhash >> 32);
+	hash = cacheHash(key.data(), key.size());
+	_imageCache->entryName(filename, hash);
+
+	if (_imageCache->touch(hash)) {
+		try {
+			if (file.open(filename.c_str(), key)) {
+				CacheReader reader(file.data(), file.size());
+
+				return new Image(reader);
+			}
+		} catch (...) {
+			// Damaged cache file, decode the image again
+		}
+
+		_imageCache->remove(hash);
+	}
+
+	// The writer stays empty for images below IMAGE_CACHE_MIN_SIZE
+	img = decodeImage(entry, id, palettes, palcount, &writer);
+
+	if (writer.size() < IMAGE_CACHE_MIN_SIZE) {
+		return img;
+	}
+
+	try {
+		if (_imageCache->add(hash, writer.size())) {
+			writer.save(filename.c_str(), key);
+			_imageCache->save();
+		}
+	} catch (...) {
+		// The game works fine without cache
+		_imageCache->remove(hash);
+	}
+
+	return img;
+}
+
+Image *AssetManager::decodeImage(FileCache *entry, unsigned id,
+	const uint8_t **palettes, unsigned palcount, CacheWriter *cache) {
+
+	MemoryReadStream *stream;
+	Image *img = NULL;
+
+	stream = rawData(entry, id);
+
+	try {
+		img = new Image(*stream, palettes, palcount, cache);
+	} catch (...) {
+		delete stream;
+		throw;
+	}
+
+	delete stream;
+	return img;
+}
+
 AssetManager::FileCache *AssetManager::cacheImage(const char *filename,
 	unsigned id, const uint8_t **palettes, unsigned palcount) {
 
 	FileCache *entry;
-	MemoryReadStream *stream;
 	Image *img = NULL;
 
 	entry = getCache(filename);
@@ -918,16 +1504,39 @@ AssetManager::FileCache *AssetManager::cacheImage(const char *filename,
 		return entry;
 	}
 
-	stream = rawData(entry, id);
+	// Cache hit skips rawData(), the asset table must be loaded anyway
+	openArchive(entry);
 
-	try {
-		img = new Image(*stream, palettes, palcount);
-	} catch (...) {
-		delete stream;
-		throw;
+	if (id >= entry->size) {
+		throw std::out_of_range("Invalid asset ID");
+	}
+
+	if (_bundle) {
+		StringBuffer name;
+		const uint8_t *data;
+		size_t size;
+
+		imageBundleName(name, entry->filename, id, palettes, palcount);
+		data = _bundle->find(name.c_str(), &size);
+
+		if (data) {
+			CacheReader reader(data, size);
+
+			// Damaged bundle entry, decode the image again
+			try {
+				img = new Image(reader);
+			} catch (...) {
+				img = NULL;
+			}
+		}
+	}
+
+	if (!img && _imageCache) {
+		img = loadCachedImage(entry, id, palettes, palcount);
+	} else if (!img) {
+		img = decodeImage(entry, id, palettes, palcount, NULL);
 	}
 
-	delete stream;
 	entry->images[id].data = img;
 	entry->images[id].refs = 0;
 	img->_cacheRef = entry->images + id;
@@ -990,22 +1599,108 @@ MemoryReadStream *AssetManager::rawData(const char *filename, unsigned id) {
 	return rawData(entry, id);
 }
 
-void selectLanguage(unsigned lang_id) {
-	TextManager *oldlang, *lang = NULL;
-	FontManager *oldfonts, *fonts = NULL;
+int AssetManager::openBundle(const char *filename) {
+	AssetBundle *bundle;
+	char *path;
+	int ret;
+
+	path = dataPath(filename);
 
 	try {
-		lang = new TextManager(lang_id);
-		fonts = new FontManager(lang_id);
+		bundle = new AssetBundle;
 	} catch (...) {
-		delete lang;
+		delete[] path;
 		throw;
 	}
 
+	try {
+		ret = bundle->open(path);
+	} catch (...) {
+		delete bundle;
+		delete[] path;
+		throw;
+	}
+
+	delete[] path;
+
+	if (!ret) {
+		delete bundle;
+		return 0;
+	}
+
+	delete _bundle;
+	_bundle = bundle;
+	return 1;
+}
+
+const AssetBundle *AssetManager::bundle(void) const {
+	return _bundle;
+}
+
+void AssetManager::imageBundleName(StringBuffer &buf, const char *filename,
+	unsigned id, const uint8_t **palettes, unsigned palcount) {
+
+	uint64_t palhash = paletteHash(palettes, palcount);
+
+	buf.printf("image/%s/%u/%08x%08x", filename, id,
+		unsigned(palhash >> 32), unsigned(palhash & 0xffffffff));
+}
+
+TextManagerTask::TextManagerTask(unsigned lang_id) : _lang(lang_id),
+	result(NULL), ticks(0) {
+
+}
+
+void TextManagerTask::run(void) {
+	unsigned start = getTicks();
+
+	result = new TextManager(_lang);
+	ticks = getTicks() - start;
+}
+
+FontManagerTask::FontManagerTask(unsigned lang_id) : _lang(lang_id),
+	result(NULL), ticks(0) {
+
+}
+
+void FontManagerTask::run(void) {
+	unsigned start = getTicks();
+
+	// FontManager reads the font archive through gameAssets. That's
+	// safe only because nothing else uses it until the pool finishes.
+	result = new FontManager(_lang);
+	ticks = getTicks() - start;
+}
+
+void selectLanguage(unsigned lang_id, LanguageLoadTimes *times) {
+	TextManager *oldlang;
+	FontManager *oldfonts;
+	unsigned start = getTicks();
+	TextManagerTask langTask(lang_id);
+	FontManagerTask fontTask(lang_id);
+	WorkerPool pool(2);
+
+	try {
+		pool.add(&langTask);
+		pool.add(&fontTask);
+		pool.wait();
+	} catch (...) {
+		pool.wait();
+		delete langTask.result;
+		delete fontTask.result;
+		throw;
+	}
+
+	if (times) {
+		times->text = langTask.ticks;
+		times->fonts = fontTask.ticks;
+		times->total = getTicks() - start;
+	}
+
 	oldlang = gameLang;
 	oldfonts = gameFonts;
-	gameLang = lang;
-	gameFonts = fonts;
+	gameLang = langTask.result;
+	gameFonts = fontTask.result;
 
 	if (oldlang) {
 		oldlang->discard();
@@ -22,6 +22,7 @@
 
 #include <stdexcept>
 #include "stream.h"
+#include "search.h"
 #include "utils.h"
 
 #define LANG_ENGLISH 0
@@ -45,6 +46,17 @@
 #define TXT_TECH_COUNT 4
 #define TXT_HELPSECTION_COUNT 16
 
+// Maximum size of decoded image cache on disk, 0 disables the cache
+#define IMAGE_CACHE_LIMIT (256 * 1024 * 1024)
+// Smaller images are faster to decode than to load from separate file
+#define IMAGE_CACHE_MIN_SIZE (16 * 1024)
+#define ASSET_BUNDLE_FILE "openorion2.bundle"
+
+class CacheReader;
+class CacheWriter;
+class CacheIndex;
+class AssetBundle;
+
 struct HelpText {
 	char *title, *text, *archive;
 	unsigned asset_id, frame;	// Image to display in help window
@@ -93,17 +105,20 @@ public:
 	MemoryReadStream *loadAsset(unsigned id);
 };
 
+struct LanguageLoadTimes {
+	unsigned text, fonts, total;	// milliseconds
+};
+
 class TextManager : public Recyclable {
 private:
+	class LoadTask;
+
 	struct StringList {
 	private:
 		// Do NOT implement
 		StringList(const StringList &other);
 		const StringList &operator=(const StringList &other);
 
-	protected:
-		void clear(void);
-
 	public:
 		char **data;
 		unsigned size;
@@ -111,6 +126,7 @@ private:
 		StringList(void);
 		~StringList(void);
 
+		void clear(void);
 		const char *operator[](unsigned id) const;
 
 		// Multiple assets, one string each
@@ -123,6 +139,9 @@ private:
 		// Single asset, single string block with multiple strings
 		void loadStrings(const char *filename, unsigned asset_id,
 			unsigned offset);
+
+		void loadCache(CacheReader &reader);
+		void saveCache(CacheWriter &writer) const;
 	};
 
 	// billtext, jimtext, kentext
@@ -158,6 +177,8 @@ private:
 	struct HelpLink *_helpIndex[TXT_HELPSECTION_COUNT];
 	unsigned _helpIndexCount[TXT_HELPSECTION_COUNT];
 
+	TextSearchIndex *_searchIndex;
+
 	// Do NOT implement
 	TextManager(const TextManager &other);
 	const TextManager &operator=(const TextManager &other);
@@ -170,8 +191,20 @@ protected:
 	void loadOfficerTitles(unsigned lang_id);
 	void load(unsigned lang_id);
 
+	// Fill the buffer with all simple string lists in fixed order
+	unsigned stringLists(StringList **lists);
+
+	// Load all text from asset bundle or cache file. Returns 0 if
+	// the cache is missing or out of date.
+	int loadCache(unsigned lang_id);
+	int readCache(CacheReader &reader);
+	void saveCache(unsigned lang_id);
+
 public:
-	TextManager(unsigned lang_id);
+	// With packing set, text is loaded directly from game data files.
+	// The runtime cache is neither read nor written and no search index
+	// is built, used by the asset bundle packer.
+	TextManager(unsigned lang_id, int packing = 0);
 	~TextManager(void);
 
 	const char *antarmsg(unsigned str_id) const;
@@ -184,6 +217,7 @@ public:
 	const char *skillname(unsigned str_id) const;
 	const char *skilldesc(unsigned str_id) const;
 	const char *techdesc(unsigned asset_id, unsigned str_id) const;
+	unsigned techdescCount(unsigned asset_id) const;
 	const char *racename(unsigned str_id) const;
 	const char *shipname(unsigned str_id) const;
 	const char *homeworlds(unsigned str_id) const;
@@ -196,8 +230,19 @@ public:
 	const char *officerTitle(unsigned officer_id) const;
 	const char *diplomsg(unsigned asset_id, unsigned str_id) const;
 	const struct HelpText *help(unsigned id) const;
+	unsigned helpCount(void) const;
 	const struct HelpLink *helpIndex(unsigned section_id,
 		unsigned entry_id) const;
+	unsigned helpIndexCount(unsigned section_id) const;
+
+	// Full text search in help and ship tech descriptions. The search
+	// index is built in background after load and the first search may
+	// block until it's finished.
+	unsigned search(const char *query, TextSearchResult *results,
+		unsigned maxcount);
+
+	// Write all text in cache format, used by the asset bundle packer
+	void writeCache(CacheWriter &writer);
 };
 
 class AssetManager;
@@ -281,6 +326,8 @@ private:
 	struct FileCache {
 		char *filename;
 		size_t size;
+		uint64_t fileSize;
+		int64_t fileTime;
 		CacheEntry<Image> *images;
 		CacheEntry<Bitmap> *bitmaps;
 	};
@@ -288,17 +335,27 @@ private:
 	LBXArchive *_curfile;
 	FileCache *_cache;
 	size_t _cacheCount, _cacheSize;
+	CacheIndex *_imageCache;
+	AssetBundle *_bundle;
 
 protected:
 	FileCache *getCache(const char *filename);
 	void openArchive(FileCache *entry);
 	MemoryReadStream *rawData(FileCache *entry, unsigned id);
+
+	// Load image from the decoded image cache or decode it and save
+	// the result in the cache
+	Image *loadCachedImage(FileCache *entry, unsigned id,
+		const uint8_t **palettes, unsigned palcount);
+	Image *decodeImage(FileCache *entry, unsigned id,
+		const uint8_t **palettes, unsigned palcount,
+		CacheWriter *cache);
 	FileCache *cacheImage(const char *filename, unsigned id,
 		const uint8_t **palettes, unsigned palcount);
 	FileCache *cacheBitmap(const char *filename, unsigned id);
 
 public:
-	AssetManager(void);
+	explicit AssetManager(uint64_t imageCacheLimit = IMAGE_CACHE_LIMIT);
 	~AssetManager(void);
 
 	// Get asset from cache, loading it from disk if necessary. Reference
@@ -310,6 +367,15 @@ public:
 	BitmapAsset getBitmap(const char *filename, unsigned id);
 
 	MemoryReadStream *rawData(const char *filename, unsigned id);
+
+	// Load pre-decoded assets from bundle in data directory. Returns 0
+	// if the bundle is missing or out of date.
+	int openBundle(const char *filename);
+	const AssetBundle *bundle(void) const;
+
+	// Name of pre-decoded image in asset bundle
+	static void imageBundleName(StringBuffer &buf, const char *filename,
+		unsigned id, const uint8_t **palettes, unsigned palcount);
 };
 
 template <class C>
@@ -410,6 +476,8 @@ void AssetManager::CacheEntry<C>::release(void) {
 extern AssetManager *gameAssets;
 extern TextManager *gameLang;
 
-void selectLanguage(unsigned lang_id);
+// Load text and fonts for given language in parallel and make them active.
+// Load times will be stored in times if it's not NULL.
+void selectLanguage(unsigned lang_id, LanguageLoadTimes *times = NULL);
 
 #endif
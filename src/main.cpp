@@ -65,16 +65,23 @@ void engine_shutdown(void) {
 }
 
 int main(int argc, char **argv) {
+	unsigned start, screenTicks;
+	LanguageLoadTimes langTicks;
+
 	// Honor system locale
 	setlocale(LC_ALL, "");
 
 	try {
+		start = getTicks();
 		init_paths(argv[0]);
 		gameAssets = new AssetManager;
+		// The bundle is optional, assets will be decoded if it's missing
+		gameAssets->openBundle(ASSET_BUNDLE_FILE);
 		gui_stack = new ViewStack;
 		gameScreen = Screen::createScreen();
+		screenTicks = getTicks() - start;
 		// FIXME: Select language from game config
-		selectLanguage(LANG_ENGLISH);
+		selectLanguage(LANG_ENGLISH, &langTicks);
 	} catch(std::exception &e) {
 		fprintf(stderr, "Error: %s\n", e.what());
 		engine_shutdown();
@@ -103,6 +110,10 @@ int main(int argc, char **argv) {
 			prepare_main_menu();
 		}
 
+		fprintf(stderr, "Startup took %u ms (screen init: %u ms, "
+			"language data: %u ms, text: %u ms, fonts: %u ms)\n",
+			getTicks() - start, screenTicks, langTicks.total,
+			langTicks.text, langTicks.fonts);
 		main_loop();
 	} catch(std::exception &e) {
 		fprintf(stderr, "Error: %s\n", e.what());
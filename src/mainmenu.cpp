@@ -65,6 +65,7 @@ SaveGameInfo *findSavedGames(void) {
 	struct dirent *entry;
 	struct stat stbuf;
 	char *fname, *path = configPath(NULL);
+	uint8_t header[SAVE_GAME_CONFIG_SIZE];
 	SaveGameInfo *ret;
 	File fr;
 
@@ -106,13 +107,16 @@ SaveGameInfo *findSavedGames(void) {
 			continue;
 		}
 
-		try {
-			ret[slot].header.load(fr);
-		} catch (...) {
+		if (fr.read(header, SAVE_GAME_CONFIG_SIZE) !=
+			SAVE_GAME_CONFIG_SIZE) {
 			continue;
 		}
 
-		if (fr.eos()) {
+		try {
+			DataCursor data(header, SAVE_GAME_CONFIG_SIZE);
+
+			ret[slot].header.load(data);
+		} catch (...) {
 			continue;
 		}
 
@@ -26,6 +26,10 @@
 #include "gamestate.h"
 
 #define SAVEGAME_SLOTS 10
+// Continue loads the last slot. Save writes to the first slot until save
+// slot selection is implemented.
+#define SAVEGAME_QUICKSAVE_FILE "SAVE1.GAM"
+#define SAVEGAME_AUTOSAVE_FILE "SAVE10.GAM"
 
 class MainMenuView : public GuiView {
 private:
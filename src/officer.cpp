@@ -114,8 +114,8 @@ LeaderSkillsWidget::~LeaderSkillsWidget(void) {
 }
 
 void LeaderSkillsWidget::setLeader(int id) {
-	unsigned i, skillbase, skillcount;
-	const Leader *ptr;
+	unsigned i;
+	uint32_t skills;
 
 	if (id >= LEADER_COUNT) {
 		throw std::out_of_range("Invalid leader ID");
@@ -128,27 +128,18 @@ void LeaderSkillsWidget::setLeader(int id) {
 		return;
 	}
 
-	ptr = _game->_leaders + _leaderID;
+	skills = _game->leaderTable().skills[_leaderID];
 
-	if (ptr->type == LEADER_TYPE_CAPTAIN) {
-		skillbase = CAPTAIN_SKILLS_TYPE;
-		skillcount = MAX_CAPTAIN_SKILLS;
-	} else {
-		skillbase = ADMIN_SKILLS_TYPE;
-		skillcount = MAX_ADMIN_SKILLS;
-	}
-
-	for (i = 0; i < skillcount; i++) {
-		if (ptr->hasSkill(skillbase + i)) {
-			_skills[_skillCount++] = skillbase + i;
+	// Ship or colony skills first, common skills last
+	for (i = MAX_COMMON_SKILLS; i < MAX_SKILLS; i++) {
+		if (skills & ((uint32_t)1 << i)) {
+			_skills[_skillCount++] = Leader::skillID(i);
 		}
 	}
 
-	skillbase = COMMON_SKILLS_TYPE;
-
 	for (i = 0; i < MAX_COMMON_SKILLS; i++) {
-		if (ptr->hasSkill(skillbase + i)) {
-			_skills[_skillCount++] = skillbase + i;
+		if (skills & ((uint32_t)1 << i)) {
+			_skills[_skillCount++] = Leader::skillID(i);
 		}
 	}
 }
@@ -176,7 +167,7 @@ void LeaderSkillsWidget::handleMouseUp(int x, int y, unsigned button) {
 		skill = _skills[(y - minY) / rowHeight];
 		idx = ptr->skillNum(skill);
 		buf.printf(gameLang->skilldesc(idx), namebuf.c_str(),
-			abs(ptr->skillBonus(skill)));
+			abs(_game->leaderSkillBonus(_leaderID, skill)));
 		new MessageBoxWindow(_parent, gameLang->skillname(idx),
 			buf.c_str());
 		return;
@@ -186,9 +177,9 @@ void LeaderSkillsWidget::handleMouseUp(int x, int y, unsigned button) {
 }
 
 void LeaderSkillsWidget::redraw(int x, int y, unsigned curtick) {
-	unsigned i, idx, x2, level;
+	unsigned i, idx, x2;
+	int advanced;
 	Font *fnt;
-	const Leader *ptr;
 	const char *str;
 
 	if (_leaderID < 0) {
@@ -196,18 +187,19 @@ void LeaderSkillsWidget::redraw(int x, int y, unsigned curtick) {
 	}
 
 	StringBuffer buf;
+	const LeaderTable &table = _game->leaderTable();
 
-	ptr = _game->_leaders + _leaderID;
 	x += getX();
 	y += getY() + _drawOffset;
 	fnt = gameFonts->getFont(FONTSIZE_MEDIUM);
 
 	for (i = 0; i < _skillCount; i++) {
 		idx = _skills[i];
-		level = ptr->hasSkill(idx);
+		advanced = (table.advanced[_leaderID] >>
+			Leader::skillIndex(idx)) & 1;
 		str = skillFormatStrings[SKILLTYPE(idx)][idx & SKILLCODE_MASK];
-		buf.printf(str, ptr->skillBonus(idx));
-		str = Leader::skillName(idx, level > 1);
+		buf.printf(str, _game->leaderSkillBonus(_leaderID, idx));
+		str = Leader::skillName(idx, advanced);
 		idx = Leader::skillNum(idx);
 		_skillImg[idx]->draw(x + 2, y);
 		fnt->renderText(x + 24, y + 4, _fontColor, str, OUTLINE_FULL);
@@ -519,7 +511,7 @@ void LeaderListView::redraw(unsigned curtick) {
 			namelist[i].c_str(), OUTLINE_FULL);
 
 		if (ptr->status == LeaderState::ForHire) {
-			cost = ptr->hireCost(hire_modifier);
+			cost = _game->leaderHireCost(idlist[i], hire_modifier);
 			buf.printf("%u BC", cost);
 			str = gameLang->hstrings(HSTR_OFFICER_HIRE_COST);
 		} else {
@@ -867,7 +859,7 @@ void LeaderListView::selectSlot(int x, int y, int arg) {
 		int hire_modifier, hire_cost, money;
 
 		hire_modifier = _game->leaderHireModifier(_activePlayer);
-		hire_cost = ptr->hireCost(hire_modifier);
+		hire_cost = _game->leaderHireCost(idx, hire_modifier);
 		money = _game->_players[_activePlayer].BC;
 
 		if (hire_cost > 0 && money < hire_cost) {
@@ -1124,7 +1116,7 @@ HireLeaderWindow::HireLeaderWindow(GuiView *parent, GameState *game,
 
 	ptr = _game->_leaders + _leaderID;
 	hire_modifier = _game->leaderHireModifier(_activePlayer);
-	hire_cost = ptr->hireCost(hire_modifier);
+	hire_cost = _game->leaderHireCost(_leaderID, hire_modifier);
 	maint_cost = _game->leaderMaintenanceCost(_leaderID, hire_modifier);
 	money = _game->_players[_activePlayer].BC;
 
@@ -1234,6 +1226,6 @@ void HireLeaderWindow::showHelp(int x, int y, int arg) {
 
 	hire_modifier = _game->leaderHireModifier(_activePlayer);
 	buf.printf(gameLang->estrings(desc), ptr->rank(), ptr->name,
-		(int)ptr->hireCost(hire_modifier));
+		(int)_game->leaderHireCost(_leaderID, hire_modifier));
 	new MessageBoxWindow(_parent, gameLang->estrings(title), buf.c_str());
 }
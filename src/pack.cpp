@@ -0,0 +1,347 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// openorion2-pack: decode game assets into a single memory mapped bundle
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <dirent.h>
+#include "cache.h"
+#include "gfx.h"
+#include "lbx.h"
+#include "screen.h"
+#include "system.h"
+
+// Sanity limit for telling images apart from other assets
+#define PACK_MAX_FRAMES 256
+
+AssetManager *gameAssets = NULL;
+TextManager *gameLang = NULL;
+FontManager *gameFonts = NULL;
+Screen *gameScreen = NULL;
+
+struct PackStats {
+	unsigned archives, images, languages;
+	uint64_t size;
+};
+
+// Images get decoded without display, texture uploads are discarded
+class NullScreen : public Screen {
+private:
+	unsigned _textureCount;
+
+protected:
+	uint8_t *beginDraw(void);
+	void endDraw(void);
+
+public:
+	NullScreen(void);
+
+	void redraw(void);
+	void update(void);
+
+	unsigned registerTexture(unsigned width, unsigned height,
+		const uint32_t *data);
+	unsigned registerTexture(unsigned width, unsigned height,
+		const uint8_t *data, const uint8_t *palette,
+		unsigned firstcolor, unsigned colors);
+	void setTexturePalette(unsigned id, const uint8_t *palette,
+		unsigned firstcolor, unsigned colors);
+	void freeTexture(unsigned id);
+
+	void drawTexture(unsigned id, int x, int y);
+	void drawTextureTile(unsigned id, int x, int y, int offsx,
+		int offsy, unsigned width, unsigned height);
+	void fillRect(int x, int y, unsigned width, unsigned height,
+		uint8_t r = 0, uint8_t g = 0, uint8_t b = 0);
+};
+
+NullScreen::NullScreen(void) : Screen(SCREEN_WIDTH, SCREEN_HEIGHT),
+	_textureCount(0) {
+
+}
+
+uint8_t *NullScreen::beginDraw(void) {
+	throw std::logic_error("Cannot draw while packing assets");
+}
+
+void NullScreen::endDraw(void) {
+
+}
+
+void NullScreen::redraw(void) {
+
+}
+
+void NullScreen::update(void) {
+
+}
+
+unsigned NullScreen::registerTexture(unsigned width, unsigned height,
+	const uint32_t *data) {
+	return _textureCount++;
+}
+
+unsigned NullScreen::registerTexture(unsigned width, unsigned height,
+	const uint8_t *data, const uint8_t *palette, unsigned firstcolor,
+	unsigned colors) {
+	return _textureCount++;
+}
+
+void NullScreen::setTexturePalette(unsigned id, const uint8_t *palette,
+	unsigned firstcolor, unsigned colors) {
+
+}
+
+void NullScreen::freeTexture(unsigned id) {
+
+}
+
+void NullScreen::drawTexture(unsigned id, int x, int y) {
+
+}
+
+void NullScreen::drawTextureTile(unsigned id, int x, int y, int offsx,
+	int offsy, unsigned width, unsigned height) {
+
+}
+
+void NullScreen::fillRect(int x, int y, unsigned width, unsigned height,
+	uint8_t r, uint8_t g, uint8_t b) {
+
+}
+
+static int isImageAsset(MemoryReadStream &stream) {
+	unsigned width, height, frames;
+
+	if (stream.size() < 12) {
+		return 0;
+	}
+
+	width = stream.readUint16LE();
+	height = stream.readUint16LE();
+	stream.readUint16LE();
+	frames = stream.readUint16LE();
+	stream.seek(0, SEEK_SET);
+	return width && width <= SCREEN_WIDTH && height &&
+		height <= SCREEN_HEIGHT && frames && frames <= PACK_MAX_FRAMES;
+}
+
+// Pack all images which do not need external palette. Other images depend
+// on game state and will be decoded at runtime.
+static void packArchive(BundleWriter &bundle, const char *filename,
+	PackStats &stats) {
+
+	unsigned i;
+	int decoded;
+	const uint8_t *palette = NULL;
+	char *path;
+	LBXArchive *lbx = NULL;
+	MemoryReadStream *asset = NULL;
+	Image *img = NULL;
+	StringBuffer name;
+
+	path = dataPath(filename);
+
+	try {
+		lbx = new LBXArchive(path);
+	} catch (...) {
+		delete[] path;
+		throw;
+	}
+
+	delete[] path;
+
+	try {
+		for (i = 0; i < lbx->assetCount(); i++) {
+			CacheWriter writer;
+
+			decoded = 0;
+			asset = lbx->loadAsset(i);
+
+			try {
+				if (isImageAsset(*asset)) {
+					img = new Image(*asset, &palette, 1,
+						&writer);
+					decoded = 1;
+				}
+			} catch (std::exception &e) {
+				// Not an image after all
+			}
+
+			delete img;
+			delete asset;
+			img = NULL;
+			asset = NULL;
+
+			if (!decoded || writer.size() < IMAGE_CACHE_MIN_SIZE) {
+				continue;
+			}
+
+			AssetManager::imageBundleName(name, filename, i,
+				&palette, 1);
+			bundle.add(name.c_str(), writer);
+			stats.images++;
+			stats.size += writer.size();
+		}
+	} catch (...) {
+		delete asset;
+		delete lbx;
+		throw;
+	}
+
+	delete lbx;
+}
+
+static void packImages(BundleWriter &bundle, PackStats &stats) {
+	size_t length;
+	uint64_t size;
+	int64_t mtime;
+	int ret;
+	DIR *dptr;
+	struct dirent *entry;
+	char *path;
+
+	path = dataPath(NULL);
+	dptr = opendir(path);
+	delete[] path;
+
+	if (!dptr) {
+		throw std::runtime_error("Failed to open data directory");
+	}
+
+	try {
+		while ((entry = readdir(dptr))) {
+			length = strlen(entry->d_name);
+
+			if (length < 4 ||
+				strcasecmp(entry->d_name + length - 4, ".lbx")) {
+				continue;
+			}
+
+			path = dataPath(entry->d_name);
+			ret = fileInfo(path, &size, &mtime);
+			delete[] path;
+
+			if (!ret) {
+				continue;
+			}
+
+			bundle.addSource(entry->d_name, size);
+			stats.archives++;
+
+			try {
+				packArchive(bundle, entry->d_name, stats);
+			} catch (std::exception &e) {
+				fprintf(stderr, "Warning: skipping %s: %s\n",
+					entry->d_name, e.what());
+			}
+		}
+	} catch (...) {
+		closedir(dptr);
+		throw;
+	}
+
+	closedir(dptr);
+}
+
+static void packLanguage(BundleWriter &bundle, unsigned lang_id,
+	PackStats &stats) {
+
+	TextManager *text;
+	FontManager *fonts;
+	CacheWriter textData, fontData;
+	StringBuffer name;
+
+	text = new TextManager(lang_id, 1);
+
+	try {
+		text->writeCache(textData);
+	} catch (...) {
+		delete text;
+		throw;
+	}
+
+	delete text;
+	fonts = new FontManager(lang_id, 1);
+
+	try {
+		fonts->writeCache(fontData);
+	} catch (...) {
+		delete fonts;
+		throw;
+	}
+
+	delete fonts;
+	name.printf("text/%u", lang_id);
+	bundle.add(name.c_str(), textData);
+	name.printf("fonts/%u", lang_id);
+	bundle.add(name.c_str(), fontData);
+	stats.languages++;
+	stats.size += textData.size() + fontData.size();
+}
+
+int main(int argc, char **argv) {
+	unsigned i;
+	int ret = 0;
+	char *output = NULL;
+	BundleWriter *bundle = NULL;
+	PackStats stats = {0, 0, 0, 0};
+
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [output file]\n", argv[0]);
+		return 1;
+	}
+
+	try {
+		init_paths(argv[0]);
+		gameAssets = new AssetManager(0);
+		gameScreen = new NullScreen;
+		output = argc > 1 ? copystr(argv[1]) :
+			dataPath(ASSET_BUNDLE_FILE);
+		bundle = new BundleWriter(output);
+		packImages(*bundle, stats);
+
+		for (i = 0; i < LANG_COUNT; i++) {
+			try {
+				packLanguage(*bundle, i, stats);
+			} catch (std::exception &e) {
+				fprintf(stderr, "Warning: skipping language "
+					"%u: %s\n", i, e.what());
+			}
+		}
+
+		bundle->finish();
+		printf("Packed %u images from %u archives and %u languages "
+			"into %s (%llu bytes of asset data)\n", stats.images,
+			stats.archives, stats.languages, output,
+			(unsigned long long)stats.size);
+	} catch (std::exception &e) {
+		fprintf(stderr, "Error: %s\n", e.what());
+		ret = 1;
+	}
+
+	delete bundle;
+	delete[] output;
+	delete gameScreen;
+	delete gameAssets;
+	cleanup_paths();
+	return ret;
+}
@@ -0,0 +1,381 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cmath>
+#include <stdexcept>
+#include "route.h"
+
+// Rounding tolerance for travel time comparisons
+#define ROUTE_EPSILON 1e-9
+
+// Straight flight time between two galaxy positions in turns
+static double straightFlight(int x1, int y1, int x2, int y2, unsigned speed) {
+	double dx = x2 - x1, dy = y2 - y1;
+
+	return sqrt(dx * dx + dy * dy) / (speed * PARSEC_SIZE);
+}
+
+RouteTable::RouteTable(const GameState *game) : _game(game), _starCount(0),
+	_starVersion(0) {
+
+	unsigned i;
+
+	for (i = 0; i <= MAX_WARP_SPEED; i++) {
+		_tables[i] = NULL;
+	}
+
+	for (i = 0; i < MAX_STARS; i++) {
+		_wormholes[i] = -1;
+		_x[i] = _y[i] = 0;
+	}
+}
+
+RouteTable::~RouteTable(void) {
+	clear();
+}
+
+void RouteTable::clear(void) {
+	unsigned i;
+
+	for (i = 0; i <= MAX_WARP_SPEED; i++) {
+		delete _tables[i];
+		_tables[i] = NULL;
+	}
+}
+
+double RouteTable::flightTime(unsigned src, unsigned dest,
+	unsigned speed) const {
+
+	return straightFlight(_x[src], _y[src], _x[dest], _y[dest], speed);
+}
+
+void RouteTable::buildTable(SpeedTable *table, unsigned speed) {
+	unsigned i, j, k;
+	double tmp;
+
+	for (i = 0; i < _starCount; i++) {
+		for (j = 0; j < _starCount; j++) {
+			table->time[i][j] = flightTime(i, j, speed);
+			table->next[i][j] = j;
+		}
+	}
+
+	for (i = 0; i < _starCount; i++) {
+		j = _wormholes[i];
+
+		if (_wormholes[i] >= 0 &&
+			WORMHOLE_TRAVEL_TIME < table->time[i][j]) {
+			table->time[i][j] = WORMHOLE_TRAVEL_TIME;
+		}
+	}
+
+	// Flight legs obey triangle inequality, only wormhole jumps can make
+	// indirect routes faster
+	for (k = 0; k < _starCount; k++) {
+		for (i = 0; i < _starCount; i++) {
+			for (j = 0; j < _starCount; j++) {
+				tmp = table->time[i][k] + table->time[k][j];
+
+				if (tmp + ROUTE_EPSILON < table->time[i][j]) {
+					table->time[i][j] = tmp;
+					table->next[i][j] = table->next[i][k];
+				}
+			}
+		}
+	}
+}
+
+void RouteTable::addWormhole(SpeedTable *table, unsigned src, unsigned dest) {
+	unsigned i, j, ends[2] = {src, dest};
+	unsigned k, a, b;
+	double tmp;
+
+	// A single new edge is used at most once by any fastest route
+	for (i = 0; i < _starCount; i++) {
+		for (j = 0; j < _starCount; j++) {
+			for (k = 0; k < 2; k++) {
+				a = ends[k];
+				b = ends[1 - k];
+				tmp = table->time[i][a] + WORMHOLE_TRAVEL_TIME +
+					table->time[b][j];
+
+				if (tmp + ROUTE_EPSILON >= table->time[i][j]) {
+					continue;
+				}
+
+				table->time[i][j] = tmp;
+				table->next[i][j] = i == a ? b :
+					table->next[i][a];
+			}
+		}
+	}
+}
+
+void RouteTable::checkStars(void) {
+	unsigned i, j, added = 0;
+	int wormhole, addlist[MAX_STARS];
+	const Star *sptr;
+
+	// Star records change only on load in most turns
+	if (_starVersion == _game->version(GAMESTATE_STARS)) {
+		return;
+	}
+
+	_starVersion = _game->version(GAMESTATE_STARS);
+
+	for (i = 0, sptr = _game->_starSystems; i < _starCount; i++, sptr++) {
+		if (sptr->x != _x[i] || sptr->y != _y[i]) {
+			break;
+		}
+	}
+
+	if (_starCount != _game->_starSystemCount || i < _starCount) {
+		clear();
+		_starCount = _game->_starSystemCount;
+
+		for (i = 0, sptr = _game->_starSystems; i < _starCount;
+			i++, sptr++) {
+			_wormholes[i] = sptr->wormhole;
+			_x[i] = sptr->x;
+			_y[i] = sptr->y;
+		}
+
+		return;
+	}
+
+	for (i = 0; i < _starCount; i++) {
+		wormhole = _game->_starSystems[i].wormhole;
+
+		if (wormhole == _wormholes[i]) {
+			continue;
+		}
+
+		// Closed or redirected wormhole, routes must be rebuilt
+		if (_wormholes[i] >= 0) {
+			clear();
+
+			for (j = 0; j < _starCount; j++) {
+				_wormholes[j] = _game->_starSystems[j].wormhole;
+			}
+
+			return;
+		}
+
+		_wormholes[i] = wormhole;
+		addlist[added++] = i;
+	}
+
+	for (i = 0; i < added; i++) {
+		for (j = 1; j <= MAX_WARP_SPEED; j++) {
+			if (_tables[j]) {
+				addWormhole(_tables[j], addlist[i],
+					_wormholes[addlist[i]]);
+			}
+		}
+	}
+}
+
+const RouteTable::SpeedTable *RouteTable::getTable(unsigned speed) const {
+	const SpeedTable *ret;
+
+	if (!speed) {
+		throw std::invalid_argument("Fleet cannot move");
+	}
+
+	ret = _tables[MIN(speed, MAX_WARP_SPEED)];
+
+	if (!ret) {
+		throw std::logic_error("Route table was not prepared");
+	}
+
+	return ret;
+}
+
+void RouteTable::prepare(unsigned speed) {
+	if (!speed) {
+		throw std::invalid_argument("Fleet cannot move");
+	}
+
+	speed = MIN(speed, MAX_WARP_SPEED);
+	checkStars();
+
+	if (!_tables[speed]) {
+		_tables[speed] = new SpeedTable;
+		buildTable(_tables[speed], speed);
+	}
+}
+
+double RouteTable::travelTime(unsigned src, unsigned dest,
+	unsigned speed) const {
+
+	const SpeedTable *table = getTable(speed);
+
+	if (src >= _starCount || dest >= _starCount) {
+		throw std::out_of_range("Invalid star ID");
+	}
+
+	return table->time[src][dest];
+}
+
+unsigned RouteTable::eta(unsigned src, unsigned dest, unsigned speed) const {
+	return ceil(travelTime(src, dest, speed) - ROUTE_EPSILON);
+}
+
+double RouteTable::travelTime(int x, int y, unsigned dest,
+	unsigned speed) const {
+
+	unsigned i;
+	double ret, tmp;
+	const SpeedTable *table = getTable(speed);
+
+	if (dest >= _starCount) {
+		throw std::out_of_range("Invalid star ID");
+	}
+
+	speed = MIN(speed, MAX_WARP_SPEED);
+	ret = straightFlight(x, y, _x[dest], _y[dest], speed);
+
+	// Fly to the first star of the route, the table covers the rest
+	for (i = 0; i < _starCount; i++) {
+		tmp = straightFlight(x, y, _x[i], _y[i], speed) +
+			table->time[i][dest];
+		ret = MIN(ret, tmp);
+	}
+
+	return ret;
+}
+
+unsigned RouteTable::eta(int x, int y, unsigned dest, unsigned speed) const {
+	return ceil(travelTime(x, y, dest, speed) - ROUTE_EPSILON);
+}
+
+unsigned RouteTable::nextStop(unsigned src, unsigned dest,
+	unsigned speed) const {
+
+	const SpeedTable *table = getTable(speed);
+
+	if (src >= _starCount || dest >= _starCount) {
+		throw std::out_of_range("Invalid star ID");
+	}
+
+	return table->next[src][dest];
+}
+
+double RouteTable::findRoute(int x, int y, unsigned dest, unsigned speed,
+	unsigned *path, unsigned *length) const {
+
+	unsigned i, j, tmpid, count = _game->_starSystemCount, found = 0;
+	int cur, prev[MAX_STARS];
+	double tmp, best, toGate, fromGate = HUGE_VAL;
+	double cost[MAX_STARS], estimate[MAX_STARS];
+	uint8_t open[MAX_STARS];
+	const Star *stars = _game->_starSystems;
+
+	if (!speed) {
+		throw std::invalid_argument("Fleet cannot move");
+	}
+
+	if (dest >= count) {
+		throw std::out_of_range("Invalid star ID");
+	}
+
+	speed = MIN(speed, MAX_WARP_SPEED);
+
+	for (i = 0; i < count; i++) {
+		if (stars[i].wormhole >= 0) {
+			tmp = straightFlight(stars[i].x, stars[i].y,
+				stars[dest].x, stars[dest].y, speed);
+			fromGate = MIN(fromGate, tmp);
+		}
+	}
+
+	// Lower bound of remaining time: either fly straight or go through
+	// the nearest wormhole and fly from the wormhole nearest to target
+	for (i = 0; i < count; i++) {
+		toGate = HUGE_VAL;
+
+		for (j = 0; j < count && fromGate < HUGE_VAL; j++) {
+			if (stars[j].wormhole >= 0) {
+				tmp = straightFlight(stars[i].x, stars[i].y,
+					stars[j].x, stars[j].y, speed);
+				toGate = MIN(toGate, tmp);
+			}
+		}
+
+		tmp = straightFlight(stars[i].x, stars[i].y, stars[dest].x,
+			stars[dest].y, speed);
+		estimate[i] = MIN(tmp, toGate + WORMHOLE_TRAVEL_TIME + fromGate);
+		cost[i] = straightFlight(x, y, stars[i].x, stars[i].y, speed);
+		prev[i] = -1;
+		open[i] = 1;
+	}
+
+	while (!found) {
+		cur = -1;
+		best = HUGE_VAL;
+
+		for (i = 0; i < count; i++) {
+			if (open[i] && cost[i] + estimate[i] < best) {
+				best = cost[i] + estimate[i];
+				cur = i;
+			}
+		}
+
+		if (cur < 0) {
+			throw std::logic_error("Route search failed");
+		}
+
+		if ((unsigned)cur == dest) {
+			found = 1;
+			break;
+		}
+
+		open[cur] = 0;
+
+		for (i = 0; i < count; i++) {
+			tmp = cost[cur] + straightFlight(stars[cur].x,
+				stars[cur].y, stars[i].x, stars[i].y, speed);
+
+			if ((int)i == stars[cur].wormhole) {
+				tmp = MIN(tmp, cost[cur] + WORMHOLE_TRAVEL_TIME);
+			}
+
+			if (tmp + ROUTE_EPSILON < cost[i]) {
+				cost[i] = tmp;
+				prev[i] = cur;
+				open[i] = 1;
+			}
+		}
+	}
+
+	for (i = 0, cur = dest; cur >= 0; cur = prev[cur], i++) {
+		path[i] = cur;
+	}
+
+	*length = i;
+
+	// Reverse the route
+	for (i = 0, j = *length - 1; i < j; i++, j--) {
+		tmpid = path[i];
+		path[i] = path[j];
+		path[j] = tmpid;
+	}
+
+	return cost[dest];
+}
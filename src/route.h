@@ -0,0 +1,92 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ROUTE_H_
+#define ROUTE_H_
+
+#include "gamestate.h"
+
+#define MAX_WARP_SPEED 15
+// Wormhole jump takes one turn regardless of distance
+#define WORMHOLE_TRAVEL_TIME 1.0
+
+// Fastest travel times between all pairs of stars. Ships fly straight
+// between any two stars or jump through wormholes. Tables are built for
+// each warp speed on demand and updated when wormholes change.
+class RouteTable {
+private:
+	struct SpeedTable {
+		double time[MAX_STARS][MAX_STARS];
+		// First waypoint on the fastest route from star to star
+		uint8_t next[MAX_STARS][MAX_STARS];
+	};
+
+	const GameState *_game;
+	SpeedTable *_tables[MAX_WARP_SPEED + 1];
+	int _wormholes[MAX_STARS];
+	int _x[MAX_STARS], _y[MAX_STARS];
+	unsigned _starCount;
+	unsigned long _starVersion;
+
+	// Do NOT implement
+	RouteTable(const RouteTable &other);
+	const RouteTable &operator=(const RouteTable &other);
+
+protected:
+	double flightTime(unsigned src, unsigned dest, unsigned speed) const;
+	void buildTable(SpeedTable *table, unsigned speed);
+	void addWormhole(SpeedTable *table, unsigned src, unsigned dest);
+	const SpeedTable *getTable(unsigned speed) const;
+
+	// Check star data and update existing tables. New wormholes are
+	// added incrementally, anything else rebuilds the tables.
+	void checkStars(void);
+
+public:
+	explicit RouteTable(const GameState *game);
+	~RouteTable(void);
+
+	// Discard all tables, e.g. after loading a different game state
+	void clear(void);
+
+	// Build table for warp speed and bring existing tables up to date
+	// with star changes. Lookups below are read only and may run
+	// in parallel, call prepare() for each speed before using them.
+	void prepare(unsigned speed);
+
+	// Fastest travel time between stars in turns
+	double travelTime(unsigned src, unsigned dest, unsigned speed) const;
+	// Number of turns needed to reach the destination
+	unsigned eta(unsigned src, unsigned dest, unsigned speed) const;
+	// Fastest travel time and ETA from arbitrary galaxy position to star,
+	// e.g. for fleets in transit
+	double travelTime(int x, int y, unsigned dest, unsigned speed) const;
+	unsigned eta(int x, int y, unsigned dest, unsigned speed) const;
+	// First star on the fastest route, returns dest for direct flight
+	unsigned nextStop(unsigned src, unsigned dest, unsigned speed) const;
+
+	// Find fastest route from arbitrary galaxy position to star using
+	// A* search without building the full table. Star IDs of the route
+	// are stored into path (at most MAX_STARS items, destination is
+	// included) and their count into length. Returns travel time.
+	double findRoute(int x, int y, unsigned dest, unsigned speed,
+		unsigned *path, unsigned *length) const;
+};
+
+#endif
@@ -0,0 +1,341 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// savebench: measure savegame loading speed over a corpus of saves, check
+// that saving reproduces the original files byte for byte, compare
+// the colony economy kernel with production values stored in the saves
+// and time the combat estimator on fleets from the saves
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "gamestate.h"
+#include "economy.h"
+#include "combat.h"
+#include "lbx.h"
+#include "gfx.h"
+#include "screen.h"
+#include "system.h"
+
+#define DEFAULT_ITERATIONS 100
+#define COMBAT_SIMULATIONS 10000
+
+AssetManager *gameAssets = NULL;
+TextManager *gameLang = NULL;
+FontManager *gameFonts = NULL;
+Screen *gameScreen = NULL;
+
+// Returns total time in milliseconds
+static unsigned benchFile(const char *filename, unsigned iterations) {
+	unsigned i, start;
+	GameState *game = NULL;
+
+	start = getTicks();
+
+	try {
+		for (i = 0; i < iterations; i++) {
+			game = new GameState;
+			game->load(filename);
+			delete game;
+			game = NULL;
+		}
+	} catch (...) {
+		delete game;
+		throw;
+	}
+
+	return getTicks() - start;
+}
+
+// Load savegame, encode it again and compare with the original data
+static void checkFile(const char *filename) {
+	const uint8_t *data;
+	uint8_t *out = NULL;
+	size_t i, size, outsize;
+	GameState *game = NULL;
+
+	data = (const uint8_t*)mapFile(filename, &size);
+
+	if (!data) {
+		throw std::runtime_error("Cannot open savegame file");
+	}
+
+	try {
+		game = new GameState;
+		game->load(data, size);
+		out = game->saveData(&outsize);
+	} catch (...) {
+		delete game;
+		unmapFile(data, size);
+		throw;
+	}
+
+	delete game;
+
+	for (i = 0; i < size && i < outsize && data[i] == out[i]; i++);
+
+	unmapFile(data, size);
+	delete[] out;
+
+	if (i < size || i < outsize) {
+		StringBuffer buf;
+
+		buf.printf("Saved data differs at offset 0x%lx", (unsigned long)i);
+		throw std::runtime_error(buf.c_str());
+	}
+}
+
+// Evaluate colony economy and compare it with saved values. Average time
+// of sequential and parallel evaluation is stored in microseconds.
+static void checkEconomy(const char *filename, unsigned iterations,
+	EconomyMismatch *result, double *seqtime, double *partime) {
+
+	unsigned i, start;
+	GameState *game = NULL;
+	EconomyEvaluator *eval = NULL;
+
+	try {
+		game = new GameState;
+		game->load(filename);
+		eval = new EconomyEvaluator(game);
+
+		// Keep the pool alive between passes like turn processing
+		WorkerPool pool;
+
+		start = getTicks();
+
+		for (i = 0; i < iterations; i++) {
+			eval->evaluate();
+		}
+
+		*seqtime = (getTicks() - start) * 1000.0 / iterations;
+		start = getTicks();
+
+		for (i = 0; i < iterations; i++) {
+			eval->evaluate(&pool);
+		}
+
+		*partime = (getTicks() - start) * 1000.0 / iterations;
+		eval->verify(result);
+	} catch (...) {
+		delete eval;
+		delete game;
+		throw;
+	}
+
+	delete eval;
+	delete game;
+}
+
+// Returns the fleet with the most combat ships, ignoring fleets of the
+// given owner
+static const Fleet *strongestFleet(const GameState *game, unsigned ignore) {
+	unsigned i;
+	const BilistNode<Fleet> *node;
+	const Fleet *ret = NULL;
+
+	for (i = 0; i <= game->_starSystemCount; i++) {
+		node = i < game->_starSystemCount ?
+			game->_starSystems[i].getOrbitingFleets() :
+			game->getMovingFleets();
+
+		for (; node; node = node->next()) {
+			if (!node->data || node->data->getOwner() == ignore ||
+				!node->data->combatCount()) {
+				continue;
+			}
+
+			if (!ret || node->data->combatCount() >
+				ret->combatCount()) {
+				ret = node->data;
+			}
+		}
+	}
+
+	return ret;
+}
+
+// Estimate a battle between the two strongest fleets of different owners.
+// Sequential and parallel run times are stored in milliseconds.
+static void checkCombat(const char *filename, CombatOdds *result,
+	double *seqtime, double *partime) {
+
+	unsigned start;
+	const Fleet *attacker, *defender;
+	GameState *game = NULL;
+	CombatSimulator *sim = NULL;
+
+	try {
+		game = new GameState;
+		game->load(filename);
+		defender = strongestFleet(game, MAX_FLEET_OWNERS);
+		attacker = defender ?
+			strongestFleet(game, defender->getOwner()) : NULL;
+
+		if (!attacker) {
+			throw std::runtime_error("No pair of hostile fleets");
+		}
+
+		sim = new CombatSimulator(game);
+		sim->addFleet(COMBAT_ATTACKER, attacker);
+		sim->addFleet(COMBAT_DEFENDER, defender);
+
+		// Keep the pool alive between estimates like turn processing
+		WorkerPool pool;
+
+		start = getTicks();
+		sim->estimate(COMBAT_SIMULATIONS, 1, result);
+		*seqtime = getTicks() - start;
+		start = getTicks();
+		sim->estimate(COMBAT_SIMULATIONS, 1, result, &pool);
+		*partime = getTicks() - start;
+	} catch (...) {
+		delete sim;
+		delete game;
+		throw;
+	}
+
+	delete sim;
+	delete game;
+}
+
+int main(int argc, char **argv) {
+	int i = 1, ret = 0, check = 0, economy = 0, combat = 0;
+	double seqtime, partime;
+	EconomyMismatch diff;
+	CombatOdds odds;
+	unsigned files = 0, iterations = DEFAULT_ITERATIONS, ticks, total = 0;
+	uint64_t size, bytes = 0;
+	int64_t mtime;
+
+	if (argc > 1 && !strcmp(argv[1], "-c")) {
+		check = 1;
+		i = 2;
+	} else if (argc > 1 && !strcmp(argv[1], "-e")) {
+		economy = 1;
+		i = 2;
+	} else if (argc > 1 && !strcmp(argv[1], "-s")) {
+		combat = 1;
+		i = 2;
+	} else if (argc > 2 && !strcmp(argv[1], "-n")) {
+		iterations = strtoul(argv[2], NULL, 10);
+		i = 3;
+	}
+
+	if (i >= argc || !iterations) {
+		fprintf(stderr, "Usage: %s [-n iterations] savegame...\n"
+			"       %s -c savegame...\n"
+			"       %s -e savegame...\n"
+			"       %s -s savegame...\n", argv[0], argv[0],
+			argv[0], argv[0]);
+		return 1;
+	}
+
+	for (; i < argc; i++) {
+		if (!fileInfo(argv[i], &size, &mtime)) {
+			fprintf(stderr, "%s: cannot access file\n", argv[i]);
+			ret = 1;
+			continue;
+		}
+
+		if (check) {
+			try {
+				checkFile(argv[i]);
+				printf("%s: OK\n", argv[i]);
+			} catch (std::exception &e) {
+				fprintf(stderr, "%s: %s\n", argv[i], e.what());
+				ret = 1;
+			}
+
+			continue;
+		}
+
+		if (combat) {
+			try {
+				checkCombat(argv[i], &odds, &seqtime,
+					&partime);
+			} catch (std::exception &e) {
+				fprintf(stderr, "%s: %s\n", argv[i], e.what());
+				ret = 1;
+				continue;
+			}
+
+			printf("%s: %u battles, %.0f ms sequential, %.0f ms "
+				"parallel\n", argv[i], odds.simulations,
+				seqtime, partime);
+			printf("  attacker wins %.3f, defender wins %.3f, "
+				"draws %.3f\n", odds.attackerWins,
+				odds.defenderWins, odds.draws);
+			continue;
+		}
+
+		if (economy) {
+			try {
+				checkEconomy(argv[i], iterations * 100, &diff,
+					&seqtime, &partime);
+			} catch (std::exception &e) {
+				fprintf(stderr, "%s: %s\n", argv[i], e.what());
+				ret = 1;
+				continue;
+			}
+
+			printf("%s: %.2f us sequential, %.2f us parallel, "
+				"%u colonies, %u players\n", argv[i], seqtime,
+				partime, diff.colonies, diff.players);
+			printf("  colony mismatches: food %u, industry %u, "
+				"research %u\n", diff.food, diff.industry,
+				diff.research);
+			printf("  player mismatches: food %u, industry %u, "
+				"research %u\n", diff.playerFood,
+				diff.playerIndustry, diff.playerResearch);
+
+			if (diff.food || diff.industry || diff.research ||
+				diff.playerFood || diff.playerIndustry ||
+				diff.playerResearch) {
+				ret = 1;
+			}
+
+			continue;
+		}
+
+		try {
+			ticks = benchFile(argv[i], iterations);
+		} catch (std::exception &e) {
+			fprintf(stderr, "%s: %s\n", argv[i], e.what());
+			ret = 1;
+			continue;
+		}
+
+		printf("%s: %.3f ms per load\n", argv[i],
+			double(ticks) / iterations);
+		files++;
+		total += ticks;
+		bytes += size * iterations;
+	}
+
+	if (files) {
+		printf("Loaded %u savegames %u times: %.3f ms per load, "
+			"%.1f MB/s\n", files, iterations,
+			double(total) / (files * iterations),
+			total ? bytes / (total * 1000.0) : 0.0);
+	}
+
+	return ret;
+}
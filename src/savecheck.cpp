@@ -0,0 +1,164 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// savecheck: encode a game state built from sample records, load it back
+// and check that encoding the loaded state reproduces the same file. Run
+// by "make check", no data files are needed.
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include "gamestate.h"
+#include "lbx.h"
+#include "gfx.h"
+#include "screen.h"
+
+// GameConfig::load() accepts only this version
+#define SAVE_GAME_VERSION 0xe0
+#define SAMPLE_PLAYERS 2
+#define SAMPLE_STARS 3
+#define SAMPLE_SHIPS 12
+
+AssetManager *gameAssets = NULL;
+TextManager *gameLang = NULL;
+FontManager *gameFonts = NULL;
+Screen *gameScreen = NULL;
+
+static void fillSampleGame(GameState *game) {
+	unsigned i, j;
+	Star *sptr;
+	Ship *ship;
+
+	game->_gameConfig.version = SAVE_GAME_VERSION;
+	strcpy(game->_gameConfig.saveGameName, "Round trip");
+	game->_gameConfig.stardate = 35123;
+	game->_galaxy.sizeFactor = 15;
+	game->_galaxy.width = 760;
+	game->_galaxy.height = 540;
+	game->_playerCount = SAMPLE_PLAYERS;
+
+	for (i = 0; i < SAMPLE_PLAYERS; i++) {
+		sprintf(game->_players[i].name, "Player %u", i);
+		game->_players[i].color = i;
+		game->_players[i].picture = i;
+		game->_players[i].bcProduced = 100 + i;
+
+		for (j = 0; j < MAX_PLAYER_BLUEPRINTS; j++) {
+			game->_players[i].blueprints[j].builder = i;
+		}
+	}
+
+	game->_starSystemCount = SAMPLE_STARS;
+
+	for (i = 0; i < SAMPLE_STARS; i++) {
+		sptr = game->_starSystems + i;
+		sprintf(sptr->name, "Star %u", i);
+		sptr->x = 100 + 200 * i;
+		sptr->y = 50 + 150 * i;
+		sptr->savedOwner = (int)i < SAMPLE_PLAYERS ? i : -1;
+		sptr->owner = sptr->savedOwner;
+		sptr->wormhole = -1;
+
+		for (j = 0; j < MAX_ORBITS; j++) {
+			sptr->planetIndex[j] = -1;
+		}
+	}
+
+	// Star owners may differ from what the active player sees
+	game->_starSystems[1].owner = -1;
+
+	for (i = 0; i < 2; i++) {
+		sprintf(game->_leaders[i].name, "Leader %u", i);
+		game->_leaders[i].picture = i;
+		game->_leaders[i].experience = 10 * i;
+		game->_leaders[i].playerIndex = i;
+	}
+
+	game->_shipCount = SAMPLE_SHIPS;
+
+	for (i = 0; i < SAMPLE_SHIPS; i++) {
+		ship = game->_ships + i;
+		ship->owner = i % SAMPLE_PLAYERS;
+		ship->status = InOrbit;
+		ship->star = i % SAMPLE_STARS;
+		ship->x = game->_starSystems[ship->star].x;
+		ship->y = game->_starSystems[ship->star].y;
+		ship->officer = -1;
+		ship->design.builder = ship->owner;
+		ship->design.type = COMBAT_SHIP;
+		ship->design.size = i % 4;
+		ship->design.weapons[0].type = 1 + i % 5;
+		ship->design.weapons[0].arc = 1;
+		ship->design.weapons[0].maxCount = 1 + i % 3;
+		ship->design.weapons[0].workingCount = 1 + i % 3;
+	}
+}
+
+// Returns offset of the first differing byte, or the common size if both
+// buffers are equal
+static size_t compareData(const uint8_t *a, size_t asize, const uint8_t *b,
+	size_t bsize) {
+
+	size_t i;
+
+	for (i = 0; i < asize && i < bsize && a[i] == b[i]; i++);
+
+	return i;
+}
+
+static int checkRoundTrip(void) {
+	uint8_t *first = NULL, *second = NULL;
+	size_t size, outsize, pos;
+	GameState *game = NULL, *copy = NULL;
+
+	try {
+		game = new GameState;
+		fillSampleGame(game);
+		game->validate();
+		first = game->saveData(&size);
+		copy = new GameState;
+		copy->load(first, size);
+		second = copy->saveData(&outsize);
+	} catch (std::exception &e) {
+		fprintf(stderr, "Round trip failed: %s\n", e.what());
+		delete[] first;
+		delete copy;
+		delete game;
+		return 1;
+	}
+
+	pos = compareData(first, size, second, outsize);
+	delete[] first;
+	delete[] second;
+	delete copy;
+	delete game;
+
+	if (pos < size || pos < outsize) {
+		fprintf(stderr, "Saved data differs at offset 0x%lx\n",
+			(unsigned long)pos);
+		return 1;
+	}
+
+	printf("Savegame round trip: OK\n");
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	return checkRoundTrip();
+}
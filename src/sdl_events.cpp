@@ -52,6 +52,29 @@ unsigned convertButton(unsigned sdlButton) {
 	}
 }
 
+unsigned convertKey(SDL_Keycode sdlKey) {
+	switch (sdlKey) {
+	case SDLK_BACKSPACE:
+		return KEY_BACKSPACE;
+
+	case SDLK_RETURN:
+	case SDLK_KP_ENTER:
+		return KEY_ENTER;
+
+	case SDLK_ESCAPE:
+		return KEY_ESCAPE;
+
+	case SDLK_UP:
+		return KEY_UP;
+
+	case SDLK_DOWN:
+		return KEY_DOWN;
+
+	default:
+		return KEY_OTHER;
+	}
+}
+
 void main_loop(void) {
 	SDL_Event ev;
 	GuiView *view, *prev_view = NULL;
@@ -110,6 +133,14 @@ void main_loop(void) {
 					convertButton(ev.button.button));
 				break;
 
+			case SDL_KEYDOWN:
+				view->handleKeyDown(convertKey(ev.key.keysym.sym));
+				break;
+
+			case SDL_TEXTINPUT:
+				view->handleTextInput(ev.text.text);
+				break;
+
 			case SDL_WINDOWEVENT:
 				switch (ev.window.event) {
 				case SDL_WINDOWEVENT_EXPOSED:
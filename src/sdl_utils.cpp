@@ -18,6 +18,9 @@
  */
 
 #include <SDL_mutex.h>
+#include <SDL_thread.h>
+#include <SDL_timer.h>
+#include <SDL_cpuinfo.h>
 #include <stdexcept>
 #include "utils.h"
 
@@ -60,3 +63,124 @@ int Mutex::try_lock(void) {
 
 	return !ret;
 }
+
+struct ConditionImpl {
+	SDL_cond *cond;
+};
+
+Condition::Condition(void) : _cond(new ConditionImpl) {
+	_cond->cond = SDL_CreateCond();
+
+	if (!_cond->cond) {
+		delete _cond;
+		throw std::runtime_error("Could not initialize condition");
+	}
+}
+
+Condition::~Condition(void) {
+	SDL_DestroyCond(_cond->cond);
+	delete _cond;
+}
+
+void Condition::wait(Mutex &m) {
+	if (SDL_CondWait(_cond->cond, m._mutex->mutex)) {
+		throw std::runtime_error("Failed to wait for condition");
+	}
+}
+
+void Condition::signal(void) {
+	if (SDL_CondSignal(_cond->cond)) {
+		throw std::runtime_error("Failed to signal condition");
+	}
+}
+
+void Condition::broadcast(void) {
+	if (SDL_CondBroadcast(_cond->cond)) {
+		throw std::runtime_error("Failed to broadcast condition");
+	}
+}
+
+struct ThreadImpl {
+	SDL_Thread *thread;
+};
+
+Thread::Thread(void) : _thread(new ThreadImpl), _error(NULL) {
+	_thread->thread = NULL;
+}
+
+Thread::~Thread(void) {
+	try {
+		join();
+	} catch (...) {
+		// Nobody is waiting for the result anymore
+	}
+
+	delete _thread;
+}
+
+int Thread::threadMain(void *arg) {
+	Thread *self = (Thread*)arg;
+
+	try {
+		self->run();
+	} catch (std::exception &e) {
+		self->_error = copystr(e.what());
+	} catch (...) {
+		self->_error = copystr("Unknown error in background thread");
+	}
+
+	return 0;
+}
+
+void Thread::start(void) {
+	if (_thread->thread) {
+		throw std::logic_error("Thread is already running");
+	}
+
+	delete[] _error;
+	_error = NULL;
+	_thread->thread = SDL_CreateThread(threadMain, "worker", this);
+
+	if (!_thread->thread) {
+		throw std::runtime_error("Could not start thread");
+	}
+}
+
+void Thread::join(void) {
+	char *err;
+
+	if (!_thread->thread) {
+		return;
+	}
+
+	SDL_WaitThread(_thread->thread, NULL);
+	_thread->thread = NULL;
+
+	if (!_error) {
+		return;
+	}
+
+	err = _error;
+	_error = NULL;
+
+	try {
+		throw std::runtime_error(err);
+	} catch (...) {
+		delete[] err;
+		throw;
+	}
+}
+
+int Thread::isRunning(void) const {
+	return _thread->thread != NULL;
+}
+
+unsigned cpuCount(void) {
+	int ret = SDL_GetCPUCount();
+
+	return ret > 0 ? ret : 1;
+}
+
+unsigned getTicks(void) {
+	return SDL_GetTicks();
+}
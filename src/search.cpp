@@ -0,0 +1,495 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include "lbx.h"
+#include "search.h"
+
+#define SEARCH_WORD_MAXLEN 31
+#define SEARCH_MIN_WORD 2
+
+#define SEARCH_WEIGHT_TITLE 8
+#define SEARCH_WEIGHT_INDEX 4
+#define SEARCH_WEIGHT_TEXT 1
+
+struct RawPosting {
+	const char *word;
+	size_t offset;
+	unsigned doc, weight;
+};
+
+// Temporary word list used only while building the index
+class IndexBuilder {
+private:
+	char *_pool;
+	size_t _poolUsed, _poolSize;
+
+	// Do NOT implement
+	IndexBuilder(const IndexBuilder &other);
+	const IndexBuilder &operator=(const IndexBuilder &other);
+
+protected:
+	void addWord(const char *word, size_t len, unsigned doc,
+		unsigned weight);
+
+public:
+	RawPosting *postings;
+	size_t count, size;
+
+	IndexBuilder(void);
+	~IndexBuilder(void);
+
+	void addText(const char *text, unsigned doc, unsigned weight);
+
+	// Resolve word pointers and sort postings by word and document
+	void sort(void);
+};
+
+static int isWordChar(unsigned char c) {
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+		(c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+// Copy the next case-folded word from str into buf (which must have room
+// for SEARCH_WORD_MAXLEN + 1 chars). Returns pointer to the end of the word
+// in str or NULL if there are no more words. Long words get truncated.
+static const char *nextWord(const char *str, char *buf, size_t *len) {
+	size_t i = 0;
+	unsigned char c;
+
+	for (; *str && !isWordChar(*str); str++);
+
+	if (!*str) {
+		return NULL;
+	}
+
+	for (; isWordChar(*str); str++) {
+		c = *str;
+
+		if (i >= SEARCH_WORD_MAXLEN) {
+			continue;
+		}
+
+		buf[i++] = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+	}
+
+	buf[i] = '\0';
+	*len = i;
+	return str;
+}
+
+static int cmp_posting(const void *a, const void *b) {
+	const RawPosting *pa = (const RawPosting*)a;
+	const RawPosting *pb = (const RawPosting*)b;
+	int ret = strcmp(pa->word, pb->word);
+
+	if (ret) {
+		return ret;
+	}
+
+	return pa->doc < pb->doc ? -1 : (pa->doc > pb->doc ? 1 : 0);
+}
+
+static int cmp_result(const void *a, const void *b) {
+	const TextSearchResult *ra = (const TextSearchResult*)a;
+	const TextSearchResult *rb = (const TextSearchResult*)b;
+
+	if (ra->score != rb->score) {
+		return ra->score > rb->score ? -1 : 1;
+	}
+
+	if (ra->type != rb->type) {
+		return ra->type < rb->type ? -1 : 1;
+	}
+
+	return ra->id < rb->id ? -1 : (ra->id > rb->id ? 1 : 0);
+}
+
+IndexBuilder::IndexBuilder(void) : _pool(NULL), _poolUsed(0),
+	_poolSize(64 * 1024), postings(NULL), count(0), size(4096) {
+
+	_pool = new char[_poolSize];
+
+	try {
+		postings = new RawPosting[size];
+	} catch (...) {
+		delete[] _pool;
+		throw;
+	}
+}
+
+IndexBuilder::~IndexBuilder(void) {
+	delete[] _pool;
+	delete[] postings;
+}
+
+void IndexBuilder::addWord(const char *word, size_t len, unsigned doc,
+	unsigned weight) {
+
+	if (_poolUsed + len + 1 > _poolSize) {
+		size_t newsize = 2 * _poolSize;
+		char *ptr = new char[newsize];
+
+		memcpy(ptr, _pool, _poolUsed);
+		delete[] _pool;
+		_pool = ptr;
+		_poolSize = newsize;
+	}
+
+	if (count >= size) {
+		size_t newsize = 2 * size;
+		RawPosting *ptr = new RawPosting[newsize];
+
+		memcpy(ptr, postings, count * sizeof(RawPosting));
+		delete[] postings;
+		postings = ptr;
+		size = newsize;
+	}
+
+	memcpy(_pool + _poolUsed, word, len + 1);
+	postings[count].word = NULL;
+	postings[count].offset = _poolUsed;
+	postings[count].doc = doc;
+	postings[count].weight = weight;
+	_poolUsed += len + 1;
+	count++;
+}
+
+void IndexBuilder::addText(const char *text, unsigned doc, unsigned weight) {
+	char buf[SEARCH_WORD_MAXLEN + 1];
+	size_t len;
+
+	if (!text) {
+		return;
+	}
+
+	while ((text = nextWord(text, buf, &len))) {
+		if (len >= SEARCH_MIN_WORD) {
+			addWord(buf, len, doc, weight);
+		}
+	}
+}
+
+void IndexBuilder::sort(void) {
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		postings[i].word = _pool + postings[i].offset;
+	}
+
+	qsort(postings, count, sizeof(RawPosting), cmp_posting);
+}
+
+TextSearchIndex::TextSearchIndex(const TextManager *lang) : _lang(lang),
+	_docs(NULL), _terms(NULL), _postings(NULL), _wordPool(NULL),
+	_docCount(0), _termCount(0), _postingCount(0), _ready(0) {
+
+}
+
+TextSearchIndex::~TextSearchIndex(void) {
+	try {
+		join();
+	} catch (...) {
+		// build errors don't matter anymore
+	}
+
+	clear();
+}
+
+void TextSearchIndex::clear(void) {
+	delete[] _docs;
+	delete[] _terms;
+	delete[] _postings;
+	delete[] _wordPool;
+	_docs = NULL;
+	_terms = NULL;
+	_postings = NULL;
+	_wordPool = NULL;
+	_docCount = _termCount = _postingCount = 0;
+	_ready = 0;
+}
+
+void TextSearchIndex::run(void) {
+	unsigned i, j, k, id, helpCount, specialCount, weaponCount;
+	unsigned *head = NULL;
+	uint8_t *cont = NULL;
+	size_t poolSize;
+	const HelpText *entry;
+	const HelpLink *link;
+	char *ptr;
+	IndexBuilder builder;
+
+	helpCount = _lang->helpCount();
+	specialCount = MIN(_lang->techdescCount(TXT_TECH_SPECIAL_NAME),
+		_lang->techdescCount(TXT_TECH_SPECIAL_DESC));
+	weaponCount = MIN(_lang->techdescCount(TXT_TECH_WEAPON_NAME),
+		_lang->techdescCount(TXT_TECH_WEAPON_DESC));
+
+	try {
+		_docCount = helpCount + specialCount + weaponCount;
+		_docs = new SearchDocument[_docCount];
+
+		// Help entries continued in another paragraph are shown
+		// together, index the whole chain under its first entry
+		head = new unsigned[helpCount];
+		cont = new uint8_t[helpCount];
+		memset(cont, 0, helpCount * sizeof(uint8_t));
+
+		for (i = 0; i < helpCount; i++) {
+			id = _lang->help(i)->nextParagraph;
+			head[i] = i;
+			_docs[i].type = SEARCH_DOC_HELP;
+			_docs[i].id = i;
+
+			if (id && id < helpCount && id != i) {
+				cont[id] = 1;
+			}
+		}
+
+		for (i = 0; i < helpCount; i++) {
+			if (cont[i]) {
+				continue;
+			}
+
+			id = _lang->help(i)->nextParagraph;
+
+			// Stop on already visited entries in case of loops
+			while (id < helpCount && cont[id] && head[id] == id) {
+				head[id] = i;
+				id = _lang->help(id)->nextParagraph;
+			}
+		}
+
+		for (i = 0; i < helpCount; i++) {
+			entry = _lang->help(i);
+
+			if (entry->title[0] != 0x14) {
+				builder.addText(entry->title, head[i],
+					SEARCH_WEIGHT_TITLE);
+			}
+
+			builder.addText(entry->text, head[i],
+				SEARCH_WEIGHT_TEXT);
+		}
+
+		for (i = 0; i < TXT_HELPSECTION_COUNT; i++) {
+			k = _lang->helpIndexCount(i);
+
+			for (j = 0; j < k; j++) {
+				link = _lang->helpIndex(i, j);
+
+				if (link->id >= helpCount) {
+					continue;
+				}
+
+				builder.addText(link->title, head[link->id],
+					SEARCH_WEIGHT_INDEX);
+			}
+		}
+
+		delete[] head;
+		delete[] cont;
+		head = NULL;
+		cont = NULL;
+
+		for (i = 0, k = helpCount; i < specialCount; i++, k++) {
+			_docs[k].type = SEARCH_DOC_SPECIAL_TECH;
+			_docs[k].id = i;
+			builder.addText(_lang->techdesc(TXT_TECH_SPECIAL_NAME,
+				i), k, SEARCH_WEIGHT_TITLE);
+			builder.addText(_lang->techdesc(TXT_TECH_SPECIAL_DESC,
+				i), k, SEARCH_WEIGHT_TEXT);
+		}
+
+		for (i = 0; i < weaponCount; i++, k++) {
+			_docs[k].type = SEARCH_DOC_WEAPON_TECH;
+			_docs[k].id = i;
+			builder.addText(_lang->techdesc(TXT_TECH_WEAPON_NAME,
+				i), k, SEARCH_WEIGHT_TITLE);
+			builder.addText(_lang->techdesc(TXT_TECH_WEAPON_DESC,
+				i), k, SEARCH_WEIGHT_TEXT);
+		}
+
+		builder.sort();
+
+		// Count unique terms and (term, document) pairs
+		for (i = 0, poolSize = 0; i < builder.count; i++) {
+			if (!i || strcmp(builder.postings[i - 1].word,
+				builder.postings[i].word)) {
+				_termCount++;
+				_postingCount++;
+				poolSize += strlen(builder.postings[i].word) + 1;
+			} else if (builder.postings[i - 1].doc !=
+				builder.postings[i].doc) {
+				_postingCount++;
+			}
+		}
+
+		_terms = new SearchTerm[_termCount];
+		_postings = new SearchPosting[_postingCount];
+		_wordPool = new char[poolSize];
+		ptr = _wordPool;
+
+		for (i = 0, j = 0, k = 0; i < builder.count; i++) {
+			const RawPosting *raw = builder.postings + i;
+
+			if (!i || strcmp(builder.postings[i - 1].word,
+				raw->word)) {
+				strcpy(ptr, raw->word);
+				_terms[j].word = ptr;
+				_terms[j].start = k;
+				_terms[j].count = 0;
+				ptr += strlen(ptr) + 1;
+				j++;
+			} else if (builder.postings[i - 1].doc == raw->doc) {
+				_postings[k - 1].weight += raw->weight;
+				continue;
+			}
+
+			_postings[k].doc = raw->doc;
+			_postings[k].weight = raw->weight;
+			_terms[j - 1].count++;
+			k++;
+		}
+	} catch (...) {
+		delete[] head;
+		delete[] cont;
+		clear();
+		throw;
+	}
+
+	_ready = 1;
+}
+
+unsigned TextSearchIndex::findTerm(const char *prefix) const {
+	unsigned i = 0, j = _termCount, tmp;
+
+	while (i < j) {
+		tmp = (i + j) / 2;
+
+		if (strcmp(_terms[tmp].word, prefix) < 0) {
+			i = tmp + 1;
+		} else {
+			j = tmp;
+		}
+	}
+
+	return i;
+}
+
+void TextSearchIndex::build(void) {
+	join();
+	clear();
+	start();
+}
+
+unsigned TextSearchIndex::search(const char *query, TextSearchResult *results,
+	unsigned maxcount) {
+
+	char word[SEARCH_WORD_MAXLEN + 1];
+	size_t len;
+	unsigned i, j, doc, words = 0, found = 0;
+	unsigned *scores = NULL, *matches = NULL;
+	TextSearchResult *candidates = NULL;
+	const SearchTerm *term;
+
+	join();
+
+	if (!_ready) {
+		throw std::runtime_error("Search index is not available");
+	}
+
+	if (!maxcount || !_docCount) {
+		return 0;
+	}
+
+	try {
+		scores = new unsigned[_docCount];
+		matches = new unsigned[_docCount];
+		memset(scores, 0, _docCount * sizeof(unsigned));
+		memset(matches, 0, _docCount * sizeof(unsigned));
+
+		// matches[doc] is the number of query words found so far,
+		// documents which missed any previous word are skipped
+		while ((query = nextWord(query, word, &len))) {
+			i = findTerm(word);
+
+			for (; i < _termCount; i++) {
+				term = _terms + i;
+
+				if (strncmp(term->word, word, len)) {
+					break;
+				}
+
+				for (j = 0; j < term->count; j++) {
+					doc = _postings[term->start + j].doc;
+
+					if (matches[doc] < words) {
+						continue;
+					}
+
+					matches[doc] = words + 1;
+					scores[doc] += _postings[term->start +
+						j].weight * (term->word[len] ?
+						1 : 2);
+				}
+			}
+
+			words++;
+		}
+
+		for (i = 0; words && i < _docCount; i++) {
+			found += matches[i] == words;
+		}
+
+		if (found) {
+			candidates = new TextSearchResult[found];
+		}
+
+		for (i = 0, j = 0; j < found; i++) {
+			if (matches[i] != words) {
+				continue;
+			}
+
+			candidates[j].type = _docs[i].type;
+			candidates[j].id = _docs[i].id;
+			candidates[j].score = scores[i];
+			j++;
+		}
+	} catch (...) {
+		delete[] scores;
+		delete[] matches;
+		delete[] candidates;
+		throw;
+	}
+
+	delete[] scores;
+	delete[] matches;
+
+	if (found) {
+		qsort(candidates, found, sizeof(TextSearchResult),
+			cmp_result);
+		found = MIN(found, maxcount);
+		memcpy(results, candidates, found * sizeof(TextSearchResult));
+	}
+
+	delete[] candidates;
+	return found;
+}
@@ -0,0 +1,89 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SEARCH_H_
+#define SEARCH_H_
+
+#include "utils.h"
+
+#define SEARCH_DOC_HELP 0
+#define SEARCH_DOC_SPECIAL_TECH 1
+#define SEARCH_DOC_WEAPON_TECH 2
+
+class TextManager;
+
+struct TextSearchResult {
+	unsigned type;	// SEARCH_DOC_* constant
+	unsigned id;	// help entry ID or techdesc string ID
+	unsigned score;
+};
+
+// Inverted word index over help texts and ship tech descriptions. The index
+// is built in a background thread, queries will wait until it's finished.
+class TextSearchIndex : protected Thread {
+private:
+	struct SearchDocument {
+		unsigned type, id;
+	};
+
+	struct SearchTerm {
+		const char *word;
+		unsigned start, count;	// range in _postings
+	};
+
+	struct SearchPosting {
+		unsigned doc, weight;
+	};
+
+	const TextManager *_lang;
+	SearchDocument *_docs;
+	SearchTerm *_terms;
+	SearchPosting *_postings;
+	char *_wordPool;
+	unsigned _docCount, _termCount, _postingCount;
+	int _ready;
+
+	// Do NOT implement
+	TextSearchIndex(const TextSearchIndex &other);
+	const TextSearchIndex &operator=(const TextSearchIndex &other);
+
+protected:
+	void clear(void);
+	void run(void);
+
+	// Returns index of the first term which is not less than prefix
+	unsigned findTerm(const char *prefix) const;
+
+public:
+	// lang must not change until the index is deleted
+	explicit TextSearchIndex(const TextManager *lang);
+	~TextSearchIndex(void);
+
+	// Start building the index in background
+	void build(void);
+
+	// Find documents matching all words in query. Query words match
+	// as case-insensitive prefixes, whole word matches get higher score.
+	// Results are sorted by descending score. Returns the number of
+	// results written into the buffer.
+	unsigned search(const char *query, TextSearchResult *results,
+		unsigned maxcount);
+};
+
+#endif
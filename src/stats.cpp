@@ -0,0 +1,315 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cstring>
+#include <stdexcept>
+#include "stats.h"
+
+// History unwrapping assumes that the game starts at stardate 3500.0,
+// that each turn advances the stardate by 0.1 and records exactly one
+// history entry, and that the ring buffer index is the number of turns
+// played modulo MAX_HISTORY_LENGTH. None of this has been checked against
+// a late-game savegame yet.
+
+// Stardate of the first turn in tenths
+#define GAME_START_STARDATE 35000
+
+static unsigned countBits(uint64_t word) {
+	unsigned ret;
+
+	for (ret = 0; word; word &= word - 1) {
+		ret++;
+	}
+
+	return ret;
+}
+
+EmpireAggregates::EmpireAggregates(const GameState *game) : _game(game),
+	_historyLength(0), _graphSeries(HISTORY_TOTAL), _graphWidth(0),
+	_graphHeight(0), _pointCount(0), _graphValid(0) {
+
+	memset(_versions, 0, sizeof(_versions));
+	memset(_stats, 0, sizeof(_stats));
+	memset(_history, 0, sizeof(_history));
+	memset(_historyMax, 0, sizeof(_historyMax));
+	memset(_pointX, 0, sizeof(_pointX));
+	memset(_pointY, 0, sizeof(_pointY));
+}
+
+EmpireAggregates::~EmpireAggregates(void) {
+
+}
+
+void EmpireAggregates::evalStats(void) {
+	unsigned i, j, owner;
+	const Colony *cptr;
+	const Star *sptr;
+	const BilistNode<Fleet> *node;
+	EmpireStats *eptr;
+	const ColonyTable &colonies = _game->colonyTable();
+	const ShipTable &ships = _game->shipTable();
+	const TechTable &techs = _game->techTable();
+
+	memset(_stats, 0, sizeof(_stats));
+
+	for (i = 0; i < _game->_colonyCount; i++) {
+		owner = colonies.owner[i];
+
+		if (colonies.planet[i] < 0 || owner >= MAX_PLAYERS) {
+			continue;
+		}
+
+		cptr = _game->_colonies + i;
+		eptr = _stats + owner;
+
+		if (cptr->is_outpost) {
+			eptr->outposts++;
+			continue;
+		}
+
+		eptr->colonies++;
+		eptr->population += cptr->population;
+		eptr->food += cptr->total_food;
+		eptr->industry += cptr->net_industry;
+		eptr->research += cptr->total_research;
+		eptr->revenue += cptr->total_revenue;
+	}
+
+	for (i = 0; i < _game->_shipCount; i++) {
+		owner = ships.owner[i];
+
+		if (owner >= MAX_PLAYERS || ships.status[i] == Destroyed) {
+			continue;
+		}
+
+		eptr = _stats + owner;
+		eptr->ships++;
+
+		if (ships.type[i] == COMBAT_SHIP) {
+			eptr->combatShips++;
+		} else if (ships.type[i] == COLONY_SHIP ||
+			ships.type[i] == OUTPOST_SHIP) {
+			eptr->colonyShips++;
+		}
+	}
+
+	for (i = 0; i < _game->_starSystemCount; i++) {
+		sptr = _game->_starSystems + i;
+
+		for (node = sptr->getOrbitingFleets(); node;
+			node = node->next()) {
+			if (node->data && node->data->getOwner() < MAX_PLAYERS) {
+				_stats[node->data->getOwner()].fleets++;
+			}
+		}
+	}
+
+	for (node = _game->getMovingFleets(); node; node = node->next()) {
+		if (node->data && node->data->getOwner() < MAX_PLAYERS) {
+			_stats[node->data->getOwner()].fleets++;
+		}
+	}
+
+	for (i = 0; i < _game->_playerCount && i < MAX_PLAYERS; i++) {
+		eptr = _stats + i;
+
+		for (j = 0; j < TECH_WORDS; j++) {
+			eptr->techs += countBits(techs.known[i][j]);
+		}
+
+		// Known hyper-advanced techs are counted by level instead
+		for (j = 0; j < MAX_RESEARCH_AREAS; j++) {
+			if (_game->_players[i].hyperTechLevels[j]) {
+				eptr->techs--;
+			}
+
+			eptr->hyperLevels += _game->_players[i].hyperTechLevels[j];
+		}
+	}
+}
+
+void EmpireAggregates::evalHistory(void) {
+	unsigned i, j, turns, start, pos, total;
+	const Player *pptr;
+	const uint8_t *series[HISTORY_TOTAL];
+
+	turns = 0;
+
+	if (_game->_gameConfig.stardate > GAME_START_STARDATE) {
+		turns = _game->_gameConfig.stardate - GAME_START_STARDATE;
+	}
+
+	// Circular buffers overwrite the oldest turn once full
+	_historyLength = MIN(turns, MAX_HISTORY_LENGTH);
+	start = turns > MAX_HISTORY_LENGTH ? turns % MAX_HISTORY_LENGTH : 0;
+	memset(_historyMax, 0, sizeof(_historyMax));
+
+	for (i = 0; i < _game->_playerCount && i < MAX_PLAYERS; i++) {
+		pptr = _game->_players + i;
+		series[HISTORY_FLEET] = pptr->fleetHistory;
+		series[HISTORY_TECH] = pptr->techHistory;
+		series[HISTORY_POPULATION] = pptr->populationHistory;
+		series[HISTORY_BUILDINGS] = pptr->buildingHistory;
+
+		for (pos = 0; pos < _historyLength; pos++) {
+			total = 0;
+
+			for (j = 0; j < HISTORY_TOTAL; j++) {
+				_history[i][j][pos] =
+					series[j][(start + pos) % MAX_HISTORY_LENGTH];
+				total += _history[i][j][pos];
+				_historyMax[j] = MAX(_historyMax[j],
+					_history[i][j][pos]);
+			}
+
+			_history[i][HISTORY_TOTAL][pos] = total;
+			_historyMax[HISTORY_TOTAL] = MAX(
+				_historyMax[HISTORY_TOTAL], total);
+		}
+	}
+}
+
+void EmpireAggregates::buildGraph(void) {
+	unsigned i, pos, sample, maxval, last;
+
+	_pointCount = MIN(_historyLength, _graphWidth);
+	_graphValid = 1;
+
+	if (!_pointCount || !_graphHeight) {
+		_pointCount = 0;
+		return;
+	}
+
+	last = _graphHeight - 1;
+	maxval = MAX(_historyMax[_graphSeries], 1);
+
+	// Longer history than graph width is sampled at each pixel
+	for (pos = 0; pos < _pointCount; pos++) {
+		sample = _pointCount > 1 ?
+			pos * (_historyLength - 1) / (_pointCount - 1) : 0;
+		_pointX[pos] = _pointCount > 1 ?
+			pos * (_graphWidth - 1) / (_pointCount - 1) : 0;
+
+		for (i = 0; i < _game->_playerCount && i < MAX_PLAYERS; i++) {
+			_pointY[i][pos] = last - last *
+				_history[i][_graphSeries][sample] / maxval;
+		}
+	}
+}
+
+int EmpireAggregates::update(void) {
+	unsigned i;
+	int changed[GAMESTATE_ARRAY_COUNT];
+
+	for (i = 0; i < GAMESTATE_ARRAY_COUNT; i++) {
+		changed[i] = _versions[i] != _game->version(i);
+		_versions[i] = _game->version(i);
+	}
+
+	// Fleets are rebuilt from ship records
+	if (changed[GAMESTATE_COLONIES] || changed[GAMESTATE_SHIPS] ||
+		changed[GAMESTATE_PLAYERS]) {
+		evalStats();
+	}
+
+	if (!changed[GAMESTATE_PLAYERS] && !changed[GAMESTATE_CONFIG]) {
+		return changed[GAMESTATE_COLONIES] || changed[GAMESTATE_SHIPS];
+	}
+
+	evalHistory();
+	_graphValid = 0;
+
+	if (_graphWidth) {
+		buildGraph();
+	}
+
+	return 1;
+}
+
+const EmpireStats &EmpireAggregates::player(unsigned player_id) const {
+	if (player_id >= MAX_PLAYERS) {
+		throw std::out_of_range("Invalid player ID");
+	}
+
+	return _stats[player_id];
+}
+
+unsigned EmpireAggregates::historyLength(void) const {
+	return _historyLength;
+}
+
+unsigned EmpireAggregates::history(unsigned player_id, unsigned series,
+	unsigned pos) const {
+
+	if (player_id >= MAX_PLAYERS) {
+		throw std::out_of_range("Invalid player ID");
+	}
+
+	if (series >= HISTORY_SERIES_COUNT) {
+		throw std::out_of_range("Invalid history series");
+	}
+
+	if (pos >= _historyLength) {
+		throw std::out_of_range("Invalid history position");
+	}
+
+	return _history[player_id][series][pos];
+}
+
+unsigned EmpireAggregates::historyMax(unsigned series) const {
+	if (series >= HISTORY_SERIES_COUNT) {
+		throw std::out_of_range("Invalid history series");
+	}
+
+	return _historyMax[series];
+}
+
+void EmpireAggregates::setGraph(unsigned series, unsigned width,
+	unsigned height) {
+
+	if (series >= HISTORY_SERIES_COUNT) {
+		throw std::out_of_range("Invalid history series");
+	}
+
+	if (_graphValid && series == _graphSeries && width == _graphWidth &&
+		height == _graphHeight) {
+		return;
+	}
+
+	_graphSeries = series;
+	_graphWidth = width;
+	_graphHeight = height;
+	buildGraph();
+}
+
+size_t EmpireAggregates::graphPoints(void) const {
+	return _pointCount;
+}
+
+const int16_t *EmpireAggregates::graphX(void) const {
+	return _pointX;
+}
+
+const int16_t *EmpireAggregates::graphY(unsigned player_id) const {
+	if (player_id >= MAX_PLAYERS) {
+		throw std::out_of_range("Invalid player ID");
+	}
+
+	return _pointY[player_id];
+}
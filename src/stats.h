@@ -0,0 +1,96 @@
+/*
+ * This file is part of OpenOrion2
+ * Copyright (C) 2021 Martin Doucha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include "gamestate.h"
+
+// History series, the total is the sum of the other four
+#define HISTORY_FLEET 0
+#define HISTORY_TECH 1
+#define HISTORY_POPULATION 2
+#define HISTORY_BUILDINGS 3
+#define HISTORY_TOTAL 4
+#define HISTORY_SERIES_COUNT 5
+
+// Empire-wide totals of one player
+struct EmpireStats {
+	unsigned colonies, outposts;
+	// Colonists in all colonies
+	unsigned long population;
+	long food, industry, research, revenue;
+	unsigned ships, combatShips, colonyShips, fleets;
+	// Known applied techs and sum of hyper-advanced tech levels
+	unsigned techs, hyperLevels;
+};
+
+// Cached per-player statistics for the Info screens. All players are
+// evaluated in one pass over the game records. Totals are recalculated
+// only after colony, ship or player records change, history series only
+// after player records or the stardate change.
+class EmpireAggregates {
+private:
+	const GameState *_game;
+	unsigned long _versions[GAMESTATE_ARRAY_COUNT];
+	EmpireStats _stats[MAX_PLAYERS];
+	// History series in chronological order
+	unsigned _historyLength;
+	uint16_t _history[MAX_PLAYERS][HISTORY_SERIES_COUNT][MAX_HISTORY_LENGTH];
+	unsigned _historyMax[HISTORY_SERIES_COUNT];
+	// Graph polylines relative to the top left corner of the graph
+	unsigned _graphSeries, _graphWidth, _graphHeight, _pointCount;
+	int _graphValid;
+	int16_t _pointX[MAX_HISTORY_LENGTH];
+	int16_t _pointY[MAX_PLAYERS][MAX_HISTORY_LENGTH];
+
+	// Do NOT implement
+	EmpireAggregates(const EmpireAggregates &other);
+	const EmpireAggregates &operator=(const EmpireAggregates &other);
+
+protected:
+	void evalStats(void);
+	void evalHistory(void);
+	void buildGraph(void);
+
+public:
+	explicit EmpireAggregates(const GameState *game);
+	~EmpireAggregates(void);
+
+	// Recalculate statistics if the game state changed since the last
+	// call. Returns nonzero if anything was recalculated.
+	int update(void);
+
+	const EmpireStats &player(unsigned player_id) const;
+
+	unsigned historyLength(void) const;
+	// Returns history value, pos 0 is the oldest recorded turn
+	unsigned history(unsigned player_id, unsigned series,
+		unsigned pos) const;
+	unsigned historyMax(unsigned series) const;
+
+	// Scale history series to a graph of given size. Polylines are
+	// rebuilt only when the size, series or history changes.
+	void setGraph(unsigned series, unsigned width, unsigned height);
+	size_t graphPoints(void) const;
+	const int16_t *graphX(void) const;
+	const int16_t *graphY(unsigned player_id) const;
+};
+
+#endif
@@ -22,6 +22,7 @@
 #include <cmath>
 #include <cfloat>
 #include <cassert>
+#include <stdexcept>
 
 #include "stream.h"
 
@@ -667,6 +668,41 @@ size_t MemoryWriteStream::write(const void *buf, size_t size) {
 	return size;
 }
 
+DataCursor::DataCursor(const void *data, size_t size) :
+	_data((const uint8_t*)data), _size(size), _pos(0) {
+
+}
+
+void DataCursor::overrun(void) const {
+	throw std::runtime_error("Unexpected end of data");
+}
+
+void DataCursor::read(void *buf, size_t size) {
+	require(size);
+	memcpy(buf, _data + _pos, size);
+	_pos += size;
+}
+
+const uint8_t *DataCursor::readBlock(size_t size) {
+	const uint8_t *ret = _data + _pos;
+
+	skip(size);
+	return ret;
+}
+
+void DataCursor::skip(size_t size) {
+	require(size);
+	_pos += size;
+}
+
+void DataCursor::seek(size_t offset) {
+	if (offset > _size) {
+		overrun();
+	}
+
+	_pos = offset;
+}
+
 BitStream::BitStream(ReadStream &stream) : _stream(stream), _lastByte(0),
 	_bitsLeft(0) {
 
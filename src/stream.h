@@ -172,6 +172,76 @@ public:
 	size_t size(void) const { return _pos; }
 };
 
+// Non-virtual bounds checked reader of in-memory data for parsing large
+// fixed layout files. Throws exception when reading past the end.
+class DataCursor {
+private:
+	const uint8_t *_data;
+	size_t _size, _pos;
+
+protected:
+	void overrun(void) const;
+
+public:
+	DataCursor(const void *data, size_t size);
+
+	inline void require(size_t size) const {
+		if (size > _size - _pos) {
+			overrun();
+		}
+	}
+
+	inline uint8_t readUint8(void) {
+		require(1);
+		return _data[_pos++];
+	}
+
+	inline int8_t readSint8(void) {
+		return (int8_t)readUint8();
+	}
+
+	inline uint16_t readUint16LE(void) {
+		uint16_t ret;
+
+		require(2);
+		ret = _data[_pos] | (_data[_pos + 1] << 8);
+		_pos += 2;
+		return ret;
+	}
+
+	inline int16_t readSint16LE(void) {
+		return (int16_t)readUint16LE();
+	}
+
+	inline uint32_t readUint32LE(void) {
+		uint32_t ret;
+
+		require(4);
+		ret = _data[_pos] | (_data[_pos + 1] << 8) |
+			(_data[_pos + 2] << 16) | ((uint32_t)_data[_pos + 3] << 24);
+		_pos += 4;
+		return ret;
+	}
+
+	inline int32_t readSint32LE(void) {
+		return (int32_t)readUint32LE();
+	}
+
+	void read(void *buf, size_t size);
+
+	// Returns pointer to the next size bytes and skips them
+	const uint8_t *readBlock(size_t size);
+	void skip(size_t size);
+
+	// Absolute seek, offset may be anywhere up to end of data
+	void seek(size_t offset);
+
+	size_t pos(void) const { return _pos; }
+	size_t size(void) const { return _size; }
+	size_t remaining(void) const { return _size - _pos; }
+	bool eos(void) const { return _pos >= _size; }
+};
+
 class BitStream {
 private:
 	ReadStream &_stream;
@@ -73,4 +73,14 @@ void create_path(const char *path) {
 	create_dir(path);
 }
 
+int fileInfo(const char *path, uint64_t *size, int64_t *mtime) {
+	struct stat buf;
+
+	if (stat(path, &buf)) {
+		return 0;
+	}
 
+	*size = buf.st_size;
+	*mtime = buf.st_mtime;
+	return 1;
+}
@@ -20,6 +20,9 @@
 #ifndef SYSTEM_H_
 #define SYSTEM_H_
 
+#include <cstddef>
+#include <cstdint>
+
 // Return the name of parent directory
 char *parent_dir(const char *path);
 
@@ -45,6 +48,22 @@ char *dataPath(const char *filename);
 // Returns newly allocated string
 char *configPath(const char *filename);
 
+// Get file size and last modification time. Returns 0 if the file cannot
+// be accessed.
+int fileInfo(const char *path, uint64_t *size, int64_t *mtime);
+
+// Map the whole file into memory for reading. Returns NULL if the file
+// cannot be opened. The mapping must be released using unmapFile().
+const void *mapFile(const char *path, size_t *size);
+void unmapFile(const void *ptr, size_t size);
+
+// Replace file at path with tmppath
+void replaceFile(const char *tmppath, const char *path);
+
+// Write data to a temporary file, flush it to disk and then replace file
+// at path. Throws exception on error.
+void writeFileSync(const char *path, const void *data, size_t size);
+
 // Init relative datadir path on certain systems
 void init_paths(const char *exepath);
 
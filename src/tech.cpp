@@ -295,6 +295,17 @@ const ResearchChoice research_choices[MAX_RESEARCH_TOPICS] = {
 	{25000, 0, {TECH_HYPER_SOCIOLOGY}},
 };
 
+// Built from the constant tables above during static initialization
+const ResearchTree researchTree;
+
+static void setTreeBit(uint64_t *mask, unsigned id) {
+	mask[id / 64] |= (uint64_t)1 << (id % 64);
+}
+
+static int testTreeBit(const uint64_t *mask, unsigned id) {
+	return (mask[id / 64] >> (id % 64)) & 1;
+}
+
 TechListWidget::TechListGroup::TechListGroup(void) : title(NULL), itemCount(0),
 	height(0), color(FONT_COLOR_DEFAULT), items(NULL) {
 
@@ -657,7 +668,6 @@ ResearchSelectWidget::ResearchSelectWidget(GuiView *parent, int x, int y,
 	_selection(-1), _choiceCount(0), _startTick(0) {
 
 	unsigned i;
-	Technology tech;
 	Player *pptr;
 
 	if (area >= MAX_RESEARCH_AREAS) {
@@ -669,36 +679,17 @@ ResearchSelectWidget::ResearchSelectWidget(GuiView *parent, int x, int y,
 	}
 
 	pptr = _game->_players + activePlayer;
-
-	for (i = 0; !isHyperTopic(techtree[area][i]); i++) {
-		if (pptr->canResearchTopic(techtree[area][i])) {
-			break;
+	_topic = (ResearchTopic)researchTree.readyTopic(_game->techTable(),
+		activePlayer, area);
+	_choiceCount = researchTree.researchableTechs(_game->techTable(),
+		activePlayer, _topic, _choices);
+
+	for (i = 0; !isHyperTopic(_topic) && i < _choiceCount; i++) {
+		if (pptr->researchItem == (uint16_t)_choices[i]) {
+			_selection = i;
 		}
 	}
 
-	_topic = techtree[area][i];
-
-	for (i = 0; i < MAX_RESEARCH_CHOICES; i++) {
-		tech = research_choices[_topic].choices[i];
-
-		if (!tech) {
-			break;
-		}
-	
-		if (!isHyperTopic(_topic)) {
-			if (pptr->knowsTechnology(tech) ||
-				!pptr->canResearchTech(tech)) {
-				continue;
-			}
-
-			if (pptr->researchItem == (uint16_t)tech) {
-				_selection = _choiceCount;
-			}
-		}
-
-		_choices[_choiceCount++] = tech;
-	}
-
 	if (!_choiceCount) {
 		_choices[_choiceCount++] = TECH_NONE;
 	}
@@ -1049,12 +1040,8 @@ void ResearchListWindow::initList(void) {
 	TechListWidget::TechListItem items[MAX_RESEARCH_CHOICES];
 	StringBuffer buf, num;
 
-	for (i = 0; !isHyperTopic(techtree[_area][i]); i++) {
-		if (pptr->canResearchTopic(techtree[_area][i])) {
-			break;
-		}
-	}
-
+	i = researchTree.readyTopic(_game->techTable(), _activePlayer, _area);
+	i = researchTree.topicLevel(i);
 	_topicOffset = i;
 
 	for (; !isHyperTopic(techtree[_area][i]); i++) {
@@ -1204,3 +1191,187 @@ void ResearchListWindow::redraw(unsigned curtick) {
 int isHyperTopic(unsigned topic) {
 	return topic >= TOPIC_HYPER_BIOLOGY;
 }
+
+int researchTopicArea(unsigned topic) {
+	return researchTree.topicArea(topic);
+}
+
+ResearchTree::ResearchTree(void) {
+	unsigned i, j, topic, pos;
+	Technology tech;
+	uint64_t chain[TOPIC_WORDS];
+
+	memset(_order, 0, sizeof(_order));
+	memset(_area, -1, sizeof(_area));
+	memset(_level, 0, sizeof(_level));
+	memset(_prereqs, 0, sizeof(_prereqs));
+	memset(_areaTopics, 0, sizeof(_areaTopics));
+	memset(_topicTechs, 0, sizeof(_topicTechs));
+	memset(_hyperTopics, 0, sizeof(_hyperTopics));
+
+	for (i = 0; i < MAX_RESEARCH_AREAS; i++) {
+		memset(chain, 0, sizeof(chain));
+
+		for (j = 0; j < MAX_AREA_TOPICS; j++) {
+			topic = techtree[i][j];
+			_area[topic] = i;
+			_level[topic] = j;
+			memcpy(_prereqs[topic], chain, sizeof(chain));
+			setTreeBit(chain, topic);
+
+			if (isHyperTopic(topic)) {
+				_hyperTopics[i] = topic;
+				break;
+			}
+
+			setTreeBit(_areaTopics[i], topic);
+		}
+	}
+
+	for (i = 0; i < MAX_RESEARCH_TOPICS; i++) {
+		for (j = 0; j < MAX_RESEARCH_CHOICES; j++) {
+			tech = research_choices[i].choices[j];
+
+			if (!tech) {
+				break;
+			}
+
+			setTreeBit(_topicTechs[i], tech);
+		}
+	}
+
+	// Topics of equal level stay in ID order
+	for (i = 0, pos = 0; i < MAX_AREA_TOPICS; i++) {
+		for (j = 0; j < MAX_RESEARCH_TOPICS; j++) {
+			if (_level[j] == i) {
+				_order[pos++] = j;
+			}
+		}
+	}
+}
+
+const uint8_t *ResearchTree::order(void) const {
+	return _order;
+}
+
+int ResearchTree::topicArea(unsigned topic) const {
+	if (topic >= MAX_RESEARCH_TOPICS) {
+		return -1;
+	}
+
+	return _area[topic];
+}
+
+unsigned ResearchTree::topicLevel(unsigned topic) const {
+	if (topic >= MAX_RESEARCH_TOPICS) {
+		throw std::out_of_range("Invalid research topic ID");
+	}
+
+	return _level[topic];
+}
+
+const uint64_t *ResearchTree::prerequisites(unsigned topic) const {
+	if (topic >= MAX_RESEARCH_TOPICS) {
+		throw std::out_of_range("Invalid research topic ID");
+	}
+
+	return _prereqs[topic];
+}
+
+const uint64_t *ResearchTree::topicTechs(unsigned topic) const {
+	if (topic >= MAX_RESEARCH_TOPICS) {
+		throw std::out_of_range("Invalid research topic ID");
+	}
+
+	return _topicTechs[topic];
+}
+
+unsigned ResearchTree::readyTopic(const TechTable &table, unsigned player,
+	unsigned area) const {
+
+	unsigned i, j, ret;
+	uint64_t word;
+
+	if (player >= MAX_PLAYERS) {
+		throw std::out_of_range("Invalid player ID");
+	}
+
+	if (area >= MAX_RESEARCH_AREAS) {
+		throw std::out_of_range("Invalid research area");
+	}
+
+	ret = _hyperTopics[area];
+
+	for (i = 0; i < TOPIC_WORDS; i++) {
+		word = table.readyTopics[player][i] & _areaTopics[area][i];
+
+		for (j = 0; word; j++, word >>= 1) {
+			if ((word & 1) && _level[64 * i + j] < _level[ret]) {
+				ret = 64 * i + j;
+			}
+		}
+	}
+
+	return ret;
+}
+
+size_t ResearchTree::readyTopics(const TechTable &table, unsigned player,
+	unsigned *ids) const {
+
+	unsigned i, j;
+	size_t count = 0;
+	uint64_t word;
+
+	if (player >= MAX_PLAYERS) {
+		throw std::out_of_range("Invalid player ID");
+	}
+
+	for (i = 0; i < TOPIC_WORDS; i++) {
+		word = table.readyTopics[player][i];
+
+		for (j = 0; word; j++, word >>= 1) {
+			if (word & 1) {
+				ids[count++] = 64 * i + j;
+			}
+		}
+	}
+
+	return count;
+}
+
+size_t ResearchTree::researchableTechs(const TechTable &table, unsigned player,
+	unsigned topic, Technology *techs) const {
+
+	unsigned i;
+	size_t count = 0;
+	Technology tech;
+
+	if (player >= MAX_PLAYERS) {
+		throw std::out_of_range("Invalid player ID");
+	}
+
+	if (topic >= MAX_RESEARCH_TOPICS) {
+		throw std::out_of_range("Invalid research topic ID");
+	}
+
+	if (isHyperTopic(topic)) {
+		techs[0] = research_choices[topic].choices[0];
+		return 1;
+	}
+
+	// Keep the list order, the research screen and AI depend on it
+	for (i = 0; i < MAX_RESEARCH_CHOICES; i++) {
+		tech = research_choices[topic].choices[i];
+
+		if (!tech) {
+			break;
+		}
+
+		if (testTreeBit(table.researchable[player], tech) &&
+			!testTreeBit(table.known[player], tech)) {
+			techs[count++] = tech;
+		}
+	}
+
+	return count;
+}
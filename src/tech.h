@@ -185,8 +185,56 @@ public:
 	void redraw(unsigned curtick);
 };
 
+// Research tree tables derived from techtree and research_choices.
+// Topics of each area form a chain, a topic becomes ready once
+// the previous topic in the same area is researched.
+class ResearchTree {
+private:
+	// Topic IDs sorted by position in area, each topic follows all its
+	// prerequisites
+	uint8_t _order[MAX_RESEARCH_TOPICS];
+	int8_t _area[MAX_RESEARCH_TOPICS];
+	uint8_t _level[MAX_RESEARCH_TOPICS];
+	uint64_t _prereqs[MAX_RESEARCH_TOPICS][TOPIC_WORDS];
+	uint64_t _areaTopics[MAX_RESEARCH_AREAS][TOPIC_WORDS];
+	uint64_t _topicTechs[MAX_RESEARCH_TOPICS][TECH_WORDS];
+	uint8_t _hyperTopics[MAX_RESEARCH_AREAS];
+
+	// Do NOT implement
+	ResearchTree(const ResearchTree &other);
+	const ResearchTree &operator=(const ResearchTree &other);
+
+public:
+	ResearchTree(void);
+
+	const uint8_t *order(void) const;
+	int topicArea(unsigned topic) const;
+	unsigned topicLevel(unsigned topic) const;
+	// Bitset of topics which must be researched before the topic
+	const uint64_t *prerequisites(unsigned topic) const;
+	// Bitset of techs unlocked by the topic
+	const uint64_t *topicTechs(unsigned topic) const;
+
+	// Returns the first topic in the area which the player can research.
+	// If there is none, returns the hyper-advanced topic of the area.
+	unsigned readyTopic(const TechTable &table, unsigned player,
+		unsigned area) const;
+	// Store IDs of all topics which the player can research into ids
+	// in ascending order. Returns the number of stored IDs.
+	size_t readyTopics(const TechTable &table, unsigned player,
+		unsigned *ids) const;
+	// Store techs of the topic which the player can research and doesn't
+	// know yet, in research_choices order. Hyper-advanced topics always
+	// return their tech. Returns the number of stored techs.
+	size_t researchableTechs(const TechTable &table, unsigned player,
+		unsigned topic, Technology *techs) const;
+};
+
 extern const ResearchChoice research_choices[MAX_RESEARCH_TOPICS];
+extern const ResearchTree researchTree;
 
 int isHyperTopic(unsigned topic);
+// Returns research area of the topic or -1 if the topic belongs to none
+int researchTopicArea(unsigned topic);
 
 #endif
@@ -17,10 +17,13 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <cstdio>
 #include <cstring>
 #include <cerrno>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <dirent.h>
 #include <pwd.h>
 #include <unistd.h>
@@ -28,11 +31,109 @@
 #include "system.h"
 
 void create_dir(const char *path) {
-	if (mkdir(path, 0755)) {
+	// Another thread may have created the directory in the meantime
+	if (mkdir(path, 0755) && errno != EEXIST) {
 		throw std::runtime_error("Could not create directory");
 	}
 }
 
+const void *mapFile(const char *path, size_t *size) {
+	struct stat buf;
+	void *ret;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+
+	if (fd < 0) {
+		return NULL;
+	}
+
+	if (fstat(fd, &buf) || !buf.st_size) {
+		::close(fd);
+		return NULL;
+	}
+
+	ret = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+
+	if (ret == MAP_FAILED) {
+		return NULL;
+	}
+
+	*size = buf.st_size;
+	return ret;
+}
+
+void unmapFile(const void *ptr, size_t size) {
+	if (ptr) {
+		munmap((void*)ptr, size);
+	}
+}
+
+void replaceFile(const char *tmppath, const char *path) {
+	if (rename(tmppath, path)) {
+		throw std::runtime_error("Could not replace file");
+	}
+}
+
+void writeFileSync(const char *path, const void *data, size_t size) {
+	const char *ptr = (const char*)data;
+	char *tmppath, *dir;
+	ssize_t ret;
+	int fd;
+
+	tmppath = new char[strlen(path) + 5];
+	sprintf(tmppath, "%s.tmp", path);
+	fd = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if (fd < 0) {
+		delete[] tmppath;
+		throw std::runtime_error("Cannot create file");
+	}
+
+	while (size) {
+		ret = write(fd, ptr, size);
+
+		if (ret < 0 && errno == EINTR) {
+			continue;
+		} else if (ret <= 0) {
+			break;
+		}
+
+		ptr += ret;
+		size -= ret;
+	}
+
+	if (size || fsync(fd)) {
+		::close(fd);
+		unlink(tmppath);
+		delete[] tmppath;
+		throw std::runtime_error("Cannot write file");
+	}
+
+	::close(fd);
+
+	try {
+		replaceFile(tmppath, path);
+	} catch (...) {
+		unlink(tmppath);
+		delete[] tmppath;
+		throw;
+	}
+
+	delete[] tmppath;
+
+	// Make the rename durable as well
+	dir = parent_dir(path);
+	fd = open(dir, O_RDONLY);
+	delete[] dir;
+
+	if (fd >= 0) {
+		fsync(fd);
+		::close(fd);
+	}
+}
+
 char *concatPath(const char *basepath, const char *relpath) {
 	size_t baselen, pathlen;
 	char *ret;
@@ -22,6 +22,8 @@
 #include <cctype>
 #include "utils.h"
 
+#define RADIX_SORT_MIN 64
+
 struct RomanNumeral {
 	unsigned value;
 	unsigned reduction;
@@ -87,6 +89,192 @@ void GarbageCollector::flush(void) {
 	}
 }
 
+Task::Task(void) : _next(NULL), _error(NULL), _order(0) {
+
+}
+
+Task::~Task(void) {
+	delete[] _error;
+}
+
+WorkerPool::Worker::Worker(WorkerPool *pool) : _pool(pool) {
+
+}
+
+WorkerPool::Worker::~Worker(void) {
+	try {
+		join();
+	} catch (...) {
+		// Worker errors are reported through tasks
+	}
+}
+
+void WorkerPool::Worker::run(void) {
+	Task *task;
+
+	_pool->_lock.lock();
+
+	while (1) {
+		task = _pool->nextTask();
+
+		if (task) {
+			_pool->_lock.unlock();
+			_pool->execute(task);
+			_pool->_lock.lock();
+			continue;
+		}
+
+		if (_pool->_shutdown) {
+			break;
+		}
+
+		_pool->_cond.wait(_pool->_lock);
+	}
+
+	_pool->_lock.unlock();
+}
+
+WorkerPool::WorkerPool(unsigned threads) : _workers(NULL), _workerCount(0),
+	_maxWorkers(threads ? threads : cpuCount()), _queue(NULL),
+	_queueEnd(NULL), _failed(NULL), _pending(0), _submitted(0),
+	_shutdown(0) {
+
+	_workers = new Worker*[_maxWorkers];
+}
+
+WorkerPool::~WorkerPool(void) {
+	unsigned i;
+
+	try {
+		wait();
+	} catch (...) {
+		// Nobody is interested in task errors anymore
+	}
+
+	_lock.lock();
+	_shutdown = 1;
+	_cond.broadcast();
+	_lock.unlock();
+
+	for (i = 0; i < _workerCount; i++) {
+		delete _workers[i];
+	}
+
+	delete[] _workers;
+}
+
+Task *WorkerPool::nextTask(void) {
+	Task *ret = _queue;
+
+	if (ret) {
+		_queue = ret->_next;
+		_queueEnd = _queue ? _queueEnd : NULL;
+		ret->_next = NULL;
+	}
+
+	return ret;
+}
+
+void WorkerPool::execute(Task *task) {
+	char *err = NULL;
+
+	try {
+		task->run();
+	} catch (std::exception &e) {
+		err = copystr(e.what());
+	} catch (...) {
+		err = copystr("Unknown error in worker task");
+	}
+
+	AutoMutex lock(_lock);
+
+	task->_error = err;
+
+	if (err && (!_failed || task->_order < _failed->_order)) {
+		_failed = task;
+	}
+
+	if (!--_pending) {
+		_cond.broadcast();
+	}
+}
+
+void WorkerPool::add(Task *task) {
+	Worker *w = NULL;
+	AutoMutex lock(_lock);
+
+	if (_shutdown) {
+		throw std::logic_error("Cannot add task to stopped worker pool");
+	}
+
+	delete[] task->_error;
+	task->_error = NULL;
+	task->_next = NULL;
+	task->_order = _submitted++;
+
+	if (_queueEnd) {
+		_queueEnd->_next = task;
+	} else {
+		_queue = task;
+	}
+
+	_queueEnd = task;
+	_pending++;
+	_cond.broadcast();
+
+	if (_workerCount >= _maxWorkers || _workerCount >= _pending) {
+		return;
+	}
+
+	try {
+		w = new Worker(this);
+		w->start();
+		_workers[_workerCount++] = w;
+	} catch (...) {
+		// Not fatal, wait() will process the task instead
+		delete w;
+	}
+}
+
+void WorkerPool::wait(void) {
+	Task *task;
+	char *err;
+
+	_lock.lock();
+
+	while (_pending) {
+		task = nextTask();
+
+		if (task) {
+			_lock.unlock();
+			execute(task);
+			_lock.lock();
+			continue;
+		}
+
+		_cond.wait(_lock);
+	}
+
+	task = _failed;
+	_failed = NULL;
+	_submitted = 0;
+	_lock.unlock();
+
+	if (!task) {
+		return;
+	}
+
+	err = task->_error;
+	task->_error = NULL;
+
+	try {
+		throw std::runtime_error(err);
+	} catch (...) {
+		delete[] err;
+		throw;
+	}
+}
+
 StringBuffer::StringBuffer(size_t size) : _buf(NULL), _length(0), _size(size) {
 	_size = _size < 32 ? 32 : _size;
 	_buf = new char[_size];
@@ -401,3 +589,57 @@ int isInEllipse(int x, int y, int cx, int cy, unsigned rx, unsigned ry) {
 int checkBitfield(const uint8_t *bitfield, unsigned bit) {
 	return bitfield && (bitfield[bit / 8] & (1 << (bit % 8)));
 }
+
+void radixSort(SortKey *items, SortKey *tmp, size_t count) {
+	size_t i, pos, hist[4][256];
+	unsigned j, shift;
+	SortKey *src = items, *dest = tmp, *swap, item;
+
+	// Clearing histograms costs more than insertion sort of short lists
+	if (count <= RADIX_SORT_MIN) {
+		for (i = 1; i < count; i++) {
+			item = items[i];
+
+			for (pos = i; pos > 0 && items[pos - 1].key > item.key;
+				pos--) {
+				items[pos] = items[pos - 1];
+			}
+
+			items[pos] = item;
+		}
+
+		return;
+	}
+
+	memset(hist, 0, sizeof(hist));
+
+	// Count all key bytes in one pass
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < 4; j++) {
+			hist[j][(items[i].key >> (8 * j)) & 0xff]++;
+		}
+	}
+
+	for (j = 0, shift = 0; j < 4; j++, shift += 8) {
+		if (!count || hist[j][(items[0].key >> shift) & 0xff] == count) {
+			continue;
+		}
+
+		for (i = 0, pos = 0; i < 256; i++) {
+			pos += hist[j][i];
+			hist[j][i] = pos - hist[j][i];
+		}
+
+		for (i = 0; i < count; i++) {
+			dest[hist[j][(src[i].key >> shift) & 0xff]++] = src[i];
+		}
+
+		swap = src;
+		src = dest;
+		dest = swap;
+	}
+
+	if (src != items) {
+		memcpy(items, src, count * sizeof(SortKey));
+	}
+}
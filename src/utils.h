@@ -51,6 +51,26 @@ public:
 	// Returns 1 if the mutex was locked, 0 if it's unavailable, throws
 	// exception on error.
 	int try_lock(void);
+
+	friend class Condition;
+};
+
+class Condition {
+private:
+	struct ConditionImpl *_cond;
+
+	// Do NOT implement
+	Condition(const Condition &other);
+	const Condition &operator=(const Condition &other);
+
+public:
+	Condition(void);
+	~Condition(void);
+
+	// The mutex must be locked by the calling thread
+	void wait(Mutex &m);
+	void signal(void);
+	void broadcast(void);
 };
 
 // Mutex scope guard
@@ -67,6 +87,105 @@ public:
 	~AutoMutex(void);
 };
 
+// Base class for background tasks. Subclasses implement run() and start()
+// executes it in a new thread. Subclasses must call join() in their own
+// destructor because run() may still be using their data.
+class Thread {
+private:
+	struct ThreadImpl *_thread;
+	char *_error;
+
+	static int threadMain(void *arg);
+
+	// Do NOT implement
+	Thread(const Thread &other);
+	const Thread &operator=(const Thread &other);
+
+protected:
+	virtual void run(void) = 0;
+
+public:
+	Thread(void);
+	virtual ~Thread(void);
+
+	void start(void);
+
+	// Wait until run() returns. If run() threw an exception, its message
+	// will be rethrown as std::runtime_error. Calling join() on a thread
+	// which is not running does nothing.
+	void join(void);
+	int isRunning(void) const;
+};
+
+// Unit of work for WorkerPool
+class Task {
+private:
+	Task *_next;
+	char *_error;
+	unsigned _order;
+
+	// Do NOT implement
+	Task(const Task &other);
+	const Task &operator=(const Task &other);
+
+protected:
+	virtual void run(void) = 0;
+
+public:
+	Task(void);
+	virtual ~Task(void);
+
+	friend class WorkerPool;
+};
+
+// Runs independent tasks in parallel. The thread calling wait() will also
+// process queued tasks, so pools may be safely nested inside other tasks.
+class WorkerPool {
+private:
+	class Worker : public Thread {
+	private:
+		WorkerPool *_pool;
+
+	protected:
+		void run(void);
+
+	public:
+		explicit Worker(WorkerPool *pool);
+		~Worker(void);
+	};
+
+	Mutex _lock;
+	Condition _cond;
+	Worker **_workers;
+	unsigned _workerCount, _maxWorkers;
+	Task *_queue, *_queueEnd, *_failed;
+	unsigned _pending, _submitted;
+	int _shutdown;
+
+	// Do NOT implement
+	WorkerPool(const WorkerPool &other);
+	const WorkerPool &operator=(const WorkerPool &other);
+
+protected:
+	// Remove the next task from queue, _lock must be held
+	Task *nextTask(void);
+	void execute(Task *task);
+
+public:
+	// threads == 0 means one thread per CPU core
+	explicit WorkerPool(unsigned threads = 0);
+	~WorkerPool(void);
+
+	// The task must stay valid until wait() returns. The pool does not
+	// take ownership.
+	void add(Task *task);
+
+	// Wait until all tasks are finished. If any tasks failed, the error
+	// of the earliest added failed task will be rethrown as
+	// std::runtime_error.
+	void wait(void);
+};
+
 // Base class for objects which need to be deleted while possibly still in use
 // by the rendering thread.
 class Recyclable {
@@ -178,6 +297,60 @@ public:
 	const BilistNode *next(void) const;
 };
 
+template <class C> struct SpatialItem {
+	C *data;
+	unsigned key;
+};
+
+// Uniform grid of items placed in 2D space. Query results are sorted by
+// item key so that callers can keep their own priority order.
+template <class C> class SpatialGrid {
+private:
+	struct Entry {
+		C *data;
+		int x, y, next;
+		unsigned key;
+	};
+
+	Entry *_entries;
+	int *_cells;
+	int _freeEntry;
+	size_t _entryCount, _maxEntries;
+	unsigned _cols, _rows, _cellSize;
+
+	// Do NOT implement
+	SpatialGrid(const SpatialGrid &other);
+	const SpatialGrid &operator=(const SpatialGrid &other);
+
+protected:
+	unsigned cellCol(int x) const;
+	unsigned cellRow(int y) const;
+	int allocEntry(void);
+
+	// Add item to sorted result array, drops the highest key on overflow
+	static size_t addResult(SpatialItem<C> *ret, size_t count, size_t max,
+		const Entry *item);
+
+public:
+	SpatialGrid(void);
+	~SpatialGrid(void);
+
+	// Remove all items and resize the grid to cover area of given size
+	void reset(unsigned width, unsigned height, unsigned cellSize);
+	void clear(void);
+
+	void insert(C *ptr, int x, int y, unsigned key);
+	void remove(C *ptr, int x, int y);
+
+	// Store at most max items inside the area into ret array. Returns
+	// the number of stored items.
+	size_t findPoint(int x, int y, SpatialItem<C> *ret, size_t max) const;
+	size_t findRect(int x, int y, unsigned width, unsigned height,
+		SpatialItem<C> *ret, size_t max) const;
+	size_t findRadius(int x, int y, unsigned radius, SpatialItem<C> *ret,
+		size_t max) const;
+};
+
 char *copystr(const char *str);
 char *strlower(const char *str);
 char *strupper(const char *str);
@@ -187,6 +360,21 @@ int isInEllipse(int x, int y, int cx, int cy, unsigned rx, unsigned ry);
 
 int checkBitfield(const uint8_t *bitfield, unsigned bit);
 
+// Item of ID list sorted by extracted integer key
+struct SortKey {
+	uint32_t key;
+	unsigned id;
+};
+
+// Stable LSD radix sort by ascending key. Tmp must have room for count
+// items. Key bytes which are the same in all items are skipped.
+void radixSort(SortKey *items, SortKey *tmp, size_t count);
+
+unsigned cpuCount(void);
+
+// Milliseconds since program start
+unsigned getTicks(void);
+
 template <class C>
 BilistNode<C>::BilistNode(void) : _prev(NULL), _next(NULL), _discarded(0),
 	data(NULL) {
@@ -301,4 +489,247 @@ const BilistNode<C> *BilistNode<C>::next(void) const {
 	return _next;
 }
 
+template <class C>
+SpatialGrid<C>::SpatialGrid(void) : _entries(NULL), _cells(NULL),
+	_freeEntry(-1), _entryCount(0), _maxEntries(0), _cols(0), _rows(0),
+	_cellSize(1) {
+
+}
+
+template <class C>
+SpatialGrid<C>::~SpatialGrid(void) {
+	delete[] _entries;
+	delete[] _cells;
+}
+
+template <class C>
+unsigned SpatialGrid<C>::cellCol(int x) const {
+	if (x < 0) {
+		return 0;
+	}
+
+	x /= _cellSize;
+	return (unsigned)x < _cols ? x : _cols - 1;
+}
+
+template <class C>
+unsigned SpatialGrid<C>::cellRow(int y) const {
+	if (y < 0) {
+		return 0;
+	}
+
+	y /= _cellSize;
+	return (unsigned)y < _rows ? y : _rows - 1;
+}
+
+template <class C>
+int SpatialGrid<C>::allocEntry(void) {
+	int ret;
+
+	if (_freeEntry >= 0) {
+		ret = _freeEntry;
+		_freeEntry = _entries[ret].next;
+		return ret;
+	}
+
+	if (_entryCount >= _maxEntries) {
+		size_t i, size = _maxEntries ? 2 * _maxEntries : 64;
+		Entry *tmp = new Entry[size];
+
+		for (i = 0; i < _entryCount; i++) {
+			tmp[i] = _entries[i];
+		}
+
+		delete[] _entries;
+		_entries = tmp;
+		_maxEntries = size;
+	}
+
+	return _entryCount++;
+}
+
+template <class C>
+size_t SpatialGrid<C>::addResult(SpatialItem<C> *ret, size_t count,
+	size_t max, const Entry *item) {
+
+	size_t pos;
+
+	if (count >= max) {
+		if (!max || ret[max - 1].key < item->key) {
+			return count;
+		}
+
+		count--;
+	}
+
+	for (pos = count; pos > 0 && ret[pos - 1].key > item->key; pos--) {
+		ret[pos] = ret[pos - 1];
+	}
+
+	ret[pos].data = item->data;
+	ret[pos].key = item->key;
+	return count + 1;
+}
+
+template <class C>
+void SpatialGrid<C>::reset(unsigned width, unsigned height,
+	unsigned cellSize) {
+
+	unsigned i, cols, rows;
+	int *cells;
+
+	if (!cellSize) {
+		throw std::invalid_argument("Grid cell size must be non-zero");
+	}
+
+	cols = width / cellSize + 1;
+	rows = height / cellSize + 1;
+	cells = new int[cols * rows];
+
+	for (i = 0; i < cols * rows; i++) {
+		cells[i] = -1;
+	}
+
+	delete[] _cells;
+	_cells = cells;
+	_cols = cols;
+	_rows = rows;
+	_cellSize = cellSize;
+	_entryCount = 0;
+	_freeEntry = -1;
+}
+
+template <class C>
+void SpatialGrid<C>::clear(void) {
+	unsigned i;
+
+	for (i = 0; i < _cols * _rows; i++) {
+		_cells[i] = -1;
+	}
+
+	_entryCount = 0;
+	_freeEntry = -1;
+}
+
+template <class C>
+void SpatialGrid<C>::insert(C *ptr, int x, int y, unsigned key) {
+	int id, *cell;
+
+	if (!_cells) {
+		throw std::logic_error("Grid size was not set");
+	}
+
+	id = allocEntry();
+	cell = _cells + cellRow(y) * _cols + cellCol(x);
+	_entries[id].data = ptr;
+	_entries[id].x = x;
+	_entries[id].y = y;
+	_entries[id].key = key;
+	_entries[id].next = *cell;
+	*cell = id;
+}
+
+template <class C>
+void SpatialGrid<C>::remove(C *ptr, int x, int y) {
+	int *link;
+
+	if (!_cells) {
+		return;
+	}
+
+	link = _cells + cellRow(y) * _cols + cellCol(x);
+
+	for (; *link >= 0; link = &_entries[*link].next) {
+		Entry *item = _entries + *link;
+
+		if (item->data == ptr && item->x == x && item->y == y) {
+			int id = *link;
+
+			*link = item->next;
+			item->next = _freeEntry;
+			_freeEntry = id;
+			return;
+		}
+	}
+}
+
+template <class C>
+size_t SpatialGrid<C>::findPoint(int x, int y, SpatialItem<C> *ret,
+	size_t max) const {
+
+	return findRect(x, y, 1, 1, ret, max);
+}
+
+template <class C>
+size_t SpatialGrid<C>::findRect(int x, int y, unsigned width,
+	unsigned height, SpatialItem<C> *ret, size_t max) const {
+
+	unsigned col, row, mincol, maxcol, maxrow;
+	size_t count = 0;
+	int id;
+
+	if (!_cells || !width || !height) {
+		return 0;
+	}
+
+	mincol = cellCol(x);
+	maxcol = cellCol(x + width - 1);
+	maxrow = cellRow(y + height - 1);
+
+	for (row = cellRow(y); row <= maxrow; row++) {
+		for (col = mincol; col <= maxcol; col++) {
+			id = _cells[row * _cols + col];
+
+			for (; id >= 0; id = _entries[id].next) {
+				const Entry *item = _entries + id;
+
+				if (isInRect(item->x, item->y, x, y, width,
+					height)) {
+					count = addResult(ret, count, max,
+						item);
+				}
+			}
+		}
+	}
+
+	return count;
+}
+
+template <class C>
+size_t SpatialGrid<C>::findRadius(int x, int y, unsigned radius,
+	SpatialItem<C> *ret, size_t max) const {
+
+	unsigned col, row, mincol, maxcol, maxrow;
+	size_t count = 0;
+	int id, dx, dy, r2 = radius * radius;
+
+	if (!_cells) {
+		return 0;
+	}
+
+	mincol = cellCol(x - (int)radius);
+	maxcol = cellCol(x + (int)radius);
+	maxrow = cellRow(y + (int)radius);
+
+	for (row = cellRow(y - (int)radius); row <= maxrow; row++) {
+		for (col = mincol; col <= maxcol; col++) {
+			id = _cells[row * _cols + col];
+
+			for (; id >= 0; id = _entries[id].next) {
+				const Entry *item = _entries + id;
+
+				dx = item->x - x;
+				dy = item->y - y;
+
+				if (dx * dx + dy * dy <= r2) {
+					count = addResult(ret, count, max,
+						item);
+				}
+			}
+		}
+	}
+
+	return count;
+}
+
 #endif
@@ -18,7 +18,9 @@
  */
 
 #include <direct.h>
+#include <io.h>
 #include <cstdio>
+#include <cerrno>
 #include <cstring>
 #include <stdexcept>
 #include "system.h"
@@ -27,11 +29,95 @@
 static char *data_basepath = NULL;
 
 void create_dir(const char *path) {
-	if (mkdir(path)) {
+	// Another thread may have created the directory in the meantime
+	if (mkdir(path) && errno != EEXIST) {
 		throw std::runtime_error("Could not create directory");
 	}
 }
 
+// No mmap() here, read the whole file into memory instead
+const void *mapFile(const char *path, size_t *size) {
+	FILE *fr;
+	long len;
+	char *ret = NULL;
+
+	fr = fopen(path, "rb");
+
+	if (!fr) {
+		return NULL;
+	}
+
+	if (fseek(fr, 0, SEEK_END) || (len = ftell(fr)) <= 0 ||
+		fseek(fr, 0, SEEK_SET)) {
+		fclose(fr);
+		return NULL;
+	}
+
+	try {
+		ret = new char[len];
+	} catch (...) {
+		fclose(fr);
+		throw;
+	}
+
+	if (fread(ret, 1, len, fr) != (size_t)len) {
+		delete[] ret;
+		ret = NULL;
+	}
+
+	fclose(fr);
+	*size = len;
+	return ret;
+}
+
+void unmapFile(const void *ptr, size_t size) {
+	delete[] (const char*)ptr;
+}
+
+void replaceFile(const char *tmppath, const char *path) {
+	// rename() will not overwrite existing files on Windows
+	remove(path);
+
+	if (rename(tmppath, path)) {
+		throw std::runtime_error("Could not replace file");
+	}
+}
+
+void writeFileSync(const char *path, const void *data, size_t size) {
+	char *tmppath;
+	FILE *fw;
+	int ret;
+
+	tmppath = new char[strlen(path) + 5];
+	sprintf(tmppath, "%s.tmp", path);
+	fw = fopen(tmppath, "wb");
+
+	if (!fw) {
+		delete[] tmppath;
+		throw std::runtime_error("Cannot create file");
+	}
+
+	ret = fwrite(data, 1, size, fw) != size || fflush(fw) ||
+		_commit(_fileno(fw));
+	ret = fclose(fw) || ret;
+
+	if (ret) {
+		remove(tmppath);
+		delete[] tmppath;
+		throw std::runtime_error("Cannot write file");
+	}
+
+	try {
+		replaceFile(tmppath, path);
+	} catch (...) {
+		remove(tmppath);
+		delete[] tmppath;
+		throw;
+	}
+
+	delete[] tmppath;
+}
+
 char *concatPath(const char *basepath, const char *relpath) {
 	size_t i, baselen, pathlen;
 	char *ret;